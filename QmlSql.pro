@@ -5,7 +5,9 @@ CONFIG += ordered
 
 SUBDIRS += \
         $$PWD/src/sql.pro \
-        $$PWD/examples
+        $$PWD/examples \
+        $$PWD/tests/benchmarks \
+        $$PWD/tests/auto/qmlsqlquerymodel
 
 ##qpm
 OTHER_FILES += \
@@ -2,6 +2,11 @@ QT += sql
 
 CONFIG += c++11
 
+qmlsql_sqlite_interrupt {
+    DEFINES += QMLSQL_SQLITE_INTERRUPT
+    LIBS += -lsqlite3
+}
+
 SOURCES += \
     $$PWD/src/plugin.cpp \
     $$PWD/src/plugin.h \
@@ -12,4 +17,36 @@ SOURCES += \
     $$PWD/src/qmlsqlquerymodel.cpp \
     $$PWD/src/qmlsqlquerymodel.h \
     $$PWD/src/qqmlsqlquery.cpp \
-    $$PWD/src/qqmlsqlquery.h
+    $$PWD/src/qqmlsqlquery.h \
+    $$PWD/src/qmlsqlqueryworker.cpp \
+    $$PWD/src/qmlsqlqueryworker.h \
+    $$PWD/src/qmlsqlmodelworker.cpp \
+    $$PWD/src/qmlsqlmodelworker.h \
+    $$PWD/src/qmlsqlconnectionpool.cpp \
+    $$PWD/src/qmlsqlconnectionpool.h \
+    $$PWD/src/qmlsqlstatementcache.cpp \
+    $$PWD/src/qmlsqlstatementcache.h \
+    $$PWD/src/qmlsqlresultset.cpp \
+    $$PWD/src/qmlsqlresultset.h \
+    $$PWD/src/qmlsqlresult.cpp \
+    $$PWD/src/qmlsqlresult.h \
+    $$PWD/src/qmlsqlrowdiff.cpp \
+    $$PWD/src/qmlsqlrowdiff.h \
+    $$PWD/src/qmlsqlchangenotifier.cpp \
+    $$PWD/src/qmlsqlchangenotifier.h \
+    $$PWD/src/qmlsqlpagedmodel.cpp \
+    $$PWD/src/qmlsqlpagedmodel.h \
+    $$PWD/src/qmlsqlresultcache.cpp \
+    $$PWD/src/qmlsqlresultcache.h \
+    $$PWD/src/qmlsqlstats.cpp \
+    $$PWD/src/qmlsqlstats.h \
+    $$PWD/src/qmlsqlopenworker.cpp \
+    $$PWD/src/qmlsqlopenworker.h \
+    $$PWD/src/qmlsqlschemacache.cpp \
+    $$PWD/src/qmlsqlschemacache.h \
+    $$PWD/src/qmlsqlschemamodel.cpp \
+    $$PWD/src/qmlsqlschemamodel.h \
+    $$PWD/src/qmlsqlcanceller.cpp \
+    $$PWD/src/qmlsqlcanceller.h \
+    $$PWD/src/qmlsqlplan.cpp \
+    $$PWD/src/qmlsqlplan.h
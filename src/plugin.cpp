@@ -3,6 +3,13 @@
 #include "qmlsqlquery.h"
 #include "qmlsqlquerymodel.h"
 #include "qmlsqlcreatedatabase.h"
+#include "qmlsqlresult.h"
+#include "qmlsqlplan.h"
+#include "qmlsqlpagedmodel.h"
+#include "qmlsqlresultcache.h"
+#include "qmlsqlstats.h"
+#include "qmlsqlschemacache.h"
+#include "qmlsqlschemamodel.h"
 #include <qqml.h>
 
 void QQmlSqlPlugin::registerTypes(const char *uri) {
@@ -11,6 +18,13 @@ void QQmlSqlPlugin::registerTypes(const char *uri) {
     qmlRegisterType<QmlSqlQuery>(uri,1,0,"QmlSqlQuery");
     qmlRegisterType<QmlSqlQueryModel>(uri,1,0,"QmlSqlQueryModel");
     qmlRegisterType<QmlSqlCreateDatabase>(uri,1,0,"QmlSqlCreateDatabase");
+    qmlRegisterType<QmlSqlPagedModel>(uri,1,0,"QmlSqlPagedModel");
+    qmlRegisterType<QmlSqlSchemaModel>(uri,1,0,"QmlSqlSchemaModel");
+    qmlRegisterSingletonType<QmlSqlResultCache>(uri,1,0,"QmlSqlResultCache", QmlSqlResultCache::qmlInstance);
+    qmlRegisterSingletonType<QmlSqlStats>(uri,1,0,"QmlSqlStats", QmlSqlStats::qmlInstance);
+    qmlRegisterSingletonType<QmlSqlSchemaCache>(uri,1,0,"QmlSqlSchemaCache", QmlSqlSchemaCache::qmlInstance);
+    qmlRegisterUncreatableType<QmlSqlResult>(uri,1,0,"QmlSqlResult", "QmlSqlResult is read from QmlSqlQuery.result");
+    qmlRegisterUncreatableType<QmlSqlPlan>(uri,1,0,"QmlSqlPlan", "QmlSqlPlan is read from QmlSqlQuery.plan or QmlSqlQueryModel.plan");
 }
 
 
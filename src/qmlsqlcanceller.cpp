@@ -0,0 +1,121 @@
+#include "qmlsqlcanceller.h"
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QMutexLocker>
+
+#ifdef QMLSQL_SQLITE_INTERRUPT
+#include <sqlite3.h>
+#endif
+
+// the server side id of a connection, read once after it has been opened
+static const char backendIdProperty[] = "qmlsqlBackendId";
+
+QmlSqlCanceller::QmlSqlCanceller()
+    : m_cancelledUpTo(0), m_sequence(0), m_running(false), m_handle(nullptr)
+{
+}
+
+QString QmlSqlCanceller::baseName(const QString& connectionName) {
+    const int at = connectionName.lastIndexOf('@');
+    return at < 0 ? connectionName : connectionName.left(at);
+}
+
+/*!
+ \brief void QmlSqlCanceller::identify(const QSqlDatabase& db)
+ Reads the id the server gave the connection \c db and keeps it with its driver, so a statement running
+ on it can be cancelled from another connection. Called right after \c db has been opened, nothing is
+ read for drivers that can not be cancelled that way.
+ */
+void QmlSqlCanceller::identify(const QSqlDatabase& db) {
+    QString statement;
+    if (db.driverName() == "QPSQL")
+        statement = "SELECT pg_backend_pid()";
+    else if (db.driverName() == "QMYSQL")
+        statement = "SELECT CONNECTION_ID()";
+    else
+        return;
+
+    QVariant id;
+    QSqlQuery query(db);
+    if (query.exec(statement) && query.next())
+        id = query.value(0);
+    db.driver()->setProperty(backendIdProperty, id);
+}
+
+/*!
+ \brief bool QmlSqlCanceller::begin(const QSqlDatabase& db, int sequence)
+ Marks request \c sequence as running on \c db. Returns false if it has been cancelled already, it must
+ then not be run.
+ */
+bool QmlSqlCanceller::begin(const QSqlDatabase& db, int sequence) {
+    QMutexLocker locker(&m_mutex);
+    m_sequence = sequence;
+    if (sequence <= m_cancelledUpTo.load())
+        return false;
+
+    m_running = true;
+    m_connectionName = db.connectionName();
+    m_driverName = db.driverName();
+    m_backendId = db.driver()->property(backendIdProperty);
+    m_handle = nullptr;
+    const QVariant handle = db.driver()->handle();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0)
+        m_handle = *static_cast<void* const*>(handle.constData());
+    return true;
+}
+
+/*!
+ \brief void QmlSqlCanceller::end()
+ Marks the running request as done, cancel() leaves the connection alone from now on.
+ */
+void QmlSqlCanceller::end() {
+    QMutexLocker locker(&m_mutex);
+    m_running = false;
+    m_handle = nullptr;
+}
+
+/*!
+ \brief bool QmlSqlCanceller::isCancelled() const
+ Whether the running request has been cancelled, checked by the worker while it reads rows.
+ */
+bool QmlSqlCanceller::isCancelled() const {
+    return m_running && m_sequence <= m_cancelledUpTo.load();
+}
+
+/*!
+ \brief void QmlSqlCanceller::cancel(int upTo)
+ Cancels every request up to \c upTo and interrupts the one that is running. The worker keeps waiting in
+ end() until the server has been asked, so the request can not hit the statement after it. The
+ connection the statement ran on stays open and can be used again.
+ */
+void QmlSqlCanceller::cancel(int upTo) {
+    QMutexLocker locker(&m_mutex);
+    if (upTo > m_cancelledUpTo.load())
+        m_cancelledUpTo.store(upTo);
+    if (!m_running || m_sequence > upTo)
+        return;
+
+    if (m_driverName == "QSQLITE") {
+#ifdef QMLSQL_SQLITE_INTERRUPT
+        if (m_handle != nullptr)
+            sqlite3_interrupt(static_cast<sqlite3*>(m_handle));
+#endif
+        return;
+    }
+
+    if (!m_backendId.isValid())
+        return;
+    QSqlDatabase admin = QSqlDatabase::database(baseName(m_connectionName), false);
+    if (!admin.isOpen())
+        return;
+    QSqlQuery query(admin);
+    if (m_driverName == "QPSQL") {
+        query.prepare("SELECT pg_cancel_backend(?)");
+        query.addBindValue(m_backendId);
+        query.exec();
+    }
+    else if (m_driverName == "QMYSQL") {
+        // KILL does not take placeholders, the id is a number the server handed out
+        query.exec(QString("KILL QUERY %1").arg(m_backendId.toULongLong()));
+    }
+}
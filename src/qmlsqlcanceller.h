@@ -0,0 +1,52 @@
+#ifndef QMLSQLCANCELLER_H
+#define QMLSQLCANCELLER_H
+
+#include <QSqlDatabase>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QString>
+#include <QVariant>
+
+/*!
+ * \brief The QmlSqlCanceller class
+ * Aborts the statement a worker is running on its pooled connection. Every request the worker takes
+ * gets the next sequence number, cancel() stops every request up to a number: the one that is running
+ * is interrupted and the ones still waiting in the queue are skipped.
+ *
+ * A running statement is interrupted the way its driver allows. QPSQL and QMYSQL ask the server to
+ * cancel it through the connection of the calling thread, QSQLITE calls sqlite3_interrupt() when the
+ * plugin is built with CONFIG += qmlsql_sqlite_interrupt. For every other driver the statement runs to
+ * its end and only reading its rows stops early.
+ *
+ * begin(), end() and isCancelled() are called by the worker, cancel() from the thread that owns the
+ * named connection the worker cloned.
+ */
+class QmlSqlCanceller
+{
+public:
+    QmlSqlCanceller();
+
+    static void identify(const QSqlDatabase& db);
+
+    bool begin(const QSqlDatabase& db, int sequence);
+    void end();
+    bool isCancelled() const;
+    void cancel(int upTo);
+
+private:
+    Q_DISABLE_COPY(QmlSqlCanceller)
+
+    static QString baseName(const QString& connectionName);
+
+    QMutex m_mutex;
+    QAtomicInt m_cancelledUpTo;
+    // the running request, only written by the worker
+    int m_sequence;
+    bool m_running;
+    QString m_connectionName;
+    QString m_driverName;
+    QVariant m_backendId;
+    void* m_handle;
+};
+
+#endif // QMLSQLCANCELLER_H
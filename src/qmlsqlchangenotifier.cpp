@@ -0,0 +1,219 @@
+#include "qmlsqlchangenotifier.h"
+#include <QRegularExpression>
+
+// a table name, optionally qualified by a schema, either part can be quoted
+#define QMLSQL_IDENTIFIER "((?:[\\w$]+|\"[^\"]+\"|`[^`]+`|\\[[^\\]]+\\])(?:\\.(?:[\\w$]+|\"[^\"]+\"|`[^`]+`|\\[[^\\]]+\\]))*)"
+
+QmlSqlChangeNotifier* QmlSqlChangeNotifier::instance() {
+    static QmlSqlChangeNotifier notifier;
+    return &notifier;
+}
+
+QmlSqlChangeNotifier::QmlSqlChangeNotifier(QObject *parent)
+    : QObject(parent)
+{
+}
+
+// pooled clones are named "<connectionName>@<thread>"
+QString QmlSqlChangeNotifier::baseName(const QString& connectionName) {
+    const int at = connectionName.lastIndexOf('@');
+    return at < 0 ? connectionName : connectionName.left(at);
+}
+
+// "main"."Employee" -> employee
+QString QmlSqlChangeNotifier::tableName(const QString& identifier) {
+    QString name = identifier.mid(identifier.lastIndexOf('.') + 1);
+    if (name.length() > 1 && QString("\"`[").contains(name.at(0)))
+        name = name.mid(1, name.length() - 2);
+    return name.toLower();
+}
+
+/*!
+ \brief QStringList QmlSqlChangeNotifier::writtenTables(const QString& query)
+ Returns the lower case names of the tables \c query inserts into, updates, deletes from, truncates,
+ alters or drops.
+ */
+QStringList QmlSqlChangeNotifier::writtenTables(const QString& query) {
+    static const QRegularExpression writes(
+                "(?<!\\bDO\\s)\\b(?:INSERT(?:\\s+OR\\s+\\w+)?\\s+INTO|REPLACE\\s+INTO|UPDATE(?:\\s+OR\\s+\\w+)?|DELETE\\s+FROM"
+                "|TRUNCATE(?:\\s+TABLE)?|DROP\\s+TABLE(?:\\s+IF\\s+EXISTS)?|ALTER\\s+TABLE)\\s+" QMLSQL_IDENTIFIER,
+                QRegularExpression::CaseInsensitiveOption);
+
+    QStringList tables;
+    QRegularExpressionMatchIterator it = writes.globalMatch(query);
+    while (it.hasNext()) {
+        const QString table = tableName(it.next().captured(1));
+        if (!tables.contains(table))
+            tables << table;
+    }
+    return tables;
+}
+
+/*!
+ \brief QStringList QmlSqlChangeNotifier::readTables(const QString& query)
+ Returns the lower case names of the tables that follow FROM or JOIN in \c query. Tables listed after a
+ comma are not found, name those in QmlSqlQueryModel::dependentTables.
+ */
+QStringList QmlSqlChangeNotifier::readTables(const QString& query) {
+    static const QRegularExpression reads("\\b(?:FROM|JOIN)\\s+" QMLSQL_IDENTIFIER, QRegularExpression::CaseInsensitiveOption);
+
+    QStringList tables;
+    QRegularExpressionMatchIterator it = reads.globalMatch(query);
+    while (it.hasNext()) {
+        const QString table = tableName(it.next().captured(1));
+        if (!tables.contains(table))
+            tables << table;
+    }
+    return tables;
+}
+
+/*!
+ \brief bool QmlSqlChangeNotifier::isSchemaChange(const QString& query)
+ Returns true if \c query creates, alters, renames or drops a table, view, index or any other object of
+ the schema.
+ */
+bool QmlSqlChangeNotifier::isSchemaChange(const QString& query) {
+    static const QRegularExpression ddl("^\\s*(?:CREATE|ALTER|DROP|RENAME|COMMENT\\s+ON)\\b", QRegularExpression::CaseInsensitiveOption);
+    return ddl.match(query).hasMatch();
+}
+
+/*!
+ \brief void QmlSqlChangeNotifier::publish(const QString& connectionName, const QStringList& tables)
+ Reports that \c tables of \c connectionName, or of the connection it is a pooled clone of, have been
+ written. While a transaction is open on the connection the tables are kept until it ends.
+ */
+void QmlSqlChangeNotifier::publish(const QString& connectionName, const QStringList& tables) {
+    if (tables.isEmpty())
+        return;
+
+    const QString name = baseName(connectionName);
+    {
+        QMutexLocker locker(&m_mutex);
+        QHash<QString, QSet<QString> >::iterator pending = m_pending.find(name);
+        if (pending != m_pending.end()) {
+            foreach (const QString& table, tables)
+                pending->insert(table);
+            return;
+        }
+    }
+    emit tablesChanged(name, tables);
+}
+
+void QmlSqlChangeNotifier::beginTransaction(const QString& connectionName) {
+    QMutexLocker locker(&m_mutex);
+    m_pending.insert(baseName(connectionName), QSet<QString>());
+}
+
+void QmlSqlChangeNotifier::commitTransaction(const QString& connectionName) {
+    const QString name = baseName(connectionName);
+    QSet<QString> tables;
+    {
+        QMutexLocker locker(&m_mutex);
+        tables = m_pending.take(name);
+    }
+    if (!tables.isEmpty())
+        emit tablesChanged(name, tables.toList());
+}
+
+void QmlSqlChangeNotifier::rollbackTransaction(const QString& connectionName) {
+    QMutexLocker locker(&m_mutex);
+    m_pending.remove(baseName(connectionName));
+}
+
+/*!
+ \brief void QmlSqlChangeNotifier::publishSchemaChange(const QString& connectionName)
+ Reports that the schema of \c connectionName, or of the connection it is a pooled clone of, has been
+ changed. schemaChanged() is emitted right away on the calling thread, also inside a transaction, as a
+ stale schema is worse than loading it once more.
+ */
+void QmlSqlChangeNotifier::publishSchemaChange(const QString& connectionName) {
+    emit schemaChanged(baseName(connectionName));
+}
+
+/*!
+ \brief void QmlSqlChangeNotifier::reportConnectionLost(const QString& connectionName)
+ Reports that \c connectionName, or the connection it is a pooled clone of, has lost its server.
+ connectionLost() is emitted on the calling thread with the name of the named connection.
+ */
+void QmlSqlChangeNotifier::reportConnectionLost(const QString& connectionName) {
+    emit connectionLost(baseName(connectionName));
+}
+
+/*!
+ \brief void QmlSqlChangeNotifier::subscribe(const QString& connectionName, const QString& table)
+ Subscribes to the database notification named like \c table on \c connectionName, if it is open and its
+ driver supports notifications. A connection that is not open yet subscribes once it has been opened, see
+ resubscribe(). Subscriptions are counted, every subscribe() needs a matching unsubscribe().
+ */
+void QmlSqlChangeNotifier::subscribe(const QString& connectionName, const QString& table) {
+    QMutexLocker locker(&m_mutex);
+    int& count = m_subscriptions[connectionName][table];
+    if (count++ > 0)
+        return;
+    subscribeDriver(connectionName, QStringList() << table);
+}
+
+/*!
+ \brief void QmlSqlChangeNotifier::resubscribe(const QString& connectionName)
+ Subscribes the driver of \c connectionName to every table that is subscribed on it. The QmlSqlDatabase
+ that owns the connection calls this each time it has opened it, a new or reopened driver knows nothing
+ of the subscriptions made before.
+ */
+void QmlSqlChangeNotifier::resubscribe(const QString& connectionName) {
+    QMutexLocker locker(&m_mutex);
+    const QStringList tables = m_subscriptions.value(connectionName).keys();
+    if (!tables.isEmpty())
+        subscribeDriver(connectionName, tables);
+}
+
+void QmlSqlChangeNotifier::subscribeDriver(const QString& connectionName, const QStringList& tables) {
+    QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+    if (!db.isOpen() || !db.driver()->hasFeature(QSqlDriver::EventNotifications))
+        return;
+
+    QSqlDriver* driver = db.driver();
+    if (!m_drivers.contains(driver)) {
+        m_drivers.insert(driver, connectionName);
+        connect(driver, SIGNAL(notification(QString,QSqlDriver::NotificationSource,QVariant)),
+                this, SLOT(handleNotification(QString,QSqlDriver::NotificationSource,QVariant)));
+        connect(driver, SIGNAL(destroyed(QObject*)), this, SLOT(handleDriverDestroyed(QObject*)));
+    }
+    const QStringList subscribed = driver->subscribedToNotifications();
+    foreach (const QString& table, tables) {
+        if (!subscribed.contains(table))
+            driver->subscribeToNotification(table);
+    }
+}
+
+void QmlSqlChangeNotifier::unsubscribe(const QString& connectionName, const QString& table) {
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, QHash<QString, int> >::iterator tables = m_subscriptions.find(connectionName);
+    if (tables == m_subscriptions.end() || !tables->contains(table))
+        return;
+    if (--(*tables)[table] > 0)
+        return;
+    tables->remove(table);
+
+    QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+    if (db.isOpen())
+        db.driver()->unsubscribeFromNotification(table);
+}
+
+void QmlSqlChangeNotifier::handleNotification(const QString& name, QSqlDriver::NotificationSource source, const QVariant& payload) {
+    Q_UNUSED(source)
+    Q_UNUSED(payload)
+
+    QString connectionName;
+    {
+        QMutexLocker locker(&m_mutex);
+        connectionName = m_drivers.value(qobject_cast<QSqlDriver*>(sender()));
+    }
+    if (!connectionName.isEmpty())
+        emit tablesChanged(connectionName, QStringList() << name.toLower());
+}
+
+// the connection was removed, the counted subscriptions stay for the driver it is opened with next
+void QmlSqlChangeNotifier::handleDriverDestroyed(QObject* driver) {
+    QMutexLocker locker(&m_mutex);
+    m_drivers.remove(static_cast<QSqlDriver*>(driver));
+}
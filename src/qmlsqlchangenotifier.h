@@ -0,0 +1,78 @@
+#ifndef QMLSQLCHANGENOTIFIER_H
+#define QMLSQLCHANGENOTIFIER_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+/*!
+ * \brief The QmlSqlChangeNotifier class
+ * Process wide bus that tells models which tables of a connection have changed. Writes that run
+ * through QmlSql publish the tables they touched, writes inside a transaction are held back until it is
+ * committed and dropped when it is rolled back. On drivers with QSqlDriver::EventNotifications, such as
+ * PostgreSQL, subscribed tables are also taken from the notifications of the database, so changes made
+ * by other processes are seen as well.
+ *
+ * Statements that change the schema and lost connections are reported on the same bus, so the QmlSqlDatabase that owns the connection can
+ * reconnect it.
+ *
+ * publish(), publishSchemaChange(), reportConnectionLost() and the transaction calls are thread safe, subscribe(), unsubscribe() and resubscribe() must be called from
+ * the thread that owns the connection. tablesChanged() is emitted on the thread of the writer.
+ */
+class QmlSqlChangeNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    static QmlSqlChangeNotifier* instance();
+
+    static QStringList writtenTables(const QString& query);
+    static QStringList readTables(const QString& query);
+    static bool isSchemaChange(const QString& query);
+
+    void publish(const QString& connectionName, const QStringList& tables);
+
+    void beginTransaction(const QString& connectionName);
+    void commitTransaction(const QString& connectionName);
+    void rollbackTransaction(const QString& connectionName);
+
+    void reportConnectionLost(const QString& connectionName);
+    void publishSchemaChange(const QString& connectionName);
+
+    void subscribe(const QString& connectionName, const QString& table);
+    void unsubscribe(const QString& connectionName, const QString& table);
+    void resubscribe(const QString& connectionName);
+
+signals:
+    void tablesChanged(const QString& connectionName, const QStringList& tables);
+    void connectionLost(const QString& connectionName);
+    void schemaChanged(const QString& connectionName);
+
+private slots:
+    void handleNotification(const QString& name, QSqlDriver::NotificationSource source, const QVariant& payload);
+    void handleDriverDestroyed(QObject* driver);
+
+private:
+    explicit QmlSqlChangeNotifier(QObject *parent = nullptr);
+    Q_DISABLE_COPY(QmlSqlChangeNotifier)
+
+    static QString baseName(const QString& connectionName);
+    static QString tableName(const QString& identifier);
+    // the caller holds m_mutex
+    void subscribeDriver(const QString& connectionName, const QStringList& tables);
+
+    QMutex m_mutex;
+    // tables written by open transactions, keyed by connection
+    QHash<QString, QSet<QString> > m_pending;
+    // subscription counts, keyed by connection and table
+    QHash<QString, QHash<QString, int> > m_subscriptions;
+    QHash<QSqlDriver*, QString> m_drivers;
+};
+
+#endif // QMLSQLCHANGENOTIFIER_H
@@ -0,0 +1,418 @@
+#include "qmlsqlconnectionpool.h"
+#include "qmlsqlstatementcache.h"
+#include "qmlsqlcanceller.h"
+#include <QSqlQuery>
+
+/*!
+ \brief QmlSqlConnectionParams QmlSqlConnectionParams::fromConnection(const QString& connectionName)
+ Copies the settings of the connection \c connectionName. Must be called from the thread that added the connection.
+ */
+QmlSqlConnectionParams QmlSqlConnectionParams::fromConnection(const QString& connectionName) {
+    QmlSqlConnectionParams params;
+    params.connectionName = connectionName;
+    const QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+    if (!db.isValid())
+        return params;
+
+    params.driverName = db.driverName();
+    params.databaseName = db.databaseName();
+    params.hostName = db.hostName();
+    params.userName = db.userName();
+    params.password = db.password();
+    params.connectOptions = db.connectOptions();
+    params.port = db.port();
+    return params;
+}
+
+
+QmlSqlConnectionPool* QmlSqlConnectionPool::instance() {
+    static QmlSqlConnectionPool pool;
+    return &pool;
+}
+
+/*!
+ \brief bool QmlSqlConnectionPool::isConnectionError(const QSqlError& error)
+ Returns true if \c error means the connection to the server is gone rather than that a statement failed:
+ a QSqlError::ConnectionError, a SQLSTATE of class 08 or one of the shutdown codes of PostgreSQL, or the
+ "server has gone away" and "lost connection" codes of MySQL.
+ */
+bool QmlSqlConnectionPool::isConnectionError(const QSqlError& error) {
+    if (error.type() == QSqlError::ConnectionError)
+        return true;
+
+    static const QStringList codes = QStringList() << "57P01" << "57P02" << "57P03" << "2006" << "2013";
+    const QString code = error.nativeErrorCode();
+    return code.startsWith("08") || codes.contains(code);
+}
+
+int QmlSqlConnectionPool::inUse(const Pool* pool) {
+    int count = 0;
+    foreach (const Connection& c, pool->connections) {
+        if (c.refs > 0)
+            count++;
+    }
+    return count;
+}
+
+// must be called from the thread that opened the connection, the connections passed here are idle so
+// nothing else holds a handle to them
+void QmlSqlConnectionPool::closeConnection(const QString& name) {
+    QmlSqlStatementCache::instance()->invalidate(name);
+    QSqlDatabase::removeDatabase(name);
+}
+
+// a clone of the calling thread is closed by the caller, one of another thread is handed to that thread
+void QmlSqlConnectionPool::expire(const Connection& c, QStringList* closeHere) {
+    if (c.thread == QThread::currentThread())
+        *closeHere << c.name;
+    else
+        expireLater(c.thread, c.name);
+}
+
+// the first clone queued for a thread posts a QmlSqlPoolCloser to it, the ones after it go along
+void QmlSqlConnectionPool::expireLater(QThread* thread, const QString& name) {
+    QStringList& names = m_expired[thread];
+    if (names.isEmpty()) {
+        QmlSqlPoolCloser* closer = new QmlSqlPoolCloser;
+        closer->moveToThread(thread);
+        QMetaObject::invokeMethod(closer, "closeExpired", Qt::QueuedConnection);
+    }
+    names << name;
+}
+
+/*!
+ \brief void QmlSqlConnectionPool::closeExpired()
+ Closes the clones of the calling thread that have been taken out of the pool by another thread, or by
+ a release() while the caller still held the connection.
+ */
+void QmlSqlConnectionPool::closeExpired() {
+    QStringList names;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_expired.isEmpty())
+            return;
+        names = m_expired.take(QThread::currentThread());
+    }
+
+    foreach (QString name, names) {
+        closeConnection(name);
+    }
+}
+
+/*!
+ \brief void QmlSqlConnectionPool::configure(const QmlSqlConnectionParams& params, int minConnections, int maxConnections, int idleTimeout)
+ Sets up the pool for \c params.connectionName. The calling thread becomes the owner of the pool and
+ uses the named connection itself, every other thread gets a clone.
+ */
+void QmlSqlConnectionPool::configure(const QmlSqlConnectionParams& params, int minConnections, int maxConnections, int idleTimeout) {
+    QMutexLocker locker(&m_mutex);
+    Pool* pool = m_pools.value(params.connectionName);
+    if (pool == nullptr) {
+        pool = new Pool;
+        m_pools.insert(params.connectionName, pool);
+    }
+
+    pool->params = params;
+    pool->owner = QThread::currentThread();
+    pool->closed = false;
+    pool->minConnections = minConnections;
+    pool->maxConnections = maxConnections;
+    pool->idleTimeout = idleTimeout;
+
+    foreach (const Connection& c, pool->connections) {
+        if (c.name == params.connectionName)
+            return;
+    }
+    Connection main;
+    main.name = params.connectionName;
+    main.thread = pool->owner;
+    main.idle.start();
+    pool->connections.prepend(main);
+}
+
+/*!
+ \brief void QmlSqlConnectionPool::remove(const QString& connectionName)
+ Closes every idle clone of \c connectionName, the ones of other threads from their thread's event loop.
+ Clones that are still checked out are closed once they are released. The named connection
+ itself is left to its owner.
+ */
+void QmlSqlConnectionPool::remove(const QString& connectionName) {
+    QStringList idle;
+    {
+        QMutexLocker locker(&m_mutex);
+        Pool* pool = m_pools.value(connectionName);
+        if (pool == nullptr)
+            return;
+
+        pool->closed = true;
+        for (int i = pool->connections.count() - 1; i >= 0; i--) {
+            const Connection& c = pool->connections.at(i);
+            if (c.refs > 0)
+                continue;
+            if (c.name != connectionName)
+                expire(c, &idle);
+            pool->connections.removeAt(i);
+        }
+        pool->released.wakeAll();
+    }
+
+    foreach (QString name, idle) {
+        closeConnection(name);
+    }
+}
+
+/*!
+ \brief QSqlDatabase QmlSqlConnectionPool::acquire(const QmlSqlConnectionParams& params, int waitTimeout)
+ Checks out the calling thread's connection of the pool \c params.connectionName, opening it if needed.
+ If maxConnections are already checked out this waits up to \c waitTimeout milliseconds for one to be
+ released. A pool that was never configured is created from \c params.
+
+ Returns an invalid QSqlDatabase if no connection could be handed out. Every valid connection that is
+ returned, open or not, must be given back with release().
+ */
+QSqlDatabase QmlSqlConnectionPool::acquire(const QmlSqlConnectionParams& params, int waitTimeout) {
+    closeExpired();
+
+    QThread* thread = QThread::currentThread();
+    QMutexLocker locker(&m_mutex);
+
+    Pool* pool = m_pools.value(params.connectionName);
+    if (pool == nullptr || pool->closed) {
+        if (!params.isValid())
+            return QSqlDatabase();
+        if (pool == nullptr) {
+            pool = new Pool;
+            m_pools.insert(params.connectionName, pool);
+        }
+        pool->params = params;
+        pool->closed = false;
+    }
+
+    for (int i = 0; i < pool->connections.count(); i++) {
+        Connection& c = pool->connections[i];
+        if (c.thread == thread && c.refs > 0) {
+            c.refs++;
+            return QSqlDatabase::database(c.name, false);
+        }
+    }
+
+    if (pool->maxConnections > 0 && inUse(pool) >= pool->maxConnections) {
+        QElapsedTimer waited;
+        waited.start();
+        pool->waits++;
+        while (inUse(pool) >= pool->maxConnections) {
+            const qint64 remaining = waitTimeout - waited.elapsed();
+            if (remaining <= 0 || !pool->released.wait(&m_mutex, remaining) || pool->closed) {
+                pool->waitTime += waited.elapsed();
+                return QSqlDatabase();
+            }
+        }
+        pool->waitTime += waited.elapsed();
+    }
+
+    int index = -1;
+    for (int i = 0; i < pool->connections.count(); i++) {
+        if (pool->connections.at(i).thread == thread) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        Connection c;
+        c.name = thread == pool->owner ? params.connectionName
+                                       : QString("%1@%2").arg(params.connectionName).arg(quintptr(thread));
+        c.thread = thread;
+        pool->connections << c;
+        index = pool->connections.count() - 1;
+    }
+    pool->connections[index].refs = 1;
+
+    const QString name = pool->connections.at(index).name;
+    const QmlSqlConnectionParams p = pool->params;
+    locker.unlock();
+
+    QSqlDatabase db;
+    if (QSqlDatabase::contains(name)) {
+        db = QSqlDatabase::database(name, false);
+    }
+    else {
+        db = QSqlDatabase::addDatabase(p.driverName, name);
+        db.setHostName(p.hostName);
+        db.setDatabaseName(p.databaseName);
+        db.setUserName(p.userName);
+        db.setPassword(p.password);
+        db.setPort(p.port);
+        db.setConnectOptions(p.connectOptions);
+    }
+    if (!db.isOpen() && db.open()) {
+        QmlSqlCanceller::identify(db);
+        foreach (const QString& statement, p.initStatements) {
+            QSqlQuery init(db);
+            init.exec(statement);
+        }
+    }
+    return db;
+}
+
+/*!
+ \brief void QmlSqlConnectionPool::release(const QSqlDatabase& db)
+ Gives back a connection that was checked out with acquire() on the calling thread. Clones of the calling
+ thread that have been evicted in the meantime are closed.
+
+ When the pool of \c db has been removed the clone is closed too, but only after the caller has
+ returned, as its handle of \c db is still alive here.
+ */
+void QmlSqlConnectionPool::release(const QSqlDatabase& db) {
+    const QString name = db.connectionName();
+    QStringList orphans;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_expired.isEmpty())
+            orphans = m_expired.take(QThread::currentThread());
+        foreach (Pool* pool, m_pools) {
+            for (int i = 0; i < pool->connections.count(); i++) {
+                Connection& c = pool->connections[i];
+                if (c.name != name || c.refs == 0)
+                    continue;
+
+                if (--c.refs == 0) {
+                    c.idle.start();
+                    if (pool->closed) {
+                        // the caller still holds its handle of db, the clone is closed once it returned
+                        if (c.name != pool->params.connectionName)
+                            expireLater(c.thread, c.name);
+                        pool->connections.removeAt(i);
+                    }
+                    pool->released.wakeOne();
+                }
+                break;
+            }
+        }
+    }
+
+    foreach (QString orphan, orphans) {
+        closeConnection(orphan);
+    }
+}
+
+/*!
+ \brief bool QmlSqlConnectionPool::reopen(QSqlDatabase db)
+ Closes the clone \c db and opens it again after its connection was lost, running the initStatements of
+ its pool. Must be called from the thread that owns \c db. The named connection is left to the
+ QmlSqlDatabase that opened it, false is returned for it.
+ */
+bool QmlSqlConnectionPool::reopen(QSqlDatabase db) {
+    const QString name = db.connectionName();
+    const int at = name.lastIndexOf('@');
+    if (at < 0)
+        return false;
+
+    QStringList initStatements;
+    {
+        QMutexLocker locker(&m_mutex);
+        const Pool* pool = m_pools.value(name.left(at));
+        if (pool != nullptr)
+            initStatements = pool->params.initStatements;
+    }
+
+    // the prepared statements belong to the lost connection
+    QmlSqlStatementCache::instance()->invalidate(name);
+    db.close();
+    if (!db.open())
+        return false;
+    QmlSqlCanceller::identify(db);
+    foreach (const QString& statement, initStatements) {
+        QSqlQuery init(db);
+        init.exec(statement);
+    }
+    return true;
+}
+
+/*!
+ \brief void QmlSqlConnectionPool::evictIdle(const QString& connectionName)
+ Takes the clones of \c connectionName that have been idle for longer than idleTimeout out of the pool
+ while keeping at least minConnections open. A clone of another thread is closed from the event loop of
+ that thread, or the next time it acquires or releases a connection.
+ */
+void QmlSqlConnectionPool::evictIdle(const QString& connectionName) {
+    QStringList expired;
+    {
+        QMutexLocker locker(&m_mutex);
+        Pool* pool = m_pools.value(connectionName);
+        if (pool == nullptr || pool->closed)
+            return;
+
+        int open = pool->connections.count();
+        for (int i = open - 1; i >= 0 && open > pool->minConnections; i--) {
+            const Connection& c = pool->connections.at(i);
+            if (c.refs > 0 || c.thread == pool->owner || c.idle.elapsed() < pool->idleTimeout)
+                continue;
+            expire(c, &expired);
+            pool->connections.removeAt(i);
+            open--;
+        }
+    }
+
+    foreach (QString name, expired) {
+        closeConnection(name);
+    }
+}
+
+/*!
+ \brief void QmlSqlConnectionPool::removeThreadConnections()
+ Closes every clone that belongs to the calling thread. Workers call this before their thread finishes.
+ */
+void QmlSqlConnectionPool::removeThreadConnections() {
+    QThread* thread = QThread::currentThread();
+    QStringList names;
+    {
+        QMutexLocker locker(&m_mutex);
+        names = m_expired.take(thread);
+        foreach (Pool* pool, m_pools) {
+            for (int i = pool->connections.count() - 1; i >= 0; i--) {
+                const Connection& c = pool->connections.at(i);
+                if (c.thread != thread || c.thread == pool->owner)
+                    continue;
+                names << c.name;
+                pool->connections.removeAt(i);
+            }
+            pool->released.wakeAll();
+        }
+    }
+
+    foreach (QString name, names) {
+        closeConnection(name);
+    }
+}
+
+QmlSqlPoolCloser::QmlSqlPoolCloser(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void QmlSqlPoolCloser::closeExpired() {
+    QmlSqlConnectionPool::instance()->closeExpired();
+    deleteLater();
+}
+
+/*!
+ \brief QVariantMap QmlSqlConnectionPool::stats(const QString& connectionName)
+ Returns the usage counters of the pool \c connectionName.
+ */
+QVariantMap QmlSqlConnectionPool::stats(const QString& connectionName) {
+    QVariantMap map;
+    QMutexLocker locker(&m_mutex);
+    const Pool* pool = m_pools.value(connectionName);
+    if (pool == nullptr)
+        return map;
+
+    const int used = inUse(pool);
+    map.insert("inUse", used);
+    map.insert("idle", pool->connections.count() - used);
+    map.insert("open", pool->connections.count());
+    map.insert("waits", pool->waits);
+    map.insert("waitTime", pool->waitTime);
+    map.insert("minConnections", pool->minConnections);
+    map.insert("maxConnections", pool->maxConnections);
+    return map;
+}
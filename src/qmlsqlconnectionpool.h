@@ -0,0 +1,132 @@
+#ifndef QMLSQLCONNECTIONPOOL_H
+#define QMLSQLCONNECTIONPOOL_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QThread>
+#include <QMetaType>
+#include <QString>
+#include <QVariantMap>
+#include <QStringList>
+
+/*!
+ * \brief The QmlSqlConnectionParams struct
+ * Snapshot of the settings of a named connection. It is taken on the thread that owns the
+ * connection and used to open a clone of that connection on another thread, as a QSqlDatabase
+ * can only be used from the thread that created it.
+ */
+struct QmlSqlConnectionParams
+{
+    QmlSqlConnectionParams() : port(-1) {}
+
+    static QmlSqlConnectionParams fromConnection(const QString& connectionName);
+    bool isValid() const { return !driverName.isEmpty(); }
+
+    QString connectionName;
+    QString driverName;
+    QString databaseName;
+    QString hostName;
+    QString userName;
+    QString password;
+    QString connectOptions;
+    int port;
+    // run on every connection the pool opens, such as the PRAGMAs of a sqliteProfile
+    QStringList initStatements;
+};
+Q_DECLARE_METATYPE(QmlSqlConnectionParams)
+
+/*!
+ * \brief The QmlSqlConnectionPool class
+ * Process wide set of pools, one per connectionName. Every thread that acquires a connection gets its
+ * own clone of the named connection, the thread that opened the pool uses the named connection itself.
+ * maxConnections limits how many connections are checked out at the same time, connections that have
+ * been idle for longer than idleTimeout are closed as long as at least minConnections stay open.
+ * A QSqlDatabase may only be closed by the thread that opened it, so a clone that another thread
+ * evicts or removes is closed by its own thread: through its event loop, or on its next acquire() or
+ * release() when it does not run one.
+ *
+ * All members are thread safe.
+ */
+class QmlSqlConnectionPool
+{
+public:
+    static QmlSqlConnectionPool* instance();
+
+    static bool isConnectionError(const QSqlError& error);
+
+    void configure(const QmlSqlConnectionParams& params, int minConnections, int maxConnections, int idleTimeout);
+    void remove(const QString& connectionName);
+
+    QSqlDatabase acquire(const QmlSqlConnectionParams& params, int waitTimeout = 30000);
+    void release(const QSqlDatabase& db);
+    bool reopen(QSqlDatabase db);
+
+    void evictIdle(const QString& connectionName);
+    void removeThreadConnections();
+    void closeExpired();
+
+    QVariantMap stats(const QString& connectionName);
+
+private:
+    struct Connection
+    {
+        Connection() : thread(nullptr), refs(0) {}
+        QString name;
+        QThread* thread;
+        int refs;
+        QElapsedTimer idle;
+    };
+
+    struct Pool
+    {
+        Pool() : owner(nullptr), closed(false), minConnections(1), maxConnections(8), idleTimeout(60000), waits(0), waitTime(0) {}
+        QmlSqlConnectionParams params;
+        QThread* owner;
+        bool closed;
+        int minConnections;
+        int maxConnections;
+        int idleTimeout;
+        QList<Connection> connections;
+        qint64 waits;
+        qint64 waitTime;
+        QWaitCondition released;
+    };
+
+    QmlSqlConnectionPool() {}
+    Q_DISABLE_COPY(QmlSqlConnectionPool)
+
+    static int inUse(const Pool* pool);
+    static void closeConnection(const QString& name);
+    // the caller holds m_mutex
+    void expire(const Connection& c, QStringList* closeHere);
+    void expireLater(QThread* thread, const QString& name);
+
+    QMutex m_mutex;
+    QHash<QString, Pool*> m_pools;
+    // clones taken out of their pool that their own thread still has to close
+    QHash<QThread*, QStringList> m_expired;
+};
+
+/*!
+ * \brief The QmlSqlPoolCloser class
+ * Posted to a thread that owns clones another thread took out of the pool, closes them from that
+ * thread's event loop and deletes itself.
+ */
+class QmlSqlPoolCloser : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QmlSqlPoolCloser(QObject *parent = nullptr);
+
+public slots:
+    void closeExpired();
+};
+
+#endif // QMLSQLCONNECTIONPOOL_H
@@ -1,4 +1,6 @@
 #include "qmlsqlcreatedatabase.h"
+#include <QSqlQuery>
+#include <QSqlError>
 
 
 
@@ -36,7 +38,8 @@
 QmlSqlCreateDatabase::QmlSqlCreateDatabase(QObject *parent) :
     QObject(parent),
     m_useMd5(true),
-    m_databaseName("NULL")
+    m_databaseName("NULL"),
+    m_sqliteProfile(QmlSqlDatabase::DefaultProfile)
 {
     connect(this, SIGNAL(error(QString)), this, SLOT(handleError(QString)));
 }
@@ -162,6 +165,58 @@ void QmlSqlCreateDatabase::setLastCreatedDatabaseFile(const QString& lastCreated
     emit lastCreatedDatabaseFileChanged();
 }
 
+/*!
+  \qmlproperty enum QmlSqlCreateDatabase::sqliteProfile
+  The QmlSqlDatabase.sqliteProfile the database is created with. Settings that are stored in the file,
+  such as the WAL journal_mode and the page_size, stay in effect for every later connection, the others
+  have to be set again through the sqliteProfile of the QmlSqlDatabase that opens it. The default is
+  QmlSqlDatabase.DefaultProfile.
+
+\code
+    QmlSqlCreateDatabase{
+        databaseName: "ANewDatabase"
+        filePath: "/Some/Path/To/Save/To"
+        useMd5: false
+        sqliteProfile: QmlSqlDatabase.Balanced
+        onCreated: console.log("journal_mode", sqliteSettings.journal_mode)
+    }
+\endcode
+
+  \sa sqliteSettings
+*/
+QmlSqlDatabase::SqliteProfile QmlSqlCreateDatabase::sqliteProfile() const {
+    return m_sqliteProfile;
+}
+
+void QmlSqlCreateDatabase::setSqliteProfile(const QmlSqlDatabase::SqliteProfile& sqliteProfile) {
+    if (m_sqliteProfile == sqliteProfile)
+        return;
+    m_sqliteProfile = sqliteProfile;
+    emit sqliteProfileChanged();
+}
+
+/*!
+  \qmlproperty object QmlSqlCreateDatabase::sqliteSettings
+  The settings SQLite used for the last database created by exec(), see QmlSqlDatabase::sqliteSettings.
+*/
+QVariantMap QmlSqlCreateDatabase::sqliteSettings() const {
+    return m_sqliteSettings;
+}
+
+void QmlSqlCreateDatabase::applySqliteProfile(const QSqlDatabase& db) {
+    foreach (const QString& pragma, QmlSqlDatabase::sqlitePragmas(m_sqliteProfile)) {
+        QSqlQuery query(db);
+        if (!query.exec(pragma))
+            error(QString("could not apply %1 Reason: %2").arg(pragma).arg(query.lastError().text()));
+    }
+
+    const QVariantMap settings = QmlSqlDatabase::readSqliteSettings(db);
+    if (m_sqliteSettings == settings)
+        return;
+    m_sqliteSettings = settings;
+    emit sqliteSettingsChanged();
+}
+
 /*!
   \qmlmethod void QmlSqlCreateDatabase::exec()
   A method that is run to create the database. Returns a \c errorString if it can not complete the method.
@@ -202,6 +257,7 @@ void QmlSqlCreateDatabase::exec() {
                 db.setDatabaseName(m_databaseName);
 
                 if (db.open()) {
+                    applySqliteProfile(db);
                     qDebug()<< "Sweet we created the database " << finalName;
                     setLastCreatedDatabaseFile(finalName);
                     created();
@@ -226,6 +282,7 @@ void QmlSqlCreateDatabase::exec() {
                 QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
                 db.setDatabaseName(m_databaseName);
                 if(db.open()) {
+                    applySqliteProfile(db);
                     qDebug()<< "Sweet we created the database " << finalName;
                     setLastCreatedDatabaseFile(finalName);
                     created();
@@ -254,6 +311,7 @@ void QmlSqlCreateDatabase::exec() {
                 db.setDatabaseName(m_databaseName);
 
                 if(db.open()) {
+                    applySqliteProfile(db);
                     qDebug()<< "Sweet we created the database " << finalName;
                     setLastCreatedDatabaseFile(finalName);
                     created();
@@ -279,6 +337,7 @@ void QmlSqlCreateDatabase::exec() {
                 db.setDatabaseName(m_databaseName);
 
                 if(db.open()) {
+                    applySqliteProfile(db);
                     qDebug()<< "Database created " << finalName;
                     setLastCreatedDatabaseFile(finalName);
                     created();
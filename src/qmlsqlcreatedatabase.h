@@ -11,6 +11,9 @@
 
 #include <QDebug>
 #include <QSqlDatabase>
+#include <QVariantMap>
+
+#include "qmlsqldatabase.h"
 
 /*!
  * \class The QmlSqlCreateDatabase class
@@ -25,6 +28,8 @@ class QmlSqlCreateDatabase : public QObject
     Q_PROPERTY(QString errorString READ errorString NOTIFY errorStringChanged)
     Q_PROPERTY(QString databaseName READ databaseName WRITE setDatabaseName NOTIFY databaseNameChanged)
     Q_PROPERTY(QString lastCreatedDatabaseFile READ lastCreatedDatabaseFile  NOTIFY lastCreatedDatabaseFileChanged)
+    Q_PROPERTY(QmlSqlDatabase::SqliteProfile sqliteProfile READ sqliteProfile WRITE setSqliteProfile NOTIFY sqliteProfileChanged)
+    Q_PROPERTY(QVariantMap sqliteSettings READ sqliteSettings NOTIFY sqliteSettingsChanged)
 
 public:
     explicit QmlSqlCreateDatabase(QObject *parent = nullptr);
@@ -46,6 +51,11 @@ public:
     QString lastCreatedDatabaseFile() const;
     void setLastCreatedDatabaseFile(const QString& lastCreatedDatabaseFile);
 
+    QmlSqlDatabase::SqliteProfile sqliteProfile() const;
+    void setSqliteProfile(const QmlSqlDatabase::SqliteProfile& sqliteProfile);
+
+    QVariantMap sqliteSettings() const;
+
 
     Q_INVOKABLE void exec();
     QString generateMd5Sum(const QString& databaseName);
@@ -58,6 +68,8 @@ signals:
     void errorStringChanged();
     void databaseNameChanged();
     void lastCreatedDatabaseFileChanged();
+    void sqliteProfileChanged();
+    void sqliteSettingsChanged();
     void error(QString);
     void created();
 
@@ -71,6 +83,10 @@ private:
     QString m_databaseName;
     QString m_errorString;
     QString m_lastCreatedDatabaseFile;
+    QmlSqlDatabase::SqliteProfile m_sqliteProfile;
+    QVariantMap m_sqliteSettings;
+
+    void applySqliteProfile(const QSqlDatabase& db);
 };
 
 #endif // QMLSQLCREATEDATABASE_H
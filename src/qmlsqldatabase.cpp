@@ -1,4 +1,13 @@
 #include "qmlsqldatabase.h"
+#include "qmlsqlconnectionpool.h"
+#include "qmlsqlstatementcache.h"
+#include "qmlsqlchangenotifier.h"
+#include "qmlsqlresultcache.h"
+#include "qmlsqlschemacache.h"
+#include "qmlsqlopenworker.h"
+#include <QSqlQuery>
+#include <QThread>
+#include <limits>
 
 
 /*!
@@ -68,15 +77,32 @@ Some of the things are close open check validation of Database types ect.
 
 
 QmlSqlDatabase::QmlSqlDatabase(QObject *parent)
-    : QObject(parent), m_isConnected(false)
+    : QObject(parent), m_isConnected(false), m_minConnections(1), m_maxConnections(8), m_idleTimeout(60000), m_statementCacheSize(32), m_transactionDepth(0),
+      m_sqliteProfile(DefaultProfile), m_asyncOpen(false), m_connectTimeout(10000), m_maxRetries(3), m_retryDelay(1000),
+      m_maxRetryDelay(30000), m_state(Closed), m_openTicket(0), m_openAttempt(0), m_openThread(nullptr), m_openWorker(nullptr),
+      m_healthCheckInterval(0), m_autoReconnect(true), m_reconnecting(false), m_reconnectCount(0), m_downtime(0)
 {
     setDatabaseDriverList();
+    m_retryTimer.setSingleShot(true);
+    m_connectTimer.setSingleShot(true);
+    connect(&m_evictTimer, SIGNAL(timeout()), this, SLOT(evictIdleConnections()));
+    connect(&m_retryTimer, SIGNAL(timeout()), this, SLOT(startOpenAttempt()));
+    connect(&m_connectTimer, SIGNAL(timeout()), this, SLOT(handleConnectTimeout()));
+    connect(&m_healthTimer, SIGNAL(timeout()), this, SLOT(checkHealth()));
+    connect(QmlSqlChangeNotifier::instance(), SIGNAL(connectionLost(QString)), this, SLOT(handleConnectionLost(QString)));
     connect(this, SIGNAL(error(QString)), this, SLOT(handleError(QString)));
     connect(this, SIGNAL(connectionOpened(QSqlDatabase,QString)), this, SLOT(handleOpened(QSqlDatabase,QString)));
     connect(this, SIGNAL(closeRequested(CloseReason,QString)), this, SLOT(handleCloseRequested(CloseReason,QString)));
     connect(this, SIGNAL(sqlError(QSqlError)),this, SLOT(handleSqlError(QSqlError)));
 }
 
+QmlSqlDatabase::~QmlSqlDatabase() {
+    if (m_openThread != nullptr) {
+        m_openThread->quit();
+        m_openThread->wait();
+    }
+}
+
 /*!
   \qmlproperty enum QmlSqlDatabase::databaseDriver
   Returns the database driver used to access the database connection.
@@ -147,14 +173,27 @@ QStringList QmlSqlDatabase::databaseDriverList() const
 
 
 void QmlSqlDatabase::setDatabaseDriverList() {
-    m_databaseDriverList.clear();
-    QList<QString> li;
+    m_databaseDriverList = availableDrivers();
+}
+
+static QStringList findAvailableDrivers() {
+    QStringList li;
     foreach(QString l, QSqlDatabase::drivers()) {
        if (QSqlDatabase::isDriverAvailable(l)) {
            li << l;
        }
     }
-    m_databaseDriverList << li;
+    return li;
+}
+
+/*!
+ \brief QStringList QmlSqlDatabase::availableDrivers()
+ Returns the SQL drivers that can be loaded. Finding out loads every driver plugin, so it is only done the
+ first time and shared by all QmlSqlDatabase objects of the process.
+ */
+QStringList QmlSqlDatabase::availableDrivers() {
+    static const QStringList drivers = findAvailableDrivers();
+    return drivers;
 }
 
 /*!
@@ -286,6 +325,443 @@ void QmlSqlDatabase::setConnectionName(const QString& connectionName) {
     emit connectionNameChanged();
 }
 
+/*!
+  \qmlproperty int QmlSqlDatabase::minConnections
+  The number of connections of the pool behind connectionName that are kept open even when they are idle.
+  The default is 1, which is the connection opened by this object.
+
+  Asynchronous QmlSqlQuery and QmlSqlQueryModel objects run on their own threads and as a QSqlDatabase can
+  only be used from the thread that opened it, each of those threads gets its own connection from the pool.
+
+  \sa maxConnections, idleTimeout, poolStats()
+*/
+int QmlSqlDatabase::minConnections() const {
+    return m_minConnections;
+}
+
+void QmlSqlDatabase::setMinConnections(int minConnections) {
+    if (m_minConnections == minConnections)
+        return;
+    m_minConnections = minConnections;
+    configurePool();
+    emit minConnectionsChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlDatabase::maxConnections
+  The number of pooled connections that can be in use at the same time. A thread that needs a connection
+  while all of them are in use waits for one to be released. The default is 8, 0 means no limit.
+*/
+int QmlSqlDatabase::maxConnections() const {
+    return m_maxConnections;
+}
+
+void QmlSqlDatabase::setMaxConnections(int maxConnections) {
+    if (m_maxConnections == maxConnections)
+        return;
+    m_maxConnections = maxConnections;
+    configurePool();
+    emit maxConnectionsChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlDatabase::idleTimeout
+  The time in milliseconds after which an unused pooled connection is closed. The default is 60000.
+*/
+int QmlSqlDatabase::idleTimeout() const {
+    return m_idleTimeout;
+}
+
+void QmlSqlDatabase::setIdleTimeout(int idleTimeout) {
+    if (m_idleTimeout == idleTimeout)
+        return;
+    m_idleTimeout = idleTimeout;
+    configurePool();
+    emit idleTimeoutChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlDatabase::statementCacheSize
+  The number of prepared statements that QmlSqlQuery keeps per connection, so running the same
+  queryString again does not prepare it again. The least recently used statement is dropped first.
+  The default is 32, 0 turns the cache off.
+
+  \sa statementCacheStats()
+*/
+int QmlSqlDatabase::statementCacheSize() const {
+    return m_statementCacheSize;
+}
+
+void QmlSqlDatabase::setStatementCacheSize(int statementCacheSize) {
+    if (m_statementCacheSize == statementCacheSize)
+        return;
+    m_statementCacheSize = statementCacheSize;
+    QmlSqlStatementCache::instance()->setCapacity(m_connectionName, m_statementCacheSize);
+    emit statementCacheSizeChanged();
+}
+
+/*!
+  \qmlproperty string QmlSqlDatabase::connectOptions
+  Driver specific options passed to QSqlDatabase::setConnectOptions(), such as
+  \c{"QSQLITE_BUSY_TIMEOUT=5000"} or \c{"sslmode=require"}. They have to be set before the connection is
+  opened. The options of a sqliteProfile are added to them.
+*/
+QString QmlSqlDatabase::connectOptions() const {
+    return m_connectOptions;
+}
+
+void QmlSqlDatabase::setConnectOptions(const QString& connectOptions) {
+    if (m_connectOptions == connectOptions)
+        return;
+    m_connectOptions = connectOptions;
+    emit connectOptionsChanged();
+}
+
+/*!
+  \qmlproperty enum QmlSqlDatabase::sqliteProfile
+  Tunes a SQLite connection, and every pooled connection opened from it, for a kind of workload. The
+  profile is applied through PRAGMAs each time a connection is opened.
+
+  \table
+  \header \li Profile \li journal_mode \li synchronous \li cache_size \li mmap_size \li temp_store \li busy_timeout
+  \row \li QmlSqlDatabase.DefaultProfile \li \li \li \li \li \li
+  \row \li QmlSqlDatabase.Durable \li WAL \li FULL \li 8 MiB \li 0 \li DEFAULT \li 5000
+  \row \li QmlSqlDatabase.Balanced \li WAL \li NORMAL \li 32 MiB \li 64 MiB \li MEMORY \li 5000
+  \row \li QmlSqlDatabase.Fast \li WAL \li OFF \li 64 MiB \li 256 MiB \li MEMORY \li 1000
+  \row \li QmlSqlDatabase.ReadOnlyMmap \li \li \li 16 MiB \li 1 GiB \li MEMORY \li 5000
+  \endtable
+
+  DefaultProfile, the default, leaves the settings of SQLite alone. All other profiles ask for a
+  page_size of 4096, which only takes effect on a database that has no tables yet. ReadOnlyMmap opens the
+  file read only and sets query_only. Fast can lose the last transactions on a power failure, but never
+  corrupts the database.
+
+  Changing the profile of an open connection applies its PRAGMAs right away, the connect options of
+  ReadOnlyMmap take effect on the next open(). sqliteSettings reports what SQLite actually uses.
+
+\code
+    QmlSqlDatabase{
+        databaseDriver: QmlSqlDatabase.SQLite
+        databaseName: "/path/to/app.sqlite"
+        sqliteProfile: QmlSqlDatabase.Balanced
+        onConnected: console.log(sqliteSettings.journal_mode, sqliteSettings.synchronous)
+    }
+\endcode
+*/
+QmlSqlDatabase::SqliteProfile QmlSqlDatabase::sqliteProfile() const {
+    return m_sqliteProfile;
+}
+
+void QmlSqlDatabase::setSqliteProfile(const QmlSqlDatabase::SqliteProfile& sqliteProfile) {
+    if (m_sqliteProfile == sqliteProfile)
+        return;
+    m_sqliteProfile = sqliteProfile;
+    if (m_isConnected && isSqlite()) {
+        applySqliteProfile();
+        configurePool();
+    }
+    emit sqliteProfileChanged();
+}
+
+/*!
+  \qmlproperty object QmlSqlDatabase::sqliteSettings
+  The settings SQLite uses on this connection after sqliteProfile has been applied: \c journal_mode,
+  \c synchronous, \c cache_size, \c mmap_size, \c page_size, \c temp_store, \c busy_timeout and
+  \c query_only. It is empty for other drivers.
+*/
+QVariantMap QmlSqlDatabase::sqliteSettings() const {
+    return m_sqliteSettings;
+}
+
+/*!
+  \qmlproperty bool QmlSqlDatabase::asyncOpen
+  When \c true the connection is opened with openAsync() once the component is complete, so a slow or
+  unreachable host does not hold up the loading of the QML. When \c false, the default, the component
+  opens the connection with open() and is connected right after it has been created.
+
+  Objects that use connectionName, such as QmlSqlQueryModel, wait for the connected() signal.
+*/
+bool QmlSqlDatabase::asyncOpen() const {
+    return m_asyncOpen;
+}
+
+void QmlSqlDatabase::setAsyncOpen(bool asyncOpen) {
+    if (m_asyncOpen == asyncOpen)
+        return;
+    m_asyncOpen = asyncOpen;
+    emit asyncOpenChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlDatabase::connectTimeout
+  How long in milliseconds an attempt to open the connection may take. The QPSQL, QMYSQL and QODBC drivers
+  are passed the timeout, rounded up to whole seconds, through their connect options unless connectOptions
+  already sets one. openAsync() also gives up on an attempt that has not finished in time and runs the
+  retry on a new thread, the stuck one ends on its own once the driver returns. The default is 10000, 0
+  leaves the timeout to the driver.
+*/
+int QmlSqlDatabase::connectTimeout() const {
+    return m_connectTimeout;
+}
+
+void QmlSqlDatabase::setConnectTimeout(int connectTimeout) {
+    if (m_connectTimeout == connectTimeout)
+        return;
+    m_connectTimeout = connectTimeout;
+    emit connectTimeoutChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlDatabase::maxRetries
+  How many more times openAsync() tries to open the connection after the first attempt failed. The default
+  is 3, 0 gives up right away.
+
+  \sa retryDelay, maxRetryDelay, state
+*/
+int QmlSqlDatabase::maxRetries() const {
+    return m_maxRetries;
+}
+
+void QmlSqlDatabase::setMaxRetries(int maxRetries) {
+    if (m_maxRetries == maxRetries)
+        return;
+    m_maxRetries = maxRetries;
+    emit maxRetriesChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlDatabase::retryDelay
+  The time in milliseconds openAsync() waits before it tries again after the first failed attempt. The wait
+  doubles with every further attempt, up to maxRetryDelay. The default is 1000.
+*/
+int QmlSqlDatabase::retryDelay() const {
+    return m_retryDelay;
+}
+
+void QmlSqlDatabase::setRetryDelay(int retryDelay) {
+    if (m_retryDelay == retryDelay)
+        return;
+    m_retryDelay = retryDelay;
+    emit retryDelayChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlDatabase::maxRetryDelay
+  The longest time in milliseconds openAsync() waits between two attempts. The default is 30000.
+*/
+int QmlSqlDatabase::maxRetryDelay() const {
+    return m_maxRetryDelay;
+}
+
+void QmlSqlDatabase::setMaxRetryDelay(int maxRetryDelay) {
+    if (m_maxRetryDelay == maxRetryDelay)
+        return;
+    m_maxRetryDelay = maxRetryDelay;
+    emit maxRetryDelayChanged();
+}
+
+/*!
+  \qmlproperty enum QmlSqlDatabase::state
+  Where the connection is at.
+
+  \table
+  \header \li State \li Meaning
+  \row \li QmlSqlDatabase.Closed \li The connection has not been opened yet or has been closed.
+  \row \li QmlSqlDatabase.Connecting \li An attempt to open the connection is running.
+  \row \li QmlSqlDatabase.Open \li The connection is open.
+  \row \li QmlSqlDatabase.Retrying \li An attempt failed, the next one starts after the retry delay.
+  \row \li QmlSqlDatabase.Failed \li The connection could not be opened, errorString holds the reason.
+  \endtable
+
+\code
+    QmlSqlDatabase{
+        databaseDriver: QmlSqlDatabase.Postgres
+        source: "db.example.com"
+        databaseName: "customdb"
+        connectTimeout: 5000
+        maxRetries: 5
+    }
+
+    BusyIndicator { running: db.state === QmlSqlDatabase.Connecting || db.state === QmlSqlDatabase.Retrying }
+\endcode
+*/
+QmlSqlDatabase::State QmlSqlDatabase::state() const {
+    return m_state;
+}
+
+void QmlSqlDatabase::setState(State state) {
+    if (m_state == state)
+        return;
+    m_state = state;
+    emit stateChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlDatabase::healthCheckInterval
+  How often in milliseconds an open connection is checked for whether its server still answers. The check
+  runs a trivial statement on a pooled connection of a worker thread, and only while none of the pooled
+  connections is in use, so it neither blocks the UI nor competes with queries. A connection that fails the
+  check is treated as lost, see autoReconnect. A SQLite database has no server and is never checked.
+  The default is 0, which turns the checks off. Set it to e.g. 30000 to check every 30 seconds.
+*/
+int QmlSqlDatabase::healthCheckInterval() const {
+    return m_healthCheckInterval;
+}
+
+void QmlSqlDatabase::setHealthCheckInterval(int healthCheckInterval) {
+    if (m_healthCheckInterval == healthCheckInterval)
+        return;
+    m_healthCheckInterval = healthCheckInterval;
+    if (m_healthCheckInterval <= 0)
+        m_healthTimer.stop();
+    else if (m_isConnected && !isSqlite())
+        m_healthTimer.start(m_healthCheckInterval);
+    emit healthCheckIntervalChanged();
+}
+
+/*!
+  \qmlproperty bool QmlSqlDatabase::autoReconnect
+  What happens when the connection is lost, which is noticed by a failed health check or by a query that
+  fails with a connection error. When \c true, the default, connectionLost() is emitted and the connection
+  is opened again like openAsync() does, retrying until it succeeds with the delay growing up to
+  maxRetryDelay. Once it is back reconnected() and connected() are emitted, so QmlSqlQueryModel objects
+  run their queries again.
+
+  A read that a worker thread was running when the connection was lost is replayed once on a fresh pooled
+  connection, statements that write are never replayed. A transaction that was open is lost and rolled
+  back by the server.
+
+  When \c false the state becomes Failed and the connection stays closed until open() is called.
+
+  \sa healthCheckInterval, reconnectCount, downtime
+*/
+bool QmlSqlDatabase::autoReconnect() const {
+    return m_autoReconnect;
+}
+
+void QmlSqlDatabase::setAutoReconnect(bool autoReconnect) {
+    if (m_autoReconnect == autoReconnect)
+        return;
+    m_autoReconnect = autoReconnect;
+    emit autoReconnectChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlDatabase::reconnectCount
+  How many times the connection has been opened again after it was lost.
+*/
+int QmlSqlDatabase::reconnectCount() const {
+    return m_reconnectCount;
+}
+
+/*!
+  \qmlproperty int QmlSqlDatabase::downtime
+  The time in milliseconds the connection has been lost for, summed over all outages that have ended.
+
+\code
+    Text {
+        text: db.reconnectCount + " reconnects, down for " + Math.round(db.downtime / 1000) + " s"
+    }
+\endcode
+*/
+int QmlSqlDatabase::downtime() const {
+    return int(qMin<qint64>(m_downtime, std::numeric_limits<int>::max()));
+}
+
+/*!
+ \brief QString QmlSqlDatabase::sqliteConnectOptions(SqliteProfile profile, const QString& connectOptions)
+ Returns \c connectOptions with the QSQLITE options \c profile needs added.
+ */
+QString QmlSqlDatabase::sqliteConnectOptions(SqliteProfile profile, const QString& connectOptions) {
+    if (profile != ReadOnlyMmap || connectOptions.contains("QSQLITE_OPEN_READONLY"))
+        return connectOptions;
+    return connectOptions.isEmpty() ? QString("QSQLITE_OPEN_READONLY") : connectOptions + ";QSQLITE_OPEN_READONLY";
+}
+
+/*!
+ \brief QString QmlSqlDatabase::timeoutConnectOptions(const QString& driverName, int connectTimeout, const QString& connectOptions)
+ Returns \c connectOptions with the connect timeout option of \c driverName set to \c connectTimeout
+ milliseconds, rounded up to whole seconds. Options that already set a timeout are left alone.
+ */
+QString QmlSqlDatabase::timeoutConnectOptions(const QString& driverName, int connectTimeout, const QString& connectOptions) {
+    QString option;
+    if (driverName == "QPSQL")
+        option = "connect_timeout";
+    else if (driverName == "QMYSQL")
+        option = "MYSQL_OPT_CONNECT_TIMEOUT";
+    else if (driverName == "QODBC")
+        option = "SQL_ATTR_LOGIN_TIMEOUT";
+
+    if (connectTimeout <= 0 || option.isEmpty() || connectOptions.contains(option))
+        return connectOptions;
+    const QString timeout = QString("%1=%2").arg(option).arg((connectTimeout + 999) / 1000);
+    return connectOptions.isEmpty() ? timeout : connectOptions + ";" + timeout;
+}
+
+/*!
+ \brief QStringList QmlSqlDatabase::sqlitePragmas(SqliteProfile profile)
+ Returns the PRAGMA statements that apply \c profile to a SQLite connection, page_size comes first as it
+ can not be changed once the database is in WAL mode.
+ */
+QStringList QmlSqlDatabase::sqlitePragmas(SqliteProfile profile) {
+    QStringList settings;
+    switch (profile) {
+    case DefaultProfile:
+        break;
+    case Durable:
+        settings << "page_size = 4096" << "journal_mode = WAL" << "synchronous = FULL" << "cache_size = -8192"
+                 << "mmap_size = 0" << "temp_store = DEFAULT" << "busy_timeout = 5000";
+        break;
+    case Balanced:
+        settings << "page_size = 4096" << "journal_mode = WAL" << "synchronous = NORMAL" << "cache_size = -32768"
+                 << "mmap_size = 67108864" << "temp_store = MEMORY" << "busy_timeout = 5000";
+        break;
+    case Fast:
+        settings << "page_size = 4096" << "journal_mode = WAL" << "synchronous = OFF" << "cache_size = -65536"
+                 << "mmap_size = 268435456" << "temp_store = MEMORY" << "busy_timeout = 1000";
+        break;
+    case ReadOnlyMmap:
+        settings << "cache_size = -16384" << "mmap_size = 1073741824" << "temp_store = MEMORY"
+                 << "busy_timeout = 5000" << "query_only = 1";
+        break;
+    }
+
+    QStringList pragmas;
+    foreach (const QString& setting, settings)
+        pragmas << "PRAGMA " + setting;
+    return pragmas;
+}
+
+/*!
+ \brief QVariantMap QmlSqlDatabase::readSqliteSettings(const QSqlDatabase& db)
+ Asks the SQLite connection \c db for the settings a sqliteProfile changes, synchronous and temp_store
+ by name.
+ */
+QVariantMap QmlSqlDatabase::readSqliteSettings(const QSqlDatabase& db) {
+    static const QStringList names = QStringList() << "journal_mode" << "synchronous" << "cache_size" << "mmap_size"
+                                                   << "page_size" << "temp_store" << "busy_timeout" << "query_only";
+    static const QStringList synchronous = QStringList() << "OFF" << "NORMAL" << "FULL" << "EXTRA";
+    static const QStringList tempStore = QStringList() << "DEFAULT" << "FILE" << "MEMORY";
+
+    QVariantMap settings;
+    foreach (const QString& name, names) {
+        QSqlQuery query(db);
+        if (!query.exec("PRAGMA " + name) || !query.next())
+            continue;
+        QVariant value = query.value(0);
+        if (name == "synchronous")
+            value = synchronous.value(value.toInt(), value.toString());
+        else if (name == "temp_store")
+            value = tempStore.value(value.toInt(), value.toString());
+        else if (name == "journal_mode")
+            value = value.toString().toUpper();
+        else if (name == "query_only")
+            value = value.toBool();
+        settings.insert(name, value);
+    }
+    return settings;
+}
+
 /*!
  \qmlmethod QmlSqlDatabase::addDataBase()
 Adds a database to the list of database connections using the driver type and the connection name connectionName.
@@ -306,28 +782,232 @@ the one replaced.
 
 */
 void QmlSqlDatabase::open() {
+    m_retryTimer.stop();
+    m_connectTimer.stop();
+    m_openTicket++;
+    m_openAttempt = 0;
+    setState(Connecting);
+    if (!openConnection())
+        setState(Failed);
+}
+
+/*!
+ \qmlmethod QmlSqlDatabase::openAsync()
+ Opens the connection like open() without blocking the calling thread while the host is being reached.
+ The attempt runs on a worker thread, once it succeeded the connection itself is opened on this thread
+ and connected() is emitted. An attempt that fails or takes longer than connectTimeout is retried up to
+ maxRetries times, waiting retryDelay and then twice as long after every further failure, up to
+ maxRetryDelay. state tells which of these steps the connection is at.
+
+ A SQLite database is a local file, it is opened right away.
+
+ \sa asyncOpen, state
+ */
+void QmlSqlDatabase::openAsync() {
+    m_retryTimer.stop();
+    m_connectTimer.stop();
+    m_openTicket++;
+    m_openAttempt = 0;
+    startOpenAttempt();
+}
+
+void QmlSqlDatabase::startOpenAttempt() {
+    setState(Connecting);
+    if (isSqlite()) {
+        if (!openConnection())
+            openFailed();
+        return;
+    }
+
+    startOpenWorker();
+    QmlSqlConnectionParams params;
+    params.connectionName = m_connectionName;
+    params.driverName = m_databaseDriverString;
+    params.databaseName = m_dbName;
+    params.hostName = m_source;
+    params.userName = m_user;
+    params.password = m_password;
+    params.port = m_port;
+    params.connectOptions = timeoutConnectOptions(m_databaseDriverString, m_connectTimeout, m_connectOptions);
+    if (m_connectTimeout > 0)
+        m_connectTimer.start(m_connectTimeout);
+    emit probeRequested(params, m_openTicket);
+}
+
+void QmlSqlDatabase::handleProbed(const QString& errorString, int ticket) {
+    if (ticket != m_openTicket)
+        return;
+
+    m_connectTimer.stop();
+    if (!errorString.isEmpty()) {
+        error(errorString);
+        openFailed();
+    }
+    else if (!openConnection()) {
+        openFailed();
+    }
+}
+
+void QmlSqlDatabase::handleConnectTimeout() {
+    // the attempt may still be running on the worker, its outcome is dropped and the retries get a thread
+    // of their own instead of queueing up behind it
+    m_openTicket++;
+    abandonOpenWorker();
+    error(QString("could not open connection %1 Reason: no answer within %2 ms").arg(m_connectionName).arg(m_connectTimeout));
+    openFailed();
+}
+
+// a lost connection is retried until it is back
+void QmlSqlDatabase::openFailed() {
+    if (!m_reconnecting && m_openAttempt >= m_maxRetries) {
+        setState(Failed);
+        return;
+    }
+
+    const qint64 delay = qint64(qMax(0, m_retryDelay)) << qMin(m_openAttempt, 20);
+    m_openAttempt++;
+    setState(Retrying);
+    m_retryTimer.start(int(qMin<qint64>(delay, qMax(0, m_maxRetryDelay))));
+}
+
+void QmlSqlDatabase::startOpenWorker() {
+    if (m_openThread != nullptr)
+        return;
+
+    qRegisterMetaType<QmlSqlConnectionParams>();
+
+    m_openThread = new QThread(this);
+    m_openWorker = new QmlSqlOpenWorker;
+    m_openWorker->moveToThread(m_openThread);
+    connect(m_openThread, SIGNAL(finished()), m_openWorker, SLOT(deleteLater()));
+    connect(this, SIGNAL(probeRequested(QmlSqlConnectionParams,int)), m_openWorker, SLOT(probe(QmlSqlConnectionParams,int)));
+    connect(m_openWorker, SIGNAL(probed(QString,int)), this, SLOT(handleProbed(QString,int)));
+    connect(this, SIGNAL(pingRequested(QmlSqlConnectionParams,int)), m_openWorker, SLOT(ping(QmlSqlConnectionParams,int)));
+    connect(m_openWorker, SIGNAL(pinged(QString,int)), this, SLOT(handlePinged(QString,int)));
+    m_openThread->start();
+}
+
+// the worker is stuck in a driver call that can not be interrupted, its thread is left to end and delete
+// itself whenever that call returns
+void QmlSqlDatabase::abandonOpenWorker() {
+    if (m_openThread == nullptr)
+        return;
+
+    disconnect(this, nullptr, m_openWorker, nullptr);
+    disconnect(m_openWorker, nullptr, this, nullptr);
+    m_openThread->setParent(nullptr);
+    connect(m_openThread, SIGNAL(finished()), m_openThread, SLOT(deleteLater()));
+    m_openThread->quit();
+    m_openThread = nullptr;
+    m_openWorker = nullptr;
+}
+
+bool QmlSqlDatabase::openConnection() {
+    QmlSqlStatementCache::instance()->invalidate(m_connectionName);
+    QmlSqlResultCache::instance()->invalidate(m_connectionName);
+    QmlSqlSchemaCache::instance()->invalidate(m_connectionName);
+    QmlSqlStatementCache::instance()->setCapacity(m_connectionName, m_statementCacheSize);
     db = QSqlDatabase::addDatabase(m_databaseDriverString, m_connectionName);
     db.setHostName(m_source);
     db.setDatabaseName(m_dbName);
     db.setUserName(m_user);
     db.setPassword(m_password);
     db.setPort(m_port);
+    db.setConnectOptions(isSqlite() ? sqliteConnectOptions(m_sqliteProfile, m_connectOptions)
+                                 : timeoutConnectOptions(m_databaseDriverString, m_connectTimeout, m_connectOptions));
     if (!db.open()) {
         sqlError(db.lastError());
         closeRequested(Error, m_connectionName);
         disconnected();
+        return false;
     }
-    else {
-        connectionOpened(db, m_connectionName);
-        m_isConnected = true;
-        connected();
+
+    if (isSqlite())
+        applySqliteProfile();
+    connectionOpened(db, m_connectionName);
+    // the driver is new or was closed, the tables models listen to are subscribed on it again
+    QmlSqlChangeNotifier::instance()->resubscribe(m_connectionName);
+    m_isConnected = true;
+    configurePool();
+    setState(Open);
+    if (m_reconnecting) {
+        m_reconnecting = false;
+        m_reconnectCount++;
+        m_downtime += m_downSince.elapsed();
+        emit reconnectCountChanged();
+        emit downtimeChanged();
+        emit reconnected();
     }
+    connected();
+    return true;
 }
 
-void QmlSqlDatabase::close() {
+void QmlSqlDatabase::checkHealth() {
+    if (!m_isConnected || m_state != Open)
+        return;
+    if (QmlSqlConnectionPool::instance()->stats(m_connectionName).value("inUse").toInt() > 0)
+        return;
+
+    startOpenWorker();
+    emit pingRequested(QmlSqlConnectionParams::fromConnection(m_connectionName), m_openTicket);
+}
+
+void QmlSqlDatabase::handlePinged(const QString& errorString, int ticket) {
+    if (ticket != m_openTicket || errorString.isEmpty())
+        return;
+    error(errorString);
+    startReconnect();
+}
+
+void QmlSqlDatabase::handleConnectionLost(const QString& connectionName) {
+    if (connectionName == m_connectionName)
+        startReconnect();
+}
+
+void QmlSqlDatabase::startReconnect() {
+    if (!m_isConnected)
+        return;
+
+    m_retryTimer.stop();
+    m_connectTimer.stop();
+    m_openTicket++;
+    releaseConnection();
+    m_reconnecting = m_autoReconnect;
+    m_downSince.start();
+    emit connectionLost();
+    disconnected();
+
+    if (!m_autoReconnect) {
+        setState(Failed);
+        return;
+    }
+    m_openAttempt = 0;
+    startOpenAttempt();
+}
+
+// closes the connection and its pooled clones, the connection itself stays registered
+void QmlSqlDatabase::releaseConnection() {
+    m_evictTimer.stop();
+    m_healthTimer.stop();
+    if (m_transactionDepth > 0)
+        QmlSqlChangeNotifier::instance()->rollbackTransaction(m_connectionName);
+    setTransactionDepth(0);
+    QmlSqlConnectionPool::instance()->remove(m_connectionName);
+    QmlSqlStatementCache::instance()->invalidate(m_connectionName);
+    QmlSqlResultCache::instance()->invalidate(m_connectionName);
+    QmlSqlSchemaCache::instance()->invalidate(m_connectionName);
     db.close();
-    QSqlDatabase::removeDatabase(m_connectionName);
     m_isConnected = false;
+}
+
+void QmlSqlDatabase::close() {
+    m_retryTimer.stop();
+    m_connectTimer.stop();
+    m_openTicket++;
+    m_reconnecting = false;
+    releaseConnection();
+    QSqlDatabase::removeDatabase(m_connectionName);
+    setState(Closed);
     disconnected();
 }
 
@@ -361,6 +1041,10 @@ QStringList QmlSqlDatabase::connectionNames() {
 void QmlSqlDatabase::removeDatabase(const QString& connectionName) {
     foreach (QString l, db.connectionNames()) {
         if (l == connectionName) {
+            QmlSqlConnectionPool::instance()->remove(connectionName);
+            QmlSqlStatementCache::instance()->invalidate(connectionName);
+            QmlSqlResultCache::instance()->invalidate(connectionName);
+            QmlSqlSchemaCache::instance()->invalidate(connectionName);
             QSqlDatabase::removeDatabase(connectionName);
         }
     }
@@ -369,36 +1053,264 @@ void QmlSqlDatabase::removeDatabase(const QString& connectionName) {
 
 void QmlSqlDatabase::closeAllConnections() {
     foreach (QString l, db.connectionNames()) {
+        // pooled clones belong to their threads, the pool closes them there
+        if (l.contains('@'))
+            continue;
+        QmlSqlConnectionPool::instance()->remove(l);
+        QmlSqlStatementCache::instance()->invalidate(l);
+        QmlSqlResultCache::instance()->invalidate(l);
+        QmlSqlSchemaCache::instance()->invalidate(l);
         QSqlDatabase::removeDatabase(l);
     }
 }
 
 /*!
- \qmlmethod variant QmlSqlDatabase::tables(string connectionName)
+ \qmlmethod variant QmlSqlDatabase::tables(string connectionName, enum tableType)
 
- This returns a list of all the table names on a connection point by there connecitonName
+ Returns the names of the tables of \c tableType on the connection \c connectionName. The names are
+ read once and then taken from QmlSqlSchemaCache until the schema changes.
 
  \b{Note:} This is in alpha and subject to change.
 
  */
 QStringList QmlSqlDatabase::tables(const QString& connectionName,const TableType& tableType) {
-    QStringList li;
+    if (!QSqlDatabase::contains(connectionName)) {
+        error(QString("could not find database connection with the  connectionName of %1").arg(connectionName)) ;
+        return QStringList();
+    }
+
+    return QmlSqlSchemaCache::instance()->tables(QSqlDatabase::database(connectionName, false), setTableType(tableType));
+}
+
+/*!
+ \qmlmethod variant QmlSqlDatabase::poolStats()
+
+ Returns the usage counters of the connection pool behind connectionName: \c inUse and \c idle connections,
+ the number of \c open connections, how many times a thread had to \c wait for a free connection and the
+ total \c waitTime in milliseconds.
+ */
+QVariantMap QmlSqlDatabase::poolStats() const {
+    return QmlSqlConnectionPool::instance()->stats(m_connectionName);
+}
 
-    for(int i = 0 ; i < db.connectionNames().length(); i++) {
-        if (db.connectionNames().at(i) == connectionName) {
-            li = db.tables(setTableType(tableType));
+/*!
+ \qmlmethod variant QmlSqlDatabase::statementCacheStats()
+
+ Returns the number of \c hits and \c misses of the prepared statement cache of connectionName, how many
+ statements are \c cached right now and its \c capacity.
+
+ \sa statementCacheSize
+ */
+QVariantMap QmlSqlDatabase::statementCacheStats() const {
+    return QmlSqlStatementCache::instance()->stats(m_connectionName);
+}
+
+/*!
+ \qmlproperty int QmlSqlDatabase::transactionDepth
+ Returns how many transactions started with transaction() are open on connectionName, 0 if there is none.
+ Every level above 1 is a savepoint inside the outer transaction.
+
+ \sa inTransaction, transaction()
+ */
+int QmlSqlDatabase::transactionDepth() const {
+    return m_transactionDepth;
+}
+
+/*!
+ \qmlproperty bool QmlSqlDatabase::inTransaction
+ Returns \c true while a transaction started with transaction() is open.
+
+ A QmlSqlQuery that runs on connectionName while a transaction is open becomes part of it, including one
+ that is \c async or calls execBatch(), which then runs on this connection instead of a worker thread.
+ */
+bool QmlSqlDatabase::inTransaction() const {
+    return m_transactionDepth > 0;
+}
+
+void QmlSqlDatabase::setTransactionDepth(int transactionDepth) {
+    if (m_transactionDepth == transactionDepth)
+        return;
+    m_transactionDepth = transactionDepth;
+    emit transactionDepthChanged();
+}
+
+QString QmlSqlDatabase::savepointName(int depth) const {
+    return QString("qmlsql_savepoint_%1").arg(depth);
+}
+
+/*!
+ \qmlmethod bool QmlSqlDatabase::transaction()
+ Begins a transaction on connectionName. Statements no longer commit one by one, which on SQLite saves a
+ sync to disk for every write. Calling transaction() again while one is open creates a savepoint, so
+ the inner work can be rolled back on its own.
+
+ Returns \c true on success, otherwise errorString holds the reason.
+
+ \sa commit(), rollback(), withTransaction()
+ */
+bool QmlSqlDatabase::transaction() {
+    if (!m_isConnected) {
+        error("could not begin a transaction Reason: the database is not open");
+        return false;
+    }
+
+    if (m_transactionDepth == 0) {
+        if (!db.transaction()) {
+            sqlError(db.lastError());
+            return false;
         }
-        else {
-            li = QStringList();
-            error(QString("could not find database connection with the  connectionName of %1").arg(connectionName)) ;
+        QmlSqlChangeNotifier::instance()->beginTransaction(m_connectionName);
+    }
+    else {
+        QSqlQuery savepoint(db);
+        if (!savepoint.exec(QString("SAVEPOINT %1").arg(savepointName(m_transactionDepth)))) {
+            sqlError(savepoint.lastError());
+            return false;
         }
     }
+    setTransactionDepth(m_transactionDepth + 1);
+    return true;
+}
 
-    return li;
+/*!
+ \qmlmethod bool QmlSqlDatabase::commit()
+ Commits the innermost open transaction. For a savepoint this releases it into the outer transaction,
+ the changes are only written once the outermost transaction is committed.
+
+ \sa transaction(), rollback()
+ */
+bool QmlSqlDatabase::commit() {
+    if (m_transactionDepth == 0) {
+        error("could not commit Reason: there is no open transaction");
+        return false;
+    }
+
+    if (m_transactionDepth == 1) {
+        if (!db.commit()) {
+            sqlError(db.lastError());
+            return false;
+        }
+        QmlSqlChangeNotifier::instance()->commitTransaction(m_connectionName);
+    }
+    else {
+        QSqlQuery savepoint(db);
+        if (!savepoint.exec(QString("RELEASE SAVEPOINT %1").arg(savepointName(m_transactionDepth - 1)))) {
+            sqlError(savepoint.lastError());
+            return false;
+        }
+    }
+    setTransactionDepth(m_transactionDepth - 1);
+    return true;
+}
+
+/*!
+ \qmlmethod bool QmlSqlDatabase::rollback()
+ Rolls back the innermost open transaction. For a savepoint only the changes made since the matching
+ transaction() call are undone.
+
+ \sa transaction(), commit()
+ */
+bool QmlSqlDatabase::rollback() {
+    if (m_transactionDepth == 0) {
+        error("could not roll back Reason: there is no open transaction");
+        return false;
+    }
+
+    bool ok = true;
+    if (m_transactionDepth == 1) {
+        if (!db.rollback()) {
+            sqlError(db.lastError());
+            ok = false;
+        }
+        QmlSqlChangeNotifier::instance()->rollbackTransaction(m_connectionName);
+    }
+    else {
+        const QString name = savepointName(m_transactionDepth - 1);
+        QSqlQuery savepoint(db);
+        if (!savepoint.exec(QString("ROLLBACK TO SAVEPOINT %1").arg(name))
+                || !savepoint.exec(QString("RELEASE SAVEPOINT %1").arg(name))) {
+            sqlError(savepoint.lastError());
+            ok = false;
+        }
+    }
+    // the level is gone either way, a failed rollback leaves nothing that could still be committed
+    setTransactionDepth(m_transactionDepth - 1);
+    return ok;
+}
+
+/*!
+ \qmlmethod bool QmlSqlDatabase::withTransaction(function callback)
+ Runs \c callback inside transaction(). The transaction is committed when \c callback returns and rolled
+ back when it throws or returns \c false. Calls can be nested, the inner ones use savepoints.
+
+ Returns \c true if the transaction was committed.
+
+\code
+    db.withTransaction(function() {
+        insertQuery.execWithQuery(db.connectionName, "INSERT INTO log (text) VALUES ('one')")
+        insertQuery.execWithQuery(db.connectionName, "INSERT INTO log (text) VALUES ('two')")
+    })
+\endcode
+ */
+bool QmlSqlDatabase::withTransaction(QJSValue callback) {
+    if (!callback.isCallable()) {
+        error("withTransaction needs a function");
+        return false;
+    }
+    if (!transaction())
+        return false;
+
+    QJSValue result = callback.call();
+    if (result.isError() || (result.isBool() && !result.toBool())) {
+        if (result.isError())
+            error(result.toString());
+        rollback();
+        return false;
+    }
+    return commit();
+}
+
+void QmlSqlDatabase::configurePool() {
+    if (!m_isConnected)
+        return;
+
+    QmlSqlConnectionParams params = QmlSqlConnectionParams::fromConnection(m_connectionName);
+    if (isSqlite())
+        params.initStatements = sqlitePragmas(m_sqliteProfile);
+    QmlSqlConnectionPool::instance()->configure(params, m_minConnections, m_maxConnections, m_idleTimeout);
+    m_evictTimer.start(qMax(1000, m_idleTimeout / 2));
+    if (m_healthCheckInterval > 0 && !isSqlite())
+        m_healthTimer.start(m_healthCheckInterval);
+}
+
+bool QmlSqlDatabase::isSqlite() const {
+    return m_databaseDriverString == "QSQLITE";
+}
+
+// a PRAGMA SQLite does not know is ignored, one that fails only sets errorString
+void QmlSqlDatabase::applySqliteProfile() {
+    foreach (const QString& pragma, sqlitePragmas(m_sqliteProfile)) {
+        QSqlQuery query(db);
+        if (!query.exec(pragma))
+            error(QString("could not apply %1 Reason: %2").arg(pragma).arg(query.lastError().text()));
+    }
+
+    const QVariantMap settings = readSqliteSettings(db);
+    if (m_sqliteSettings == settings)
+        return;
+    m_sqliteSettings = settings;
+    emit sqliteSettingsChanged();
+}
+
+void QmlSqlDatabase::evictIdleConnections() {
+    QmlSqlConnectionPool::instance()->evictIdle(m_connectionName);
 }
 
 void QmlSqlDatabase::componentComplete() {
-    open();
+    if (m_asyncOpen)
+        openAsync();
+    else
+        open();
 }
 
 void QmlSqlDatabase::handleError(const QString& err) {
@@ -430,6 +1342,8 @@ void QmlSqlDatabase::handleSqlError(const QSqlError& err) {
             .arg(err.databaseText())
                  ;
     error(er) ;
+    if (QmlSqlConnectionPool::isConnectionError(err))
+        startReconnect();
 }
 
 QSql::TableType QmlSqlDatabase::setTableType(const QmlSqlDatabase::TableType& type) {
@@ -6,6 +6,14 @@
 #include <QVariant>
 #include <QDebug>
 #include <QQmlParserStatus>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVariantMap>
+#include <QJSValue>
+
+#include "qmlsqlconnectionpool.h"
+
+class QmlSqlOpenWorker;
 
 class QmlSqlDatabase : public QObject, public QQmlParserStatus
 {
@@ -21,15 +29,46 @@ class QmlSqlDatabase : public QObject, public QQmlParserStatus
     Q_PROPERTY(QString  errorString READ errorString NOTIFY errorStringChanged)
     Q_PROPERTY(DataBaseDriver databaseDriver READ databaseDriver WRITE setDatabaseDriver NOTIFY databaseDriverChanged)
     Q_PROPERTY(QStringList databaseDriverList READ databaseDriverList NOTIFY databaseDriverListChanged)
+    Q_PROPERTY(int minConnections READ minConnections WRITE setMinConnections NOTIFY minConnectionsChanged)
+    Q_PROPERTY(int maxConnections READ maxConnections WRITE setMaxConnections NOTIFY maxConnectionsChanged)
+    Q_PROPERTY(int idleTimeout READ idleTimeout WRITE setIdleTimeout NOTIFY idleTimeoutChanged)
+    Q_PROPERTY(int statementCacheSize READ statementCacheSize WRITE setStatementCacheSize NOTIFY statementCacheSizeChanged)
+    Q_PROPERTY(int transactionDepth READ transactionDepth NOTIFY transactionDepthChanged)
+    Q_PROPERTY(bool inTransaction READ inTransaction NOTIFY transactionDepthChanged)
+    Q_PROPERTY(QString connectOptions READ connectOptions WRITE setConnectOptions NOTIFY connectOptionsChanged)
+    Q_PROPERTY(SqliteProfile sqliteProfile READ sqliteProfile WRITE setSqliteProfile NOTIFY sqliteProfileChanged)
+    Q_PROPERTY(QVariantMap sqliteSettings READ sqliteSettings NOTIFY sqliteSettingsChanged)
+    Q_PROPERTY(bool asyncOpen READ asyncOpen WRITE setAsyncOpen NOTIFY asyncOpenChanged)
+    Q_PROPERTY(int connectTimeout READ connectTimeout WRITE setConnectTimeout NOTIFY connectTimeoutChanged)
+    Q_PROPERTY(int maxRetries READ maxRetries WRITE setMaxRetries NOTIFY maxRetriesChanged)
+    Q_PROPERTY(int retryDelay READ retryDelay WRITE setRetryDelay NOTIFY retryDelayChanged)
+    Q_PROPERTY(int maxRetryDelay READ maxRetryDelay WRITE setMaxRetryDelay NOTIFY maxRetryDelayChanged)
+    Q_PROPERTY(State state READ state NOTIFY stateChanged)
+    Q_PROPERTY(int healthCheckInterval READ healthCheckInterval WRITE setHealthCheckInterval NOTIFY healthCheckIntervalChanged)
+    Q_PROPERTY(bool autoReconnect READ autoReconnect WRITE setAutoReconnect NOTIFY autoReconnectChanged)
+    Q_PROPERTY(int reconnectCount READ reconnectCount NOTIFY reconnectCountChanged)
+    Q_PROPERTY(int downtime READ downtime NOTIFY downtimeChanged)
     Q_ENUMS(DataBaseDriver)
     Q_ENUMS(TableTypes)
+    Q_ENUMS(SqliteProfile)
+    Q_ENUMS(State)
 
 public:
     explicit QmlSqlDatabase(QObject *parent = nullptr);
+    ~QmlSqlDatabase();
 
     enum TableType{ Tables, SystemTables, Views, AllTables };
     enum DataBaseDriver{ Postgres, MySql, OCI, ODBC, DB2, TDS, SQLite, SQLite2, IBase };
     enum CloseReason{ Error, Requested, Unknown  };
+    enum SqliteProfile{ DefaultProfile, Durable, Balanced, Fast, ReadOnlyMmap };
+    enum State{ Closed, Connecting, Open, Retrying, Failed };
+
+    static QStringList availableDrivers();
+    static QString timeoutConnectOptions(const QString& driverName, int connectTimeout, const QString& connectOptions);
+
+    static QString sqliteConnectOptions(SqliteProfile profile, const QString& connectOptions);
+    static QStringList sqlitePragmas(SqliteProfile profile);
+    static QVariantMap readSqliteSettings(const QSqlDatabase& db);
 
     DataBaseDriver databaseDriver()const;
     void setDatabaseDriver(const DataBaseDriver& databaseDriver);
@@ -57,11 +96,66 @@ public:
     QString connectionName() const;
     void setConnectionName(const QString& connectionName);
 
+    int minConnections() const;
+    void setMinConnections(int minConnections);
+
+    int maxConnections() const;
+    void setMaxConnections(int maxConnections);
+
+    int idleTimeout() const;
+    void setIdleTimeout(int idleTimeout);
+
+    int statementCacheSize() const;
+    void setStatementCacheSize(int statementCacheSize);
+
+    int transactionDepth() const;
+    bool inTransaction() const;
+
+    QString connectOptions() const;
+    void setConnectOptions(const QString& connectOptions);
+
+    SqliteProfile sqliteProfile() const;
+    void setSqliteProfile(const SqliteProfile& sqliteProfile);
+
+    QVariantMap sqliteSettings() const;
+
+    bool asyncOpen() const;
+    void setAsyncOpen(bool asyncOpen);
+
+    int connectTimeout() const;
+    void setConnectTimeout(int connectTimeout);
+
+    int maxRetries() const;
+    void setMaxRetries(int maxRetries);
+
+    int retryDelay() const;
+    void setRetryDelay(int retryDelay);
+
+    int maxRetryDelay() const;
+    void setMaxRetryDelay(int maxRetryDelay);
+
+    State state() const;
+
+    int healthCheckInterval() const;
+    void setHealthCheckInterval(int healthCheckInterval);
+
+    bool autoReconnect() const;
+    void setAutoReconnect(bool autoReconnect);
+
+    int reconnectCount() const;
+    int downtime() const;
 
     Q_INVOKABLE QStringList connectionNames();
     Q_INVOKABLE void removeDatabase(const QString& connectionName);
     Q_INVOKABLE void closeAllConnections();
     Q_INVOKABLE QStringList tables(const QString& connectionName,const TableType& tableType);
+    Q_INVOKABLE QVariantMap poolStats() const;
+    Q_INVOKABLE QVariantMap statementCacheStats() const;
+
+    Q_INVOKABLE bool transaction();
+    Q_INVOKABLE bool commit();
+    Q_INVOKABLE bool rollback();
+    Q_INVOKABLE bool withTransaction(QJSValue callback);
 
     // QQmlParserStatus interface
     void classBegin() {}
@@ -77,9 +171,29 @@ signals:
     void databaseDriverChanged();
     void databaseDriverListChanged();
     void errorStringChanged();
+    void minConnectionsChanged();
+    void maxConnectionsChanged();
+    void idleTimeoutChanged();
+    void statementCacheSizeChanged();
+    void transactionDepthChanged();
+    void connectOptionsChanged();
+    void sqliteProfileChanged();
+    void sqliteSettingsChanged();
+    void asyncOpenChanged();
+    void connectTimeoutChanged();
+    void maxRetriesChanged();
+    void retryDelayChanged();
+    void maxRetryDelayChanged();
+    void stateChanged();
+    void healthCheckIntervalChanged();
+    void autoReconnectChanged();
+    void reconnectCountChanged();
+    void downtimeChanged();
 
     void connected();
     void disconnected();
+    void connectionLost();
+    void reconnected();
 
     //INTERNAL
     void error(QString);
@@ -87,14 +201,26 @@ signals:
     void connectionOpened(QSqlDatabase, QString);
     void closeRequested(CloseReason, QString);
     void sqlError(QSqlError);
+    void probeRequested(const QmlSqlConnectionParams& params, int ticket);
+    void pingRequested(const QmlSqlConnectionParams& params, int ticket);
 
 public slots:
     void open();
+    void openAsync();
     void close();
     void handleError(const QString& err);
     void handleOpened(QSqlDatabase database, const QString& connectionName);
     void handleCloseRequested(const CloseReason& reason, const QString& connectionName);
     void handleSqlError(const QSqlError& err);
+    void evictIdleConnections();
+
+private slots:
+    void startOpenAttempt();
+    void handleProbed(const QString& errorString, int ticket);
+    void handleConnectTimeout();
+    void checkHealth();
+    void handlePinged(const QString& errorString, int ticket);
+    void handleConnectionLost(const QString& connectionName);
 
 private:
     bool m_isConnected;
@@ -112,6 +238,47 @@ private:
 
     QString m_errorString;
 
+    int m_minConnections;
+    int m_maxConnections;
+    int m_idleTimeout;
+    int m_statementCacheSize;
+    int m_transactionDepth;
+    QTimer m_evictTimer;
+    QString m_connectOptions;
+    SqliteProfile m_sqliteProfile;
+    QVariantMap m_sqliteSettings;
+    bool m_asyncOpen;
+    int m_connectTimeout;
+    int m_maxRetries;
+    int m_retryDelay;
+    int m_maxRetryDelay;
+    State m_state;
+    int m_openTicket;
+    int m_openAttempt;
+    QTimer m_retryTimer;
+    QTimer m_connectTimer;
+    QThread* m_openThread;
+    QmlSqlOpenWorker* m_openWorker;
+    int m_healthCheckInterval;
+    bool m_autoReconnect;
+    bool m_reconnecting;
+    int m_reconnectCount;
+    qint64 m_downtime;
+    QElapsedTimer m_downSince;
+    QTimer m_healthTimer;
+
+    bool openConnection();
+    void openFailed();
+    void startOpenWorker();
+    void abandonOpenWorker();
+    void releaseConnection();
+    void startReconnect();
+    void setState(State state);
+    void configurePool();
+    bool isSqlite() const;
+    void applySqliteProfile();
+    void setTransactionDepth(int transactionDepth);
+    QString savepointName(int depth) const;
     QSql::TableType setTableType(const QmlSqlDatabase::TableType& type);
     QString closeReasonToString(const CloseReason& cR);
 
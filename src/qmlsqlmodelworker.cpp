@@ -0,0 +1,186 @@
+#include "qmlsqlmodelworker.h"
+#include "qmlsqlstats.h"
+
+QmlSqlModelWorker::QmlSqlModelWorker(QObject *parent)
+    : QObject(parent), m_ticket(0)
+{
+}
+
+QmlSqlModelWorker::~QmlSqlModelWorker() {
+    QmlSqlConnectionPool::instance()->removeThreadConnections();
+}
+
+void QmlSqlModelWorker::setTicket(int ticket) {
+    m_ticket.store(ticket);
+}
+
+/*!
+ \brief void QmlSqlModelWorker::cancel(int upTo)
+ Aborts the statement of the fetch or refresh with a ticket up to \c upTo if it is still running, see
+ QmlSqlCanceller. The model hands out a new ticket first, so nothing more is read.
+ */
+void QmlSqlModelWorker::cancel(int upTo) {
+    m_canceller.cancel(upTo);
+}
+
+bool QmlSqlModelWorker::isCurrent(int ticket) const {
+    return m_ticket.load() == ticket;
+}
+
+/*!
+ \brief void QmlSqlModelWorker::fetch(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, int batchSize, int ticket)
+ Runs \c query with \c bindValues forward only on this thread's pooled connection and hands the rows back in batches of
+ \c batchSize. Every signal carries \c ticket so the model can drop the output of a fetch that has been
+ superseded by a newer exec().
+ */
+void QmlSqlModelWorker::fetch(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, int batchSize, int ticket) {
+    if (!isCurrent(ticket))
+        return;
+
+    QmlSqlConnectionPool* pool = QmlSqlConnectionPool::instance();
+    QSqlDatabase db = pool->acquire(params);
+    if (!db.isValid()) {
+        emit finished(QString("could not get a connection for the connectionName of %1").arg(params.connectionName), ticket);
+        return;
+    }
+
+    QString errorString;
+    if (!db.isOpen())
+        errorString = QString("could not open connection %1 Reason: %2").arg(params.connectionName).arg(db.lastError().text());
+    else if (m_canceller.begin(db, ticket)) {
+        errorString = fetchRows(db, query, bindValues, batchSize, ticket);
+        m_canceller.end();
+    }
+    pool->release(db);
+
+    if (isCurrent(ticket))
+        emit finished(errorString, ticket);
+}
+
+/*!
+ \brief void QmlSqlModelWorker::refresh(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, const QmlSqlResultSet& current, const QString& keyColumn, int ticket)
+ Runs \c query like fetch() but reads all rows before it compares them with the \c current rows of the
+ model by \c keyColumn. The new rows and the diff are handed back with diffReady(), so the model only
+ has to apply the diff.
+ */
+void QmlSqlModelWorker::refresh(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, const QmlSqlResultSet& current, const QString& keyColumn, int ticket) {
+    if (!isCurrent(ticket))
+        return;
+
+    QmlSqlConnectionPool* pool = QmlSqlConnectionPool::instance();
+    QSqlDatabase db = pool->acquire(params);
+    if (!db.isValid()) {
+        emit finished(QString("could not get a connection for the connectionName of %1").arg(params.connectionName), ticket);
+        return;
+    }
+
+    QString errorString;
+    QmlSqlResultSet rows;
+    if (!db.isOpen())
+        errorString = QString("could not open connection %1 Reason: %2").arg(params.connectionName).arg(db.lastError().text());
+    else if (m_canceller.begin(db, ticket)) {
+        errorString = readRows(db, query, bindValues, &rows);
+        m_canceller.end();
+    }
+    pool->release(db);
+
+    if (!isCurrent(ticket))
+        return;
+    if (errorString.isEmpty())
+        emit diffReady(rows, QmlSqlRowDiff::compute(current, rows, rows.columnIndex(keyColumn)), ticket);
+    emit finished(errorString, ticket);
+}
+
+// returns the error text, or an empty string on success or when the fetch was superseded. A query that
+// fails because the connection was lost is replayed once, nothing has been handed to the model yet.
+QString QmlSqlModelWorker::fetchRows(const QSqlDatabase& db, const QString& query, const QVariant& bindValues, int batchSize, int ticket, bool replay) {
+    QmlSqlStats::Sample sample(db.connectionName(), query);
+    QSqlQuery db_query(db);
+    db_query.setForwardOnly(true);
+    db_query.prepare(query);
+    QmlSqlQueryWorker::bind(db_query, bindValues);
+    sample.prepared();
+    if (!db_query.exec()) {
+        const QSqlError error = db_query.lastError();
+        sample.failed();
+        sample.executed();
+        QmlSqlStats::instance()->record(sample);
+        db_query.finish();
+        if (replay && QmlSqlQueryWorker::recoverConnection(db, query, error))
+            return fetchRows(db, query, bindValues, batchSize, ticket, false);
+        return QString("could not run query of %1 Reason: %2").arg(query).arg(error.text());
+    }
+    sample.executed();
+
+    const QmlSqlResultSet columns(db_query.record());
+    emit columnsReady(columns, ticket);
+
+    batchSize = qMax(1, batchSize);
+    QmlSqlResultSet rows = columns;
+    int rowCount = 0;
+    qint64 bytes = 0;
+    while (db_query.next()) {
+        rows.appendRow(db_query);
+
+        if (rows.rowCount() >= batchSize) {
+            if (!isCurrent(ticket))
+                return QString();
+            rowCount += rows.rowCount();
+            bytes += rows.byteSize();
+            emit batchReady(rows, ticket);
+            rows = columns;
+        }
+    }
+
+    if (!isCurrent(ticket))
+        return QString();
+    if (rows.rowCount() > 0) {
+        rowCount += rows.rowCount();
+        bytes += rows.byteSize();
+        emit batchReady(rows, ticket);
+    }
+
+    sample.fetched(rowCount, bytes);
+    if (db_query.lastError().type() != QSqlError::NoError)
+        sample.failed();
+    QmlSqlStats::instance()->record(sample);
+    QmlSqlStats::instance()->checkPlan(db, sample, bindValues);
+
+    if (db_query.lastError().type() != QSqlError::NoError)
+        return db_query.lastError().text();
+    return QString();
+}
+
+QString QmlSqlModelWorker::readRows(const QSqlDatabase& db, const QString& query, const QVariant& bindValues, QmlSqlResultSet* rows, bool replay) {
+    QmlSqlStats::Sample sample(db.connectionName(), query);
+    QSqlQuery db_query(db);
+    db_query.setForwardOnly(true);
+    db_query.prepare(query);
+    QmlSqlQueryWorker::bind(db_query, bindValues);
+    sample.prepared();
+    if (!db_query.exec()) {
+        const QSqlError error = db_query.lastError();
+        sample.failed();
+        sample.executed();
+        QmlSqlStats::instance()->record(sample);
+        db_query.finish();
+        if (replay && QmlSqlQueryWorker::recoverConnection(db, query, error))
+            return readRows(db, query, bindValues, rows, false);
+        return QString("could not run query of %1 Reason: %2").arg(query).arg(error.text());
+    }
+    sample.executed();
+
+    *rows = QmlSqlResultSet(db_query.record());
+    while (db_query.next())
+        rows->appendRow(db_query);
+
+    sample.fetched(rows->rowCount(), rows->byteSize());
+    if (db_query.lastError().type() != QSqlError::NoError)
+        sample.failed();
+    QmlSqlStats::instance()->record(sample);
+    QmlSqlStats::instance()->checkPlan(db, sample, bindValues);
+
+    if (db_query.lastError().type() != QSqlError::NoError)
+        return db_query.lastError().text();
+    return QString();
+}
@@ -0,0 +1,46 @@
+#ifndef QMLSQLMODELWORKER_H
+#define QMLSQLMODELWORKER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QVariant>
+#include <QStringList>
+
+#include "qmlsqlqueryworker.h"
+#include "qmlsqlrowdiff.h"
+#include "qmlsqlcanceller.h"
+
+class QmlSqlModelWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QmlSqlModelWorker(QObject *parent = nullptr);
+    ~QmlSqlModelWorker();
+
+    // thread safe, a fetch whose ticket is no longer current stops at the next batch
+    void setTicket(int ticket);
+    // thread safe, must be called from the thread that owns the named connection
+    void cancel(int upTo);
+
+signals:
+    // columns has no rows, only the names and types of the columns
+    void columnsReady(const QmlSqlResultSet& columns, int ticket);
+    void batchReady(const QmlSqlResultSet& rows, int ticket);
+    void diffReady(const QmlSqlResultSet& rows, const QmlSqlRowDiff& diff, int ticket);
+    void finished(const QString& errorString, int ticket);
+
+public slots:
+    void fetch(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, int batchSize, int ticket);
+    void refresh(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, const QmlSqlResultSet& current, const QString& keyColumn, int ticket);
+
+private:
+    bool isCurrent(int ticket) const;
+    QString fetchRows(const QSqlDatabase& db, const QString& query, const QVariant& bindValues, int batchSize, int ticket, bool replay = true);
+    QString readRows(const QSqlDatabase& db, const QString& query, const QVariant& bindValues, QmlSqlResultSet* rows, bool replay = true);
+
+    QAtomicInt m_ticket;
+    QmlSqlCanceller m_canceller;
+};
+
+#endif // QMLSQLMODELWORKER_H
@@ -0,0 +1,79 @@
+#include "qmlsqlopenworker.h"
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+QmlSqlOpenWorker::QmlSqlOpenWorker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+// runs on the worker thread once it has finished, so the clone used by ping() is removed by its own thread
+QmlSqlOpenWorker::~QmlSqlOpenWorker() {
+    QmlSqlConnectionPool::instance()->removeThreadConnections();
+}
+
+/*!
+ \brief QString QmlSqlOpenWorker::pingStatement(const QString& driverName)
+ Returns the cheapest statement the server behind \c driverName answers.
+ */
+QString QmlSqlOpenWorker::pingStatement(const QString& driverName) {
+    if (driverName == "QOCI")
+        return "SELECT 1 FROM DUAL";
+    if (driverName == "QDB2")
+        return "SELECT 1 FROM SYSIBM.SYSDUMMY1";
+    if (driverName == "QIBASE")
+        return "SELECT 1 FROM RDB$DATABASE";
+    return "SELECT 1";
+}
+
+/*!
+ \brief void QmlSqlOpenWorker::probe(const QmlSqlConnectionParams& params, int ticket)
+ Opens and closes a connection with \c params and reports the outcome with probed(). \c ticket is handed
+ back so the database can drop the outcome of an attempt that has timed out or been superseded.
+ */
+void QmlSqlOpenWorker::probe(const QmlSqlConnectionParams& params, int ticket) {
+    const QString name = QString("%1@probe%2").arg(params.connectionName).arg(ticket);
+    QString errorString;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(params.driverName, name);
+        db.setHostName(params.hostName);
+        db.setDatabaseName(params.databaseName);
+        db.setUserName(params.userName);
+        db.setPassword(params.password);
+        db.setPort(params.port);
+        db.setConnectOptions(params.connectOptions);
+        if (!db.open())
+            errorString = QString("could not open connection %1 Reason: %2").arg(params.connectionName).arg(db.lastError().text());
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+    emit probed(errorString, ticket);
+}
+
+/*!
+ \brief void QmlSqlOpenWorker::ping(const QmlSqlConnectionParams& params, int ticket)
+ Runs pingStatement() on this thread's pooled connection for \c params and reports the outcome with
+ pinged(). When every pooled connection is in use the connection is busy rather than idle and the check
+ is skipped.
+ */
+void QmlSqlOpenWorker::ping(const QmlSqlConnectionParams& params, int ticket) {
+    QmlSqlConnectionPool* pool = QmlSqlConnectionPool::instance();
+    QSqlDatabase db = pool->acquire(params, 0);
+    if (!db.isValid()) {
+        emit pinged(QString(), ticket);
+        return;
+    }
+
+    QString errorString;
+    if (!db.isOpen()) {
+        errorString = QString("could not open connection %1 Reason: %2").arg(params.connectionName).arg(db.lastError().text());
+    }
+    else {
+        QSqlQuery query(db);
+        if (!query.exec(pingStatement(params.driverName)))
+            errorString = QString("lost connection %1 Reason: %2").arg(params.connectionName).arg(query.lastError().text());
+    }
+    pool->release(db);
+    emit pinged(errorString, ticket);
+}
@@ -0,0 +1,37 @@
+#ifndef QMLSQLOPENWORKER_H
+#define QMLSQLOPENWORKER_H
+
+#include <QObject>
+#include <QString>
+
+#include "qmlsqlconnectionpool.h"
+
+/*!
+ * \brief The QmlSqlOpenWorker class
+ * Tries to open a connection on its own thread, so a slow or unreachable host does not block the
+ * thread of the QmlSqlDatabase that asked for it. A QSqlDatabase can not be handed to another thread,
+ * so the connection is only used to find out whether the host can be reached and then closed again.
+ * It also runs the health checks of an open connection on a pooled clone.
+ */
+class QmlSqlOpenWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QmlSqlOpenWorker(QObject *parent = nullptr);
+    ~QmlSqlOpenWorker();
+
+    static QString pingStatement(const QString& driverName);
+
+signals:
+    // errorString is empty when the connection could be opened
+    void probed(const QString& errorString, int ticket);
+    // errorString is empty when the connection is alive
+    void pinged(const QString& errorString, int ticket);
+
+public slots:
+    void probe(const QmlSqlConnectionParams& params, int ticket);
+    void ping(const QmlSqlConnectionParams& params, int ticket);
+};
+
+#endif // QMLSQLOPENWORKER_H
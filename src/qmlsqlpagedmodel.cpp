@@ -0,0 +1,477 @@
+#include "qmlsqlpagedmodel.h"
+#include "qmlsqldatabase.h"
+#include "qmlsqlstatementcache.h"
+#include <QSqlDriver>
+#include <QSqlRecord>
+#include <QMetaObject>
+#include <limits>
+
+/*!
+   \qmltype QmlSqlPagedModel
+   \inqmlmodule QmlSql 1.0
+   \ingroup QmlSql
+   \inherits QAbstractListModel
+   \brief The QmlSqlPagedModel object shows a very large table page by page.
+
+QmlSqlPagedModel reads tableName in pages of pageSize rows ordered by keyColumn. A page is read with
+\c{WHERE key > last ORDER BY key LIMIT pageSize}, starting after the last key of the page before it
+(or before the first key of the page after it), so reading a page costs the same no matter how far down
+the table it is. Only maxPages pages are kept, the ones used least recently are dropped.
+
+count starts out as an estimate taken from the statistics of the database (PostgreSQL and MySQL), or
+from the smallest and largest key when the key is a number, so views get a usable scroll bar without a
+\c{SELECT COUNT(*)} over the whole table. Once the last page has been read count is exact. When a view
+jumps to a page that has no loaded page next to it the page is placed by the same estimate, so rows
+found that way are where they would be if the keys were spread evenly. For keys that are not numbers
+the model falls back to OFFSET for such jumps.
+
+keyColumn has to be unique and should be indexed, the statements use \c LIMIT, which SQLite,
+PostgreSQL and MySQL understand.
+
+\code
+    ListView{
+        model: QmlSqlPagedModel{
+            database: db
+            tableName: "events"
+            keyColumn: "id"
+            columns: [ "id", "created", "message" ]
+        }
+        delegate: Text{ text: id + " " + message }
+    }
+\endcode
+ */
+
+QmlSqlPagedModel::QmlSqlPagedModel(QObject *parent)
+    : QAbstractListModel(parent),
+      m_database(nullptr),
+      m_pageSize(200),
+      m_count(0),
+      m_estimated(false),
+      m_pendingCount(-1),
+      m_pendingEstimated(false),
+      m_adjustQueued(false),
+      m_keyIndex(-1),
+      m_lastPage(-1),
+      m_prefetchPage(-1)
+{
+    m_pages.setMaxCost(10);
+    connect(this, SIGNAL(error(QString)), this, SLOT(handleErrorString(QString)));
+}
+
+QmlSqlDatabase* QmlSqlPagedModel::database() const {
+    return m_database;
+}
+
+void QmlSqlPagedModel::setDatabase(QmlSqlDatabase* database) {
+    if (database == m_database)
+        return;
+
+    if (m_database != nullptr)
+        disconnect(m_database, SIGNAL(connected()), this, SLOT(reload()));
+
+    m_database = database;
+    connect(m_database, SIGNAL(connected()), this, SLOT(reload()));
+
+    if (m_database->isConnected())
+        reload();
+
+    emit databaseChanged();
+}
+
+/*!
+  \qmlproperty string QmlSqlPagedModel::tableName
+  The table or view the rows are read from.
+*/
+QString QmlSqlPagedModel::tableName() const {
+    return m_tableName;
+}
+
+void QmlSqlPagedModel::setTableName(const QString& tableName) {
+    if (m_tableName == tableName)
+        return;
+    m_tableName = tableName;
+    emit tableNameChanged();
+}
+
+/*!
+  \qmlproperty string QmlSqlPagedModel::keyColumn
+  The unique column the rows are ordered and paged by, usually the primary key.
+*/
+QString QmlSqlPagedModel::keyColumn() const {
+    return m_keyColumn;
+}
+
+void QmlSqlPagedModel::setKeyColumn(const QString& keyColumn) {
+    if (m_keyColumn == keyColumn)
+        return;
+    m_keyColumn = keyColumn;
+    emit keyColumnChanged();
+}
+
+/*!
+  \qmlproperty list<string> QmlSqlPagedModel::columns
+  The columns that are read, each one becomes a role. keyColumn is always read. When it is empty all
+  columns are read.
+*/
+QStringList QmlSqlPagedModel::columns() const {
+    return m_columns;
+}
+
+void QmlSqlPagedModel::setColumns(const QStringList& columns) {
+    if (m_columns == columns)
+        return;
+    m_columns = columns;
+    emit columnsChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlPagedModel::pageSize
+  How many rows are read at a time. The default is 200.
+*/
+int QmlSqlPagedModel::pageSize() const {
+    return m_pageSize;
+}
+
+void QmlSqlPagedModel::setPageSize(int pageSize) {
+    if (m_pageSize == pageSize || pageSize < 1)
+        return;
+    m_pageSize = pageSize;
+    emit pageSizeChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlPagedModel::maxPages
+  How many pages are kept in memory. The default is 10.
+*/
+int QmlSqlPagedModel::maxPages() const {
+    return m_pages.maxCost();
+}
+
+void QmlSqlPagedModel::setMaxPages(int maxPages) {
+    if (m_pages.maxCost() == maxPages || maxPages < 2)
+        return;
+    m_pages.setMaxCost(maxPages);
+    emit maxPagesChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlPagedModel::count
+  Returns the number of rows, an estimate as long as estimated is \c true.
+*/
+int QmlSqlPagedModel::count() const {
+    return m_count;
+}
+
+/*!
+  \qmlproperty bool QmlSqlPagedModel::estimated
+  Returns \c true while count is an estimate, it becomes exact once the end of the table has been read.
+*/
+bool QmlSqlPagedModel::estimated() const {
+    return m_estimated;
+}
+
+QStringList QmlSqlPagedModel::rolesList() const {
+    return m_roleList;
+}
+
+/*!
+ \qmlproperty string QmlSqlPagedModel::errorString
+    Returns information about the last error that occurred while reading a page.
+*/
+QString QmlSqlPagedModel::errorString() const {
+    return m_error;
+}
+
+void QmlSqlPagedModel::handleErrorString(const QString& errorString) {
+    if (m_error == errorString)
+        return;
+    m_error = errorString;
+    emit errorStringChanged();
+}
+
+int QmlSqlPagedModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : m_count;
+}
+
+QHash<int, QByteArray> QmlSqlPagedModel::roleNames() const {
+    return m_roleNames;
+}
+
+QVariant QmlSqlPagedModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= m_count)
+        return QVariant();
+
+    int column = role - Qt::UserRole - 1;
+    if (role == Qt::DisplayRole)
+        column = 0;
+    else if (column < 0 || column >= m_roleList.count())
+        return QVariant();
+
+    const Page* rows = page(index.row() / m_pageSize);
+    if (rows == nullptr)
+        return QVariant();
+    return rows->rows.value(index.row() % m_pageSize, column);
+}
+
+/*!
+ \qmlmethod void QmlSqlPagedModel::reload()
+  Drops all pages and reads the model again from the first page. This happens on its own when the
+  database connects.
+*/
+void QmlSqlPagedModel::reload() {
+    beginResetModel();
+    m_pages.clear();
+    m_bounds.clear();
+    m_minKey = QVariant();
+    m_maxKey = QVariant();
+    m_keyIndex = -1;
+    m_lastPage = -1;
+    m_prefetchPage = -1;
+    m_adjustQueued = false;
+    const int oldCount = m_count;
+    const bool oldEstimated = m_estimated;
+    m_count = 0;
+    m_estimated = false;
+    QStringList roles;
+
+    if (m_database != nullptr && m_database->isConnected() && !m_tableName.isEmpty() && !m_keyColumn.isEmpty()) {
+        const Page* first = loadPage(0);
+        if (first != nullptr) {
+            roles = first->rows.columnNames();
+            if (first->hasMore) {
+                const qint64 estimate = estimateRows(QSqlDatabase::database(m_database->connectionName()));
+                m_count = int(qBound(qint64(m_pageSize) + 1, estimate, qint64(std::numeric_limits<int>::max())));
+                m_estimated = true;
+            }
+            else {
+                m_count = first->rows.rowCount();
+            }
+        }
+    }
+
+    if (m_roleList != roles) {
+        m_roleList = roles;
+        m_roleNames.clear();
+        for (int i = 0; i < roles.count(); i++)
+            m_roleNames.insert(Qt::UserRole + i + 1, roles.at(i).toLatin1());
+        emit rolesListChanged();
+    }
+    endResetModel();
+
+    if (m_count != oldCount)
+        emit countChanged();
+    if (m_estimated != oldEstimated)
+        emit estimatedChanged();
+}
+
+// data() is const, the pages are a cache of the table that it fills as views ask for rows
+const QmlSqlPagedModel::Page* QmlSqlPagedModel::page(int number) const {
+    QmlSqlPagedModel* self = const_cast<QmlSqlPagedModel*>(this);
+    const Page* cached = self->m_pages.object(number);
+    if (cached == nullptr)
+        cached = self->loadPage(number);
+
+    // read the next page in the direction the view is scrolling once the event loop is idle
+    if (number != m_lastPage) {
+        self->m_prefetchPage = m_lastPage < 0 || number > m_lastPage ? number + 1 : number - 1;
+        self->m_lastPage = number;
+        QMetaObject::invokeMethod(self, "prefetch", Qt::QueuedConnection);
+    }
+    return cached;
+}
+
+void QmlSqlPagedModel::prefetch() {
+    const int number = m_prefetchPage;
+    if (number < 0 || qint64(number) * m_pageSize >= m_count || m_pages.contains(number))
+        return;
+    loadPage(number);
+}
+
+QString QmlSqlPagedModel::selectList() const {
+    if (m_columns.isEmpty())
+        return "*";
+
+    QSqlDriver* driver = QSqlDatabase::database(m_database->connectionName()).driver();
+    QStringList fields;
+    foreach (const QString& column, m_columns)
+        fields << driver->escapeIdentifier(column, QSqlDriver::FieldName);
+    if (!m_columns.contains(m_keyColumn))
+        fields << driver->escapeIdentifier(m_keyColumn, QSqlDriver::FieldName);
+    return fields.join(", ");
+}
+
+QmlSqlPagedModel::Page* QmlSqlPagedModel::loadPage(int number) {
+    QSqlDatabase db = QSqlDatabase::database(m_database->connectionName());
+    QSqlDriver* driver = db.driver();
+    const QString key = driver->escapeIdentifier(m_keyColumn, QSqlDriver::FieldName);
+    const QString select = QString("SELECT %1 FROM %2").arg(selectList(), driver->escapeIdentifier(m_tableName, QSqlDriver::TableName));
+    // one row more than a page tells whether there is another page
+    const int limit = m_pageSize + 1;
+
+    QString statement;
+    QVariant bound;
+    bool forward = true;
+    if (number == 0) {
+        statement = QString("%1 ORDER BY %2 LIMIT %3").arg(select, key).arg(limit);
+    }
+    else if (m_bounds.contains(number - 1)) {
+        statement = QString("%1 WHERE %2 > ? ORDER BY %2 LIMIT %3").arg(select, key).arg(limit);
+        bound = m_bounds.value(number - 1).second;
+    }
+    else if (m_bounds.contains(number + 1)) {
+        statement = QString("SELECT * FROM (%1 WHERE %2 < ? ORDER BY %2 DESC LIMIT %3) AS qmlsql_page ORDER BY %2").arg(select, key).arg(m_pageSize);
+        bound = m_bounds.value(number + 1).first;
+        forward = false;
+    }
+    else if (m_minKey.isValid() && m_count > 0) {
+        const double min = m_minKey.toDouble();
+        const double max = m_maxKey.toDouble();
+        const qint64 guess = qint64(min + (max - min) * (double(number) * m_pageSize / m_count));
+        statement = QString("%1 WHERE %2 >= ? ORDER BY %2 LIMIT %3").arg(select, key).arg(limit);
+        bound = guess;
+    }
+    else {
+        statement = QString("%1 ORDER BY %2 LIMIT %3 OFFSET %4").arg(select, key).arg(limit).arg(qint64(number) * m_pageSize);
+    }
+
+    QmlSqlStats::Sample sample(db.connectionName(), statement);
+    QSqlQuery query = QmlSqlStatementCache::instance()->prepare(db, statement);
+    if (bound.isValid())
+        query.bindValue(0, bound);
+    sample.prepared();
+
+    Page* loaded = new Page;
+    if (!readPage(query, loaded, sample)) {
+        delete loaded;
+        return nullptr;
+    }
+    if (!forward)
+        loaded->hasMore = true;
+
+    const int rows = loaded->rows.rowCount();
+    if (m_keyIndex < 0)
+        m_keyIndex = loaded->rows.columnIndex(m_keyColumn);
+    if (rows > 0 && m_keyIndex >= 0)
+        m_bounds.insert(number, qMakePair(loaded->rows.value(0, m_keyIndex), loaded->rows.value(rows - 1, m_keyIndex)));
+
+    // what this page found out about the end of the table, count is only changed outside of data()
+    const qint64 end = qint64(number) * m_pageSize + rows;
+    if (number > 0 && (!loaded->hasMore || end >= m_count)) {
+        m_pendingCount = int(qMin(loaded->hasMore ? end + m_pageSize : end, qint64(std::numeric_limits<int>::max())));
+        m_pendingEstimated = loaded->hasMore;
+        if (!m_adjustQueued) {
+            m_adjustQueued = true;
+            QMetaObject::invokeMethod(this, "adjustCount", Qt::QueuedConnection);
+        }
+    }
+
+    m_pages.insert(number, loaded);
+    return loaded;
+}
+
+bool QmlSqlPagedModel::readPage(QSqlQuery& query, Page* page, QmlSqlStats::Sample& sample) {
+    if (!query.exec()) {
+        sample.failed();
+        sample.executed();
+        QmlSqlStats::instance()->record(sample);
+        error(QString("could not read a page of %1 Reason: %2").arg(m_tableName).arg(query.lastError().text()));
+        query.finish();
+        return false;
+    }
+    sample.executed();
+
+    page->rows = QmlSqlResultSet(query.record());
+    page->hasMore = false;
+    while (query.next()) {
+        if (page->rows.rowCount() == m_pageSize) {
+            page->hasMore = true;
+            break;
+        }
+        page->rows.appendRow(query);
+    }
+    query.finish();
+    sample.fetched(page->rows.rowCount(), page->rows.byteSize());
+    QmlSqlStats::instance()->record(sample);
+    return true;
+}
+
+void QmlSqlPagedModel::adjustCount() {
+    m_adjustQueued = false;
+    if (m_pendingCount >= 0)
+        setCount(m_pendingCount, m_pendingEstimated);
+    m_pendingCount = -1;
+}
+
+void QmlSqlPagedModel::setCount(int count, bool estimated) {
+    if (count < m_count) {
+        beginRemoveRows(QModelIndex(), count, m_count - 1);
+        m_count = count;
+        endRemoveRows();
+        emit countChanged();
+    }
+    else if (count > m_count) {
+        beginInsertRows(QModelIndex(), m_count, count - 1);
+        m_count = count;
+        endInsertRows();
+        emit countChanged();
+    }
+
+    if (m_estimated != estimated) {
+        m_estimated = estimated;
+        emit estimatedChanged();
+    }
+}
+
+/*!
+ \brief qint64 QmlSqlPagedModel::estimateRows(const QSqlDatabase& db)
+ Guesses the number of rows without reading the table. PostgreSQL and MySQL keep an estimate in their
+ statistics. For numeric keys the range between the smallest and largest key is used, both of which
+ are read from the ends of the key's index. COUNT(*) is only run when neither is available.
+ */
+qint64 QmlSqlPagedModel::estimateRows(const QSqlDatabase& db) {
+    QSqlDriver* driver = db.driver();
+    const QString table = driver->escapeIdentifier(m_tableName, QSqlDriver::TableName);
+    const QString key = driver->escapeIdentifier(m_keyColumn, QSqlDriver::FieldName);
+
+    QSqlQuery query(db);
+    if (query.exec(QString("SELECT MIN(%1), MAX(%1) FROM %2").arg(key, table)) && query.next()) {
+        const QVariant min = query.value(0);
+        const QVariant max = query.value(1);
+        switch (min.userType()) {
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Double:
+            m_minKey = min;
+            m_maxKey = max;
+            break;
+        default:
+            break;
+        }
+    }
+    query.finish();
+
+    QString statistics;
+    if (db.driverName().startsWith("QPSQL"))
+        statistics = "SELECT reltuples::bigint FROM pg_class WHERE relname = ?";
+    else if (db.driverName().startsWith("QMYSQL"))
+        statistics = "SELECT table_rows FROM information_schema.tables WHERE table_schema = DATABASE() AND table_name = ?";
+
+    qint64 estimate = -1;
+    if (!statistics.isEmpty() && query.prepare(statistics)) {
+        query.bindValue(0, m_tableName);
+        if (query.exec() && query.next())
+            estimate = query.value(0).toLongLong();
+        query.finish();
+    }
+    if (estimate > 0)
+        return estimate;
+
+    if (m_minKey.isValid())
+        return qint64(m_maxKey.toDouble() - m_minKey.toDouble()) + 1;
+
+    if (query.exec(QString("SELECT COUNT(*) FROM %1").arg(table)) && query.next())
+        estimate = query.value(0).toLongLong();
+    return estimate;
+}
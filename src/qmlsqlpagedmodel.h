@@ -0,0 +1,129 @@
+#ifndef QMLSQLPAGEDMODEL_H
+#define QMLSQLPAGEDMODEL_H
+
+#include <QAbstractListModel>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QCache>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+#include <QVariant>
+
+#include "qmlsqlresultset.h"
+#include "qmlsqlstats.h"
+
+class QmlSqlDatabase;
+
+class QmlSqlPagedModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QmlSqlDatabase* database READ database WRITE setDatabase NOTIFY databaseChanged)
+    Q_PROPERTY(QString tableName READ tableName WRITE setTableName NOTIFY tableNameChanged)
+    Q_PROPERTY(QString keyColumn READ keyColumn WRITE setKeyColumn NOTIFY keyColumnChanged)
+    Q_PROPERTY(QStringList columns READ columns WRITE setColumns NOTIFY columnsChanged)
+    Q_PROPERTY(int pageSize READ pageSize WRITE setPageSize NOTIFY pageSizeChanged)
+    Q_PROPERTY(int maxPages READ maxPages WRITE setMaxPages NOTIFY maxPagesChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(bool estimated READ estimated NOTIFY estimatedChanged)
+    Q_PROPERTY(QStringList rolesList READ rolesList NOTIFY rolesListChanged)
+    Q_PROPERTY(QString errorString READ errorString NOTIFY errorStringChanged)
+
+public:
+    explicit QmlSqlPagedModel(QObject *parent = nullptr);
+
+    QmlSqlDatabase* database() const;
+    void setDatabase(QmlSqlDatabase* database);
+
+    QString tableName() const;
+    void setTableName(const QString& tableName);
+
+    QString keyColumn() const;
+    void setKeyColumn(const QString& keyColumn);
+
+    QStringList columns() const;
+    void setColumns(const QStringList& columns);
+
+    int pageSize() const;
+    void setPageSize(int pageSize);
+
+    int maxPages() const;
+    void setMaxPages(int maxPages);
+
+    int count() const;
+    bool estimated() const;
+    QStringList rolesList() const;
+    QString errorString() const;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role) const;
+    QHash<int, QByteArray> roleNames() const;
+
+public slots:
+    void reload();
+
+signals:
+    void databaseChanged();
+    void tableNameChanged();
+    void keyColumnChanged();
+    void columnsChanged();
+    void pageSizeChanged();
+    void maxPagesChanged();
+    void countChanged();
+    void estimatedChanged();
+    void rolesListChanged();
+    void error(const QString err);
+    void errorStringChanged();
+
+protected slots:
+    void handleErrorString(const QString& errorString);
+    void adjustCount();
+    void prefetch();
+
+private:
+    struct Page
+    {
+        QmlSqlResultSet rows;
+        // there is at least one more row after the page
+        bool hasMore;
+    };
+
+    const Page* page(int number) const;
+    Page* loadPage(int number);
+    bool readPage(QSqlQuery& query, Page* page, QmlSqlStats::Sample& sample);
+    qint64 estimateRows(const QSqlDatabase& db);
+    QString selectList() const;
+    void setCount(int count, bool estimated);
+
+    QmlSqlDatabase* m_database;
+    QString m_tableName;
+    QString m_keyColumn;
+    QStringList m_columns;
+    int m_pageSize;
+    QString m_error;
+
+    int m_count;
+    bool m_estimated;
+    // what the loaded pages found out about count, applied outside of data()
+    int m_pendingCount;
+    bool m_pendingEstimated;
+    bool m_adjustQueued;
+
+    // the pages around the visible range, least recently used ones are dropped first
+    QCache<int, Page> m_pages;
+    // first and last key of every page loaded so far, pages next to them are read by key
+    QHash<int, QPair<QVariant, QVariant> > m_bounds;
+    // smallest and largest key, used to guess where a page starts when there is no page next to it
+    QVariant m_minKey;
+    QVariant m_maxKey;
+    int m_keyIndex;
+    int m_lastPage;
+    int m_prefetchPage;
+
+    QStringList m_roleList;
+    QHash<int, QByteArray> m_roleNames;
+};
+
+#endif // QMLSQLPAGEDMODEL_H
@@ -0,0 +1,427 @@
+#include "qmlsqlplan.h"
+#include "qmlsqlqueryworker.h"
+#include <QSqlError>
+#include <QSqlRecord>
+#include <QRegularExpression>
+#include <QPair>
+
+// the text of a column of the current row of query, empty if there is no such column
+static QString columnText(const QSqlQuery& query, const QSqlRecord& record, const QString& name) {
+    const int index = record.indexOf(name);
+    return index < 0 ? QString() : query.value(index).toString();
+}
+
+/*!
+   \qmltype QmlSqlPlan
+   \inqmlmodule QmlSql 1.0
+   \ingroup QmlSql
+   \inherits QAbstractListModel
+   \brief The QmlSqlPlan object holds the query plan of a statement.
+
+It is read with QmlSqlQuery::explain() or QmlSqlQueryModel::explain() and can not be created from QML.
+SQLite reports its plan through EXPLAIN QUERY PLAN, the other drivers through EXPLAIN. The statement
+itself is not run.
+
+Each step of the plan is a row with the roles
+\list
+\li \c stepId and \c parentId, the step and the step it is part of, 0 for the top level
+\li \c depth, how deep the step is nested
+\li \c detail, the text the database describes the step with
+\li \c fullScan, whether the step reads a whole table, \c table is then the name of that table
+\li \c tempBTree, whether the step builds a temporary B-tree or sorts for ORDER BY, GROUP BY or DISTINCT.
+    On QPSQL this is a Sort node, on QMYSQL "Using temporary" or "Using filesort"
+\li \c estimatedRows, the number of rows the database expects the step to read, -1 if it does not say.
+    SQLite gives one for a full scan once ANALYZE has been run on the table
+\endlist
+
+\code
+    QmlSqlQuery {
+        id: query
+        database: db
+        queryString: "SELECT * FROM employee WHERE name = 'John' ORDER BY salary"
+    }
+
+    ListView {
+        model: query.plan
+        delegate: Text {
+            text: "  ".repeat(depth) + detail
+            color: fullScan || tempBTree ? "red" : "black"
+        }
+    }
+
+    Component.onCompleted: {
+        if (query.explain())
+            console.log(query.plan.toText())
+    }
+\endcode
+
+ \sa QmlSqlStats::autoExplain
+*/
+QmlSqlPlan::QmlSqlPlan(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+/*!
+ \brief bool QmlSqlPlan::isExplainable(const QString& query)
+ Returns true if \c query is a statement every driver explains, a SELECT or a statement that changes rows.
+ */
+bool QmlSqlPlan::isExplainable(const QString& query) {
+    static const QRegularExpression statements("^\\s*(?:SELECT|WITH|VALUES|INSERT|UPDATE|DELETE|REPLACE)\\b", QRegularExpression::CaseInsensitiveOption);
+    return statements.match(query).hasMatch();
+}
+
+/*!
+ \brief QString QmlSqlPlan::explainStatement(const QString& driverName, const QString& query)
+ Returns the statement that asks the database behind \c driverName for the plan of \c query.
+ */
+QString QmlSqlPlan::explainStatement(const QString& driverName, const QString& query) {
+    if (driverName == "QSQLITE")
+        return QLatin1String("EXPLAIN QUERY PLAN ") + query;
+    return QLatin1String("EXPLAIN ") + query;
+}
+
+/*!
+ \brief QVector<QmlSqlPlan::Step> QmlSqlPlan::explain(const QSqlDatabase& db, const QString& query, const QVariant& bindValues, QString* errorString)
+ Reads the plan of \c query with \c bindValues on \c db. On failure no steps are returned and
+ \c errorString tells why, otherwise it is cleared. Must be called from the thread that owns \c db.
+ */
+QVector<QmlSqlPlan::Step> QmlSqlPlan::explain(const QSqlDatabase& db, const QString& query, const QVariant& bindValues, QString* errorString) {
+    QVector<Step> steps;
+    errorString->clear();
+
+    const QString driverName = db.driverName();
+    QSqlQuery plan(db);
+    plan.setForwardOnly(true);
+    bool ok = false;
+    if (bindValues.toList().isEmpty() && bindValues.toMap().isEmpty()) {
+        ok = plan.exec(explainStatement(driverName, query));
+    }
+    else if (driverName == "QPSQL") {
+        // QPSQL prepares on the server, where EXPLAIN can not be prepared
+        *errorString = QString("could not explain query of %1 Reason: QPSQL can not explain a statement with bind values").arg(query);
+        return steps;
+    }
+    else if (plan.prepare(explainStatement(driverName, query))) {
+        QmlSqlQueryWorker::bind(plan, bindValues);
+        ok = plan.exec();
+    }
+    if (!ok) {
+        *errorString = QString("could not explain query of %1 Reason: %2").arg(query).arg(plan.lastError().text());
+        return steps;
+    }
+
+    if (driverName == "QSQLITE")
+        readSqlite(plan, db, &steps);
+    else if (driverName == "QPSQL")
+        readPostgres(plan, &steps);
+    else if (driverName == "QMYSQL")
+        readMysql(plan, &steps);
+    else
+        readRows(plan, &steps);
+    return steps;
+}
+
+// id, parent, notused, detail; the row count of a scanned table comes from sqlite_stat1 if ANALYZE has filled it
+void QmlSqlPlan::readSqlite(QSqlQuery& plan, const QSqlDatabase& db, QVector<Step>* steps) {
+    static const QRegularExpression scan("^SCAN (?:TABLE )?(?!CONSTANT ROW\\b|SUBQUERY\\b|\\()(\\S+)");
+    const int detail = plan.record().count() - 1;
+    QHash<int, int> depths;
+    while (plan.next()) {
+        Step step;
+        step.id = plan.value(0).toInt();
+        step.parent = plan.value(1).toInt();
+        step.depth = depths.contains(step.parent) ? depths.value(step.parent) + 1 : 0;
+        depths.insert(step.id, step.depth);
+        step.detail = plan.value(detail).toString();
+        const QRegularExpressionMatch match = scan.match(step.detail);
+        if (match.hasMatch()) {
+            step.fullScan = true;
+            step.table = match.captured(1);
+        }
+        step.tempBTree = step.detail.contains("USE TEMP B-TREE");
+        steps->append(step);
+    }
+    plan.finish();
+
+    for (int i = 0; i < steps->count(); i++) {
+        if ((*steps)[i].fullScan)
+            (*steps)[i].estimatedRows = sqliteRowCount(db, steps->at(i).table);
+    }
+}
+
+qint64 QmlSqlPlan::sqliteRowCount(const QSqlDatabase& db, const QString& table) {
+    QSqlQuery stat(db);
+    if (!stat.prepare("SELECT stat FROM sqlite_stat1 WHERE tbl = ? LIMIT 1"))
+        return -1;
+    stat.addBindValue(table);
+    if (!stat.exec() || !stat.next())
+        return -1;
+    bool ok = false;
+    const qint64 rows = stat.value(0).toString().section(' ', 0, 0).toLongLong(&ok);
+    return ok ? rows : -1;
+}
+
+// one line of text per row, a node starts with "->" and the lines of a node are indented below it
+void QmlSqlPlan::readPostgres(QSqlQuery& plan, QVector<Step>* steps) {
+    static const QRegularExpression seqScan("^(?:Parallel )?Seq Scan on (\\S+)");
+    static const QRegularExpression sort("^(?:Incremental )?Sort(?:\\s+\\(|$)");
+    static const QRegularExpression estimate("\\brows=(\\d+)");
+    // the indent and id of the steps a following line may be part of
+    QVector<QPair<int, int> > open;
+    int id = 0;
+    while (plan.next()) {
+        const QString line = plan.value(0).toString();
+        int indent = 0;
+        while (indent < line.size() && line.at(indent) == QLatin1Char(' '))
+            indent++;
+        QString text = line.mid(indent);
+        if (text.startsWith("->"))
+            text = text.mid(2).trimmed();
+        while (!open.isEmpty() && open.last().first >= indent)
+            open.removeLast();
+
+        Step step;
+        step.id = ++id;
+        step.parent = open.isEmpty() ? 0 : open.last().second;
+        step.depth = open.count();
+        step.detail = text;
+        const QRegularExpressionMatch scan = seqScan.match(text);
+        if (scan.hasMatch()) {
+            step.fullScan = true;
+            step.table = scan.captured(1);
+        }
+        step.tempBTree = sort.match(text).hasMatch();
+        const QRegularExpressionMatch rows = estimate.match(text);
+        if (rows.hasMatch())
+            step.estimatedRows = rows.captured(1).toLongLong();
+        open.append(qMakePair(indent, step.id));
+        steps->append(step);
+    }
+}
+
+// one row per table the statement reads, a full scan has the access type ALL
+void QmlSqlPlan::readMysql(QSqlQuery& plan, QVector<Step>* steps) {
+    const QSqlRecord record = plan.record();
+    const QStringList shown = QStringList() << "select_type" << "table" << "type" << "key" << "Extra";
+    int id = 0;
+    while (plan.next()) {
+        Step step;
+        step.id = ++id;
+        QStringList parts;
+        foreach (const QString& name, shown) {
+            const QString value = columnText(plan, record, name);
+            if (!value.isEmpty())
+                parts << name + QLatin1Char('=') + value;
+        }
+        step.detail = parts.join(", ");
+        step.fullScan = columnText(plan, record, "type") == "ALL";
+        if (step.fullScan)
+            step.table = columnText(plan, record, "table");
+        const QString extra = columnText(plan, record, "Extra");
+        step.tempBTree = extra.contains("Using temporary") || extra.contains("Using filesort");
+        bool ok = false;
+        const qint64 rows = columnText(plan, record, "rows").toLongLong(&ok);
+        if (ok)
+            step.estimatedRows = rows;
+        steps->append(step);
+    }
+}
+
+// drivers whose EXPLAIN output is not understood keep every row as text
+void QmlSqlPlan::readRows(QSqlQuery& plan, QVector<Step>* steps) {
+    const int columns = plan.record().count();
+    int id = 0;
+    while (plan.next()) {
+        Step step;
+        step.id = ++id;
+        QStringList values;
+        for (int i = 0; i < columns; i++)
+            values << plan.value(i).toString();
+        step.detail = values.join(" | ");
+        steps->append(step);
+    }
+}
+
+/*!
+ \brief QStringList QmlSqlPlan::findings(const QVector<Step>& steps, qint64 threshold, qint64 unknownRows)
+ Describes the full scans and temporary B-trees of \c steps that touch at least \c threshold rows.
+ \c unknownRows is used for the steps the database gives no estimate for.
+ */
+QStringList QmlSqlPlan::findings(const QVector<Step>& steps, qint64 threshold, qint64 unknownRows) {
+    QStringList found;
+    foreach (const Step& step, steps) {
+        if (!step.fullScan && !step.tempBTree)
+            continue;
+        if ((step.estimatedRows >= 0 ? step.estimatedRows : unknownRows) < threshold)
+            continue;
+        const QString what = step.fullScan ? QString("full scan of %1").arg(step.table) : QString("temporary B-tree");
+        const QString size = step.estimatedRows >= 0 ? QString("about %1 rows").arg(step.estimatedRows) : QString("size unknown");
+        found << QString("%1 (%2): %3").arg(what, size, step.detail);
+    }
+    return found;
+}
+
+/*!
+ \brief bool QmlSqlPlan::read(const QSqlDatabase& db, const QString& query, const QVariant& bindValues)
+ Replaces the steps with the plan of \c query on \c db. Returns false and sets errorString if it could
+ not be read.
+ */
+bool QmlSqlPlan::read(const QSqlDatabase& db, const QString& query, const QVariant& bindValues) {
+    beginResetModel();
+    m_query = query;
+    m_steps = explain(db, query, bindValues, &m_errorString);
+    endResetModel();
+    emit changed();
+    return m_errorString.isEmpty();
+}
+
+/*!
+  \qmlproperty string QmlSqlPlan::query
+  The statement the plan belongs to.
+*/
+QString QmlSqlPlan::query() const {
+    return m_query;
+}
+
+/*!
+  \qmlproperty int QmlSqlPlan::count
+  The number of steps.
+*/
+int QmlSqlPlan::count() const {
+    return m_steps.count();
+}
+
+/*!
+  \qmlproperty int QmlSqlPlan::fullScans
+  The number of steps that read a whole table.
+*/
+int QmlSqlPlan::fullScans() const {
+    int scans = 0;
+    foreach (const Step& step, m_steps) {
+        if (step.fullScan)
+            scans++;
+    }
+    return scans;
+}
+
+/*!
+  \qmlproperty int QmlSqlPlan::tempBTrees
+  The number of steps that build a temporary B-tree or sort.
+*/
+int QmlSqlPlan::tempBTrees() const {
+    int trees = 0;
+    foreach (const Step& step, m_steps) {
+        if (step.tempBTree)
+            trees++;
+    }
+    return trees;
+}
+
+/*!
+  \qmlproperty string QmlSqlPlan::errorString
+  Why the plan could not be read, empty if it could.
+*/
+QString QmlSqlPlan::errorString() const {
+    return m_errorString;
+}
+
+/*!
+ \qmlmethod object QmlSqlPlan::step(int row)
+ Returns the step \c row as an object with the roles as its properties.
+ */
+QVariantMap QmlSqlPlan::step(int row) const {
+    QVariantMap map;
+    if (row < 0 || row >= m_steps.count())
+        return map;
+    const Step& step = m_steps.at(row);
+    map.insert("stepId", step.id);
+    map.insert("parentId", step.parent);
+    map.insert("depth", step.depth);
+    map.insert("detail", step.detail);
+    map.insert("table", step.table);
+    map.insert("fullScan", step.fullScan);
+    map.insert("tempBTree", step.tempBTree);
+    map.insert("estimatedRows", step.estimatedRows);
+    return map;
+}
+
+/*!
+ \qmlmethod array QmlSqlPlan::steps()
+ Returns every step, see step().
+ */
+QVariantList QmlSqlPlan::steps() const {
+    QVariantList list;
+    list.reserve(m_steps.count());
+    for (int i = 0; i < m_steps.count(); i++)
+        list << step(i);
+    return list;
+}
+
+/*!
+ \qmlmethod array QmlSqlPlan::findings(int threshold)
+ Returns a line of text for every full scan and temporary B-tree that is expected to touch at least
+ \c threshold rows. Steps the database gives no estimate for are always listed.
+ */
+QStringList QmlSqlPlan::findings(int threshold) const {
+    return findings(m_steps, threshold, threshold);
+}
+
+/*!
+ \qmlmethod string QmlSqlPlan::toText()
+ Returns the plan as text, one line per step indented by its depth.
+ */
+QString QmlSqlPlan::toText() const {
+    QStringList lines;
+    foreach (const Step& step, m_steps)
+        lines << QString(step.depth * 2, QLatin1Char(' ')) + step.detail;
+    return lines.join(QLatin1Char('\n'));
+}
+
+int QmlSqlPlan::rowCount(const QModelIndex& parent) const {
+    if (parent.isValid())
+        return 0;
+    return m_steps.count();
+}
+
+QVariant QmlSqlPlan::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= m_steps.count())
+        return QVariant();
+
+    const Step& step = m_steps.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case DetailRole:
+        return step.detail;
+    case StepIdRole:
+        return step.id;
+    case ParentIdRole:
+        return step.parent;
+    case DepthRole:
+        return step.depth;
+    case TableRole:
+        return step.table;
+    case FullScanRole:
+        return step.fullScan;
+    case TempBTreeRole:
+        return step.tempBTree;
+    case EstimatedRowsRole:
+        return step.estimatedRows;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> QmlSqlPlan::roleNames() const {
+    QHash<int, QByteArray> roles;
+    roles.insert(Qt::DisplayRole, "display");
+    roles.insert(StepIdRole, "stepId");
+    roles.insert(ParentIdRole, "parentId");
+    roles.insert(DepthRole, "depth");
+    roles.insert(DetailRole, "detail");
+    roles.insert(TableRole, "table");
+    roles.insert(FullScanRole, "fullScan");
+    roles.insert(TempBTreeRole, "tempBTree");
+    roles.insert(EstimatedRowsRole, "estimatedRows");
+    return roles;
+}
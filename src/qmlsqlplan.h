@@ -0,0 +1,92 @@
+#ifndef QMLSQLPLAN_H
+#define QMLSQLPLAN_H
+
+#include <QAbstractListModel>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+
+/*!
+ * \brief The QmlSqlPlan class
+ * The query plan of a statement as the database reports it for EXPLAIN QUERY PLAN on SQLite and EXPLAIN
+ * on the other drivers, one row per step. Steps that read a whole table or build a temporary sort
+ * structure are marked, with the number of rows the database expects them to touch where it says so.
+ *
+ * explain() and findings() are used by QmlSqlStats to check the plans of the statements it records,
+ * they must be called from the thread that owns the connection.
+ */
+class QmlSqlPlan : public QAbstractListModel
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QString query READ query NOTIFY changed)
+    Q_PROPERTY(int count READ count NOTIFY changed)
+    Q_PROPERTY(int fullScans READ fullScans NOTIFY changed)
+    Q_PROPERTY(int tempBTrees READ tempBTrees NOTIFY changed)
+    Q_PROPERTY(QString errorString READ errorString NOTIFY changed)
+
+public:
+    struct Step
+    {
+        Step() : id(0), parent(0), depth(0), fullScan(false), tempBTree(false), estimatedRows(-1) {}
+        int id;
+        int parent;
+        int depth;
+        QString detail;
+        // the table a full scan reads
+        QString table;
+        bool fullScan;
+        // a temporary B-tree or sort for ORDER BY, GROUP BY or DISTINCT
+        bool tempBTree;
+        // -1 when the database gives no estimate
+        qint64 estimatedRows;
+    };
+
+    explicit QmlSqlPlan(QObject *parent = nullptr);
+
+    enum Roles{ StepIdRole = Qt::UserRole + 1, ParentIdRole, DepthRole, DetailRole, TableRole, FullScanRole, TempBTreeRole, EstimatedRowsRole };
+
+    static bool isExplainable(const QString& query);
+    static QString explainStatement(const QString& driverName, const QString& query);
+    static QVector<Step> explain(const QSqlDatabase& db, const QString& query, const QVariant& bindValues, QString* errorString);
+    static QStringList findings(const QVector<Step>& steps, qint64 threshold, qint64 unknownRows);
+
+    bool read(const QSqlDatabase& db, const QString& query, const QVariant& bindValues);
+
+    QString query() const;
+    int count() const;
+    int fullScans() const;
+    int tempBTrees() const;
+    QString errorString() const;
+
+    Q_INVOKABLE QVariantMap step(int row) const;
+    Q_INVOKABLE QVariantList steps() const;
+    Q_INVOKABLE QStringList findings(int threshold) const;
+    Q_INVOKABLE QString toText() const;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role) const;
+    QHash<int, QByteArray> roleNames() const;
+
+signals:
+    void changed();
+
+private:
+    static void readSqlite(QSqlQuery& plan, const QSqlDatabase& db, QVector<Step>* steps);
+    static void readPostgres(QSqlQuery& plan, QVector<Step>* steps);
+    static void readMysql(QSqlQuery& plan, QVector<Step>* steps);
+    static void readRows(QSqlQuery& plan, QVector<Step>* steps);
+    static qint64 sqliteRowCount(const QSqlDatabase& db, const QString& table);
+
+    QString m_query;
+    QVector<Step> m_steps;
+    QString m_errorString;
+};
+
+#endif // QMLSQLPLAN_H
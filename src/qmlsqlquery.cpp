@@ -1,5 +1,4 @@
 #include "qmlsqlquery.h"
-#include <QStringBuilder>
 
 #include "qmlsqldatabase.h"
 
@@ -36,11 +35,25 @@ Otherwise, the behavior of \c QmlSqlQuery is undefined.
 */
 
 QmlSqlQuery::QmlSqlQuery(QObject *parent)
-    : QObject(parent), m_database(nullptr)
+    : QObject(parent), m_database(nullptr), m_rowsAffected(0), m_outputPending(false),
+      m_result(new QmlSqlResult(this)), m_async(false), m_streaming(false), m_chunkSize(500), m_chunkInterval(100),
+      m_maxRows(0), m_maxBytes(0), m_truncated(false), m_chunk(new QmlSqlResult(this)), m_workerThread(nullptr), m_worker(nullptr),
+      m_timeoutMs(0), m_timeoutTimer(new QTimer(this)), m_sent(0), m_handled(0), m_discardUpTo(0), m_plan(new QmlSqlPlan(this))
 {
+    m_timeoutTimer->setSingleShot(true);
+    connect(m_timeoutTimer, SIGNAL(timeout()), this, SLOT(handleTimeout()));
     connect(this, SIGNAL(error(QString)), this, SLOT(handleError(QString)));
 }
 
+QmlSqlQuery::~QmlSqlQuery() {
+    if (m_workerThread != nullptr) {
+        abandonRequests();
+        m_worker->abort();
+        m_workerThread->quit();
+        m_workerThread->wait();
+    }
+}
+
 int QmlSqlQuery::rowsAffected() const {
     return m_rowsAffected;
 }
@@ -110,19 +123,39 @@ void QmlSqlQuery::setLastQuery(const QString& lastQuery) {
 /*!
   \qmlproperty string QQmlSqlQuery::lastQueryOutPut
     Returns the text from the last query that was ran. If there was a error one can use errorString to retrive more information about the error,
-\sa errorString
+
+    For a SELECT the text, one line per row with the values separated by tabs, is only built the first time
+ this property is read after the query ran. Use result to work with the rows and their types directly.
+\sa errorString, result
 */
 QString QmlSqlQuery::lastQueryOutput() const {
+    if (m_outputPending) {
+        m_lastQueryOutput = m_result->resultSet().toText();
+        m_outputPending = false;
+    }
     return m_lastQueryOutput;
 }
 
 void QmlSqlQuery::setLastQueryOutput(const QString& lastQueryOutput) {
-    if (m_lastQueryOutput == lastQueryOutput)
+    if (!m_outputPending && m_lastQueryOutput == lastQueryOutput)
         return;
+    m_outputPending = false;
     m_lastQueryOutput = lastQueryOutput ;
     emit lastQueryOutputChanged();
 }
 
+/*!
+  \qmlproperty QmlSqlResult QQmlSqlQuery::result
+    Returns the rows of the last SELECT that was run, with the column names and the value types the
+ database reported. Unlike lastQueryOutput nothing is converted to text. After a statement that is not
+ a SELECT the result is empty.
+
+\sa QmlSqlResult, lastQueryOutput
+*/
+QmlSqlResult* QmlSqlQuery::result() const {
+    return m_result;
+}
+
 /*!
   \qmlproperty string QQmlSqlQuery::errorString
 Returns error information about the last error (if any) that occurred with this query.
@@ -139,6 +172,226 @@ void QmlSqlQuery::setErrorString(const QString& errorString) {
 }
 
 
+/*!
+  \qmlproperty bool QQmlSqlQuery::async
+    When \c true exec() and execWithQuery() return straight away and the statement is run on a worker
+ thread that belongs to this QmlSqlQuery, using its own clone of the named connection. rowsAffected,
+ lastQueryOutput and errorString are updated and done() is emitted once the statement has finished.
+
+    The default is \c false, which runs the statement on the calling thread. While database has an open
+ transaction the statement runs on the calling thread as well, so that it becomes part of the transaction.
+
+    \b{Note:} The clone is a separate connection, so it does not see uncommitted changes or temporary
+ tables of the connection opened by QmlSqlDatabase. An in memory SQLite database can not be used this way.
+ */
+bool QmlSqlQuery::async() const {
+    return m_async;
+}
+
+void QmlSqlQuery::setAsync(bool async) {
+    if (m_async == async)
+        return;
+    m_async = async;
+    emit asyncChanged();
+}
+
+/*!
+  \qmlproperty variant QQmlSqlQuery::bindValues
+    Values that are bound to the placeholders of queryString when it is executed, instead of
+ concatenating them into the query text. This lets the database reuse one prepared statement
+ for every set of values.
+
+    Use an object to bind named placeholders, the keys may be written with or without the leading colon,
+ or an array to bind \c ? placeholders in order.
+
+\code
+    QmlSqlQuery{
+        database: db
+        queryString: "SELECT name FROM employee WHERE salary > :salary"
+        bindValues: { "salary": salaryField.value }
+    }
+\endcode
+
+    \sa bindValue()
+ */
+QVariant QmlSqlQuery::bindValues() const {
+    return m_bindValues;
+}
+
+void QmlSqlQuery::setBindValues(const QVariant& bindValues) {
+    const QVariant values = QmlSqlQueryWorker::normalizeBindValues(bindValues);
+    if (m_bindValues == values)
+        return;
+    m_bindValues = values;
+    emit bindValuesChanged();
+}
+
+/*!
+  \qmlmethod void QQmlSqlQuery::bindValue(string placeholder, variant value)
+    Binds \c value to the named \c placeholder the next time the query is executed. Positional
+ values that were set through bindValues are replaced.
+
+    \sa bindValues
+ */
+void QmlSqlQuery::bindValue(const QString& placeholder, const QVariant& value) {
+    QVariantMap values = m_bindValues.toMap();
+    values.insert(placeholder, value);
+    setBindValues(values);
+}
+
+/*!
+  \qmlproperty bool QQmlSqlQuery::streaming
+    When \c true a SELECT is read forward only and its rows are handed out through rowsReady() in chunks
+ instead of being collected in result. Only the current chunk is kept in memory, which makes it possible
+ to export or check results that would not fit in memory. Combine with async to read on a worker thread,
+ the worker then waits for each chunk to be handled before it reads far ahead.
+
+\code
+    QmlSqlQuery{
+        database: db
+        async: true
+        streaming: true
+        chunkSize: 1000
+        queryString: "SELECT * FROM audit_log"
+        onRowsReady: {
+            for (var i = 0; i < chunk.rowCount; i++)
+                exporter.write(chunk.row(i))
+        }
+        onDone: exporter.close()
+    }
+\endcode
+
+    \sa chunkSize, chunkInterval, maxRows, maxBytes, rowsReady()
+ */
+bool QmlSqlQuery::streaming() const {
+    return m_streaming;
+}
+
+void QmlSqlQuery::setStreaming(bool streaming) {
+    if (m_streaming == streaming)
+        return;
+    m_streaming = streaming;
+    emit streamingChanged();
+}
+
+/*!
+  \qmlproperty int QQmlSqlQuery::chunkSize
+    The most rows a chunk passed to rowsReady() holds when streaming. The default is 500.
+ */
+int QmlSqlQuery::chunkSize() const {
+    return m_chunkSize;
+}
+
+void QmlSqlQuery::setChunkSize(int chunkSize) {
+    if (m_chunkSize == chunkSize || chunkSize < 1)
+        return;
+    m_chunkSize = chunkSize;
+    emit chunkSizeChanged();
+}
+
+/*!
+  \qmlproperty int QQmlSqlQuery::chunkInterval
+    When streaming, a chunk is handed out after this many milliseconds even if it holds fewer than
+ chunkSize rows, so slow queries still show progress. The default is 100, 0 waits for full chunks.
+ */
+int QmlSqlQuery::chunkInterval() const {
+    return m_chunkInterval;
+}
+
+void QmlSqlQuery::setChunkInterval(int chunkInterval) {
+    if (m_chunkInterval == chunkInterval)
+        return;
+    m_chunkInterval = chunkInterval;
+    emit chunkIntervalChanged();
+}
+
+/*!
+  \qmlproperty int QQmlSqlQuery::maxRows
+    When streaming, stop reading after this many rows. truncated tells whether there were more.
+ The default is 0, which reads every row.
+ */
+int QmlSqlQuery::maxRows() const {
+    return m_maxRows;
+}
+
+void QmlSqlQuery::setMaxRows(int maxRows) {
+    if (m_maxRows == maxRows)
+        return;
+    m_maxRows = maxRows;
+    emit maxRowsChanged();
+}
+
+/*!
+  \qmlproperty int QQmlSqlQuery::maxBytes
+    When streaming, stop reading once the values read add up to about this many bytes. truncated tells
+ whether there were more rows. The default is 0, which reads every row.
+ */
+int QmlSqlQuery::maxBytes() const {
+    return m_maxBytes;
+}
+
+void QmlSqlQuery::setMaxBytes(int maxBytes) {
+    if (m_maxBytes == maxBytes)
+        return;
+    m_maxBytes = maxBytes;
+    emit maxBytesChanged();
+}
+
+/*!
+  \qmlproperty bool QQmlSqlQuery::truncated
+    Returns \c true if the last streamed query stopped at maxRows or maxBytes before its last row.
+ */
+bool QmlSqlQuery::truncated() const {
+    return m_truncated;
+}
+
+void QmlSqlQuery::setTruncated(bool truncated) {
+    if (m_truncated == truncated)
+        return;
+    m_truncated = truncated;
+    emit truncatedChanged();
+}
+
+/*!
+  \qmlproperty int QQmlSqlQuery::timeoutMs
+    When \c async is set, a query, stream or batch still running after this many milliseconds is
+ cancelled like cancel() does and timedOut() is emitted instead of cancelled(). The time counts from the
+ last request, which also covers the requests queued before it. The default is 0, which never times out.
+ Statements run on the calling thread can not time out.
+
+ \sa cancel()
+ */
+int QmlSqlQuery::timeoutMs() const {
+    return m_timeoutMs;
+}
+
+void QmlSqlQuery::setTimeoutMs(int timeoutMs) {
+    if (m_timeoutMs == timeoutMs)
+        return;
+    m_timeoutMs = timeoutMs;
+    emit timeoutMsChanged();
+}
+
+/*!
+  \qmlproperty QmlSqlPlan QQmlSqlQuery::plan
+    The query plan explain() read last.
+
+\sa explain(), QmlSqlPlan
+*/
+QmlSqlPlan* QmlSqlQuery::plan() const {
+    return m_plan;
+}
+
+QmlSqlStreamOptions QmlSqlQuery::streamOptions(bool throttled) const {
+    QmlSqlStreamOptions options;
+    options.chunkSize = m_chunkSize;
+    options.chunkInterval = m_chunkInterval;
+    options.maxRows = m_maxRows;
+    options.maxBytes = m_maxBytes;
+    options.throttled = throttled;
+    return options;
+}
+
 /*!
   \qmlmethod void QQmlSqlQuery::exec()
   Executes a previously prepared SQL query (queryString). on a connected QmlSqlDatabase via connectionName.
@@ -203,46 +456,234 @@ Example:
 
 */
 void QmlSqlQuery::execWithQuery(const QString& connectionName, const QString& query) {
+    if (m_async && !joinsTransaction(connectionName)) {
+        startWorker();
+        requestSent();
+        if (m_streaming)
+            emit streamRequested(QmlSqlConnectionParams::fromConnection(connectionName), query, m_bindValues, streamOptions(true));
+        else
+            emit runRequested(QmlSqlConnectionParams::fromConnection(connectionName), query, m_bindValues);
+        return;
+    }
+
     QSqlDatabase db = QSqlDatabase::database(connectionName);
-    QSqlQuery db_query(db);
-    db_query.prepare(query);
+    if (m_streaming) {
+        QmlSqlQueryWorker worker;
+        connect(&worker, SIGNAL(chunkReady(QmlSqlResultSet,int)), this, SLOT(handleChunk(QmlSqlResultSet,int)));
+        handleResult(worker.executeStreaming(db, query, m_bindValues, streamOptions(false)));
+        return;
+    }
+    handleResult(QmlSqlQueryWorker::execute(db, query, m_bindValues));
+}
+
+/*!
+  \qmlmethod void QQmlSqlQuery::execBatch(string query, variant rows)
+  Runs the INSERT, UPDATE or DELETE statement \c query once for every entry of \c rows, using
+  QSqlQuery::execBatch() inside a single transaction on a worker thread. This is much faster than
+  calling execWithQuery() for every row, which prepares the statement and on SQLite commits once per row.
+
+  \c rows is either an array of arrays for \c ? placeholders, an array of objects or an object of
+  equally long arrays for named placeholders. The statement runs on the connection of database.
+
+  batchProgress() is emitted while the rows are written and batchDone() with the number of rows and
+  the elapsed time in milliseconds once the transaction has been committed. If any row fails the
+  whole batch is rolled back and errorString is set.
 
-    if (!db_query.exec())
-    {
-        QString er = QString("could not run query of %1 Reason: %2").arg(query).arg(db_query.lastError().text());
-        error(er);
-        return ;
+\code
+    QmlSqlQuery{
+        id: importer
+        database: db
+        onBatchProgress: progressBar.value = rows / total
+        onBatchDone: console.log(rows + " rows in " + elapsed + " ms")
     }
 
-    if (db_query.lastError().type() != QSqlError::NoError) {
-        error(db_query.lastError().text());
+    importer.execBatch("INSERT INTO employee (name, salary) VALUES (?, ?)",
+                       [["John", 2000], ["Martin", 3500], ["Maddie", 3300]])
+\endcode
+
+ \sa execWithQuery()
+*/
+void QmlSqlQuery::execBatch(const QString& query, const QVariant& rows) {
+    if (m_database == nullptr) {
+        error(QString("could not run batch of %1 Reason: no database is set").arg(query));
         return;
     }
 
-    if (db_query.isSelect()) {
-        QString output;
-        QSqlRecord rec = db_query.record();
-        const int columnCount = rec.count() - 1 ;
-        int recordCount = 0;
-        while (db_query.next()) {
-            for (int i=0; i<=columnCount; i++) {
-                output.append(db_query.value(i).toString() % '\t');
-            }
-            output.append('\n');
-            recordCount++;
-        }
-        setLastQueryOutput(output);
-        setRowsAffected(recordCount);
+    int rowCount = 0;
+    const QVariant columns = QmlSqlQueryWorker::batchColumns(rows, &rowCount);
+    if (!columns.isValid()) {
+        error(QString("could not run batch of %1 Reason: rows must be an array of arrays, an array of objects or an object of arrays of the same length").arg(query));
+        return;
+    }
+
+    const QString connectionName = m_database->connectionName();
+    if (joinsTransaction(connectionName)) {
+        QmlSqlQueryWorker worker;
+        connect(&worker, SIGNAL(batchProgress(int,int)), this, SIGNAL(batchProgress(int,int)));
+        handleBatchResult(worker.executeBatch(QSqlDatabase::database(connectionName), query, columns, rowCount, false));
+        return;
+    }
+
+    startWorker();
+    requestSent();
+    emit batchRequested(QmlSqlConnectionParams::fromConnection(connectionName), query, columns, rowCount);
+}
+
+/*!
+  \qmlmethod void QQmlSqlQuery::cancel()
+  Cancels the queries, streams and batches this query has handed to its worker thread and that have not
+  finished yet. The statement that is running is aborted: QPSQL and QMYSQL ask the server to cancel it,
+  QSQLITE interrupts it when the plugin is built with \c {CONFIG += qmlsql_sqlite_interrupt}, and for
+  other drivers it runs to its end but its rows are no longer read. The ones still waiting do not run.
+  A batch is rolled back.
+
+  Nothing that was cancelled reports done(), batchDone() or rowsReady(), and errorString is left alone.
+  cancelled() is emitted instead. The connection stays open and the next query can run right away.
+  Statements run on the calling thread, because \c async is not set or a transaction is open, can not
+  be cancelled.
+
+  \sa timeoutMs
+*/
+void QmlSqlQuery::cancel() {
+    if (abandonRequests())
+        emit cancelled();
+}
+
+/*!
+  \qmlmethod bool QQmlSqlQuery::explain()
+  Reads the query plan of queryString with bindValues on the connection of database into plan, without
+  running the statement. This happens on the calling thread. Returns \c false and sets errorString if
+  the plan could not be read.
+
+\code
+    if (query.explain() && query.plan.fullScans > 0)
+        console.warn(query.plan.toText())
+\endcode
+
+  \sa plan, QmlSqlStats::autoExplain
+*/
+bool QmlSqlQuery::explain() {
+    if (m_database == nullptr) {
+        error(QString("could not explain query of %1 Reason: no database is set").arg(m_queryString));
+        return false;
+    }
+    if (!m_plan->read(QSqlDatabase::database(m_database->connectionName(), false), m_queryString, m_bindValues)) {
+        error(m_plan->errorString());
+        return false;
+    }
+    return true;
+}
+
+void QmlSqlQuery::handleTimeout() {
+    if (abandonRequests())
+        emit timedOut();
+}
+
+void QmlSqlQuery::requestSent() {
+    m_sent++;
+    if (m_timeoutMs > 0)
+        m_timeoutTimer->start(m_timeoutMs);
+}
+
+// counts a result of the worker, returns false if its request was cancelled
+bool QmlSqlQuery::takeResult() {
+    if (m_worker == nullptr || sender() != m_worker)
+        return true;
+    m_handled++;
+    if (m_handled == m_sent)
+        m_timeoutTimer->stop();
+    return m_handled > m_discardUpTo;
+}
+
+bool QmlSqlQuery::abandonRequests() {
+    if (m_worker == nullptr || m_handled == m_sent || m_discardUpTo == m_sent)
+        return false;
+    m_discardUpTo = m_sent;
+    m_timeoutTimer->stop();
+    m_worker->cancel(m_sent);
+    return true;
+}
+
+void QmlSqlQuery::handleError(const QString& err) {
+    setErrorString(err);
+}
+
+void QmlSqlQuery::handleResult(const QmlSqlQueryResult& result) {
+    if (!takeResult())
+        return;
+    if (!result.ok) {
+        error(result.errorString);
+        return;
+    }
+
+    m_result->setResultSet(result.resultSet);
+    setTruncated(result.truncated);
+    if (result.isSelect) {
+        m_lastQueryOutput.clear();
+        m_outputPending = true;
+        emit lastQueryOutputChanged();
     }
     else {
-        const int recordCount = db_query.numRowsAffected();
-        setRowsAffected(recordCount);
-        setLastQueryOutput(tr("(%n row(s) affected)", "", recordCount));
+        setLastQueryOutput(result.output);
     }
+    setRowsAffected(result.rowsAffected);
     setErrorString(QString());
     emit done();
 }
 
-void QmlSqlQuery::handleError(const QString& err) {
-    setErrorString(err);
+void QmlSqlQuery::handleBatchResult(const QmlSqlQueryResult& result) {
+    if (!takeResult())
+        return;
+    if (!result.ok) {
+        error(result.errorString);
+        return;
+    }
+
+    setRowsAffected(result.rowsAffected);
+    setErrorString(QString());
+    emit batchDone(result.rowsAffected, int(result.elapsed));
+}
+
+// a worker uses its own connection, statements that have to be part of the open transaction run here
+bool QmlSqlQuery::joinsTransaction(const QString& connectionName) const {
+    return m_database != nullptr && m_database->connectionName() == connectionName && m_database->inTransaction();
+}
+
+void QmlSqlQuery::handleChunk(const QmlSqlResultSet& chunk, int offset) {
+    const bool fromWorker = m_worker != nullptr && sender() == m_worker;
+    // the chunk belongs to the request after the last one whose result has come back
+    if (fromWorker && m_handled + 1 <= m_discardUpTo) {
+        m_worker->chunkConsumed();
+        return;
+    }
+    m_chunk->setResultSet(chunk);
+    emit rowsReady(m_chunk, offset);
+    // only the current chunk is kept
+    m_chunk->setResultSet(QmlSqlResultSet());
+    if (fromWorker)
+        m_worker->chunkConsumed();
+}
+
+void QmlSqlQuery::startWorker() {
+    if (m_workerThread != nullptr)
+        return;
+
+    qRegisterMetaType<QmlSqlConnectionParams>();
+    qRegisterMetaType<QmlSqlQueryResult>();
+    qRegisterMetaType<QmlSqlResultSet>();
+    qRegisterMetaType<QmlSqlStreamOptions>();
+
+    m_workerThread = new QThread(this);
+    QmlSqlQueryWorker* worker = new QmlSqlQueryWorker;
+    m_worker = worker;
+    worker->moveToThread(m_workerThread);
+    connect(m_workerThread, SIGNAL(finished()), worker, SLOT(deleteLater()));
+    connect(this, SIGNAL(runRequested(QmlSqlConnectionParams,QString,QVariant)), worker, SLOT(run(QmlSqlConnectionParams,QString,QVariant)));
+    connect(worker, SIGNAL(finished(QmlSqlQueryResult)), this, SLOT(handleResult(QmlSqlQueryResult)));
+    connect(this, SIGNAL(batchRequested(QmlSqlConnectionParams,QString,QVariant,int)), worker, SLOT(runBatch(QmlSqlConnectionParams,QString,QVariant,int)));
+    connect(worker, SIGNAL(batchProgress(int,int)), this, SIGNAL(batchProgress(int,int)));
+    connect(worker, SIGNAL(batchFinished(QmlSqlQueryResult)), this, SLOT(handleBatchResult(QmlSqlQueryResult)));
+    connect(this, SIGNAL(streamRequested(QmlSqlConnectionParams,QString,QVariant,QmlSqlStreamOptions)), worker, SLOT(stream(QmlSqlConnectionParams,QString,QVariant,QmlSqlStreamOptions)));
+    connect(worker, SIGNAL(chunkReady(QmlSqlResultSet,int)), this, SLOT(handleChunk(QmlSqlResultSet,int)));
+    m_workerThread->start();
 }
@@ -9,6 +9,13 @@
 #include <QStringList>
 #include <QDebug>
 #include <QString>
+#include <QVariant>
+#include <QThread>
+#include <QTimer>
+
+#include "qmlsqlqueryworker.h"
+#include "qmlsqlresult.h"
+#include "qmlsqlplan.h"
 
 class QmlSqlDatabase;
 
@@ -22,9 +29,21 @@ class QmlSqlQuery : public QObject
     Q_PROPERTY(QString lastQueryOutput READ lastQueryOutput WRITE setLastQueryOutput NOTIFY lastQueryOutputChanged)
     Q_PROPERTY(QString errorString READ errorString WRITE setErrorString NOTIFY errorStringChanged)
     Q_PROPERTY(int rowsAffected READ rowsAffected WRITE setRowsAffected NOTIFY rowsAffectedChanged)
+    Q_PROPERTY(bool async READ async WRITE setAsync NOTIFY asyncChanged)
+    Q_PROPERTY(QVariant bindValues READ bindValues WRITE setBindValues NOTIFY bindValuesChanged)
+    Q_PROPERTY(QmlSqlResult* result READ result CONSTANT)
+    Q_PROPERTY(bool streaming READ streaming WRITE setStreaming NOTIFY streamingChanged)
+    Q_PROPERTY(int chunkSize READ chunkSize WRITE setChunkSize NOTIFY chunkSizeChanged)
+    Q_PROPERTY(int chunkInterval READ chunkInterval WRITE setChunkInterval NOTIFY chunkIntervalChanged)
+    Q_PROPERTY(int maxRows READ maxRows WRITE setMaxRows NOTIFY maxRowsChanged)
+    Q_PROPERTY(int maxBytes READ maxBytes WRITE setMaxBytes NOTIFY maxBytesChanged)
+    Q_PROPERTY(bool truncated READ truncated NOTIFY truncatedChanged)
+    Q_PROPERTY(int timeoutMs READ timeoutMs WRITE setTimeoutMs NOTIFY timeoutMsChanged)
+    Q_PROPERTY(QmlSqlPlan* plan READ plan CONSTANT)
 
 public:
     explicit QmlSqlQuery(QObject *parent = nullptr);
+    ~QmlSqlQuery();
 
     int rowsAffected() const;
     void setRowsAffected(int rowsAffected);
@@ -44,7 +63,42 @@ public:
     QString errorString() const;
     void setErrorString(const QString& errorString);
 
+    bool async() const;
+    void setAsync(bool async);
+
+    QVariant bindValues() const;
+    void setBindValues(const QVariant& bindValues);
+
+    QmlSqlResult* result() const;
+
+    bool streaming() const;
+    void setStreaming(bool streaming);
+
+    int chunkSize() const;
+    void setChunkSize(int chunkSize);
+
+    int chunkInterval() const;
+    void setChunkInterval(int chunkInterval);
+
+    int maxRows() const;
+    void setMaxRows(int maxRows);
+
+    int maxBytes() const;
+    void setMaxBytes(int maxBytes);
+
+    bool truncated() const;
+
+    int timeoutMs() const;
+    void setTimeoutMs(int timeoutMs);
+
+    QmlSqlPlan* plan() const;
+
+    Q_INVOKABLE void bindValue(const QString& placeholder, const QVariant& value);
+
     Q_INVOKABLE void execWithQuery(const QString& connectionName, const QString& query);
+    Q_INVOKABLE void execBatch(const QString& query, const QVariant& rows);
+    Q_INVOKABLE void cancel();
+    Q_INVOKABLE bool explain();
 signals:
     void rowsAffectedChanged();
     void queryStringChanged();
@@ -52,21 +106,75 @@ signals:
     void lastQueryOutputChanged();
     void errorStringChanged();
     void databaseChanged();
+    void asyncChanged();
+    void bindValuesChanged();
     void error(QString);
     void done();
+    void batchProgress(int rows, int total);
+    void batchDone(int rows, int elapsed);
+    void rowsReady(QmlSqlResult* chunk, int offset);
+    void streamingChanged();
+    void chunkSizeChanged();
+    void chunkIntervalChanged();
+    void maxRowsChanged();
+    void maxBytesChanged();
+    void truncatedChanged();
+    void timeoutMsChanged();
+    void cancelled();
+    void timedOut();
+
+    //INTERNAL
+    void runRequested(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues);
+    void batchRequested(const QmlSqlConnectionParams& params, const QString& query, const QVariant& columns, int rowCount);
+    void streamRequested(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, const QmlSqlStreamOptions& options);
 
 public slots:
     void exec();
     void handleError(const QString& err);
+    void handleResult(const QmlSqlQueryResult& result);
+    void handleBatchResult(const QmlSqlQueryResult& result);
+    void handleChunk(const QmlSqlResultSet& chunk, int offset);
+
+private slots:
+    void handleTimeout();
 
 private:
+    void startWorker();
+    bool joinsTransaction(const QString& connectionName) const;
+    QmlSqlStreamOptions streamOptions(bool throttled) const;
+    void setTruncated(bool truncated);
+    void requestSent();
+    bool takeResult();
+    bool abandonRequests();
+
     QmlSqlDatabase* m_database;
     int m_rowsAffected;
     QString m_queryString;
     QString m_lastQuery;
-    QString m_lastQueryOutput;
+    // formatted from m_result on first read when m_outputPending is set
+    mutable QString m_lastQueryOutput;
+    mutable bool m_outputPending;
+    QmlSqlResult* m_result;
     QString m_connectionName;
     QString m_errorString;
+    bool m_async;
+    QVariant m_bindValues;
+    bool m_streaming;
+    int m_chunkSize;
+    int m_chunkInterval;
+    int m_maxRows;
+    int m_maxBytes;
+    bool m_truncated;
+    QmlSqlResult* m_chunk;
+    QThread* m_workerThread;
+    QmlSqlQueryWorker* m_worker;
+    int m_timeoutMs;
+    QTimer* m_timeoutTimer;
+    // requests handed to m_worker, results taken back from it and the last request whose result is dropped
+    int m_sent;
+    int m_handled;
+    int m_discardUpTo;
+    QmlSqlPlan* m_plan;
 };
 
 #endif // QQMLSQLQUERY_H
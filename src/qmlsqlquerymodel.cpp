@@ -1,5 +1,9 @@
 #include "qmlsqlquerymodel.h"
 #include "qmlsqldatabase.h"
+#include "qmlsqlchangenotifier.h"
+#include "qmlsqlresultcache.h"
+#include <QSqlDriver>
+#include <algorithm>
 
 
 
@@ -8,7 +12,7 @@
    \inqmlmodule QmlSql 1.0
    \ingroup QmlSql
    \inherits QObject
-   \brief The QmlSqlQueryModel object provides a read-only data model for SQL result sets.
+   \brief The QmlSqlQueryModel object provides a data model for SQL result sets that can also write its edits back.
 
    \b{Note:} When you destroy your object this also destroys the the instance of QmlSqlQueryModel, thus everytime it gets recreated. Some people may wish to put this object in a qml file that never gets destoryed till the application is destroyed.
 
@@ -30,7 +34,11 @@ Say that we have a QmlSqlDatabase open with te connectionName of "master-connect
 \endcode
 
 
-The model is read-only by default. To make it writable you can use QmlSqlQuery but in the near future there will be a option to set it as writable.
+The model is read-only by default. Set readOnly to \c false, and tableName and keyColumn to the table the
+rows come from and its primary key, to edit it with setValue(), appendRow() and deleteRow(). The edits are
+kept in the model and written to the database as editStrategy says: right away, when another row is
+edited, or with submitAll() when it is QmlSqlQueryModel.OnManualSubmit. revertAll() drops them, and
+pendingChanges tells how many rows have edits that are not written yet.
 
 The querymodel example illustrates how to use QmlSqlQueryModel to display the result of a query.
 
@@ -39,9 +47,49 @@ The querymodel example illustrates how to use QmlSqlQueryModel to display the re
 
 QmlSqlQueryModel::QmlSqlQueryModel(QObject *parent) :
     QSqlQueryModel(parent),
-    m_readOnly(true)
+    m_database(nullptr),
+    m_readOnly(true),
+    m_async(false),
+    m_batchSize(256),
+    m_fetching(false),
+    m_storage(Cursor),
+    m_refreshMode(Reset),
+    m_autoRefresh(false),
+    m_editStrategy(OnRowChange),
+    m_editRow(-1),
+    m_statusRole(-1),
+    m_dirtyRole(-1),
+    m_refreshDeferred(false),
+    m_sortOrder(Qt::AscendingOrder),
+    m_cached(false),
+    m_cacheTtl(0),
+    m_timeoutMs(0),
+    m_plan(new QmlSqlPlan(this)),
+    m_ownsRows(false),
+    m_diffing(false),
+    m_ticket(0),
+    m_workerThread(nullptr),
+    m_worker(nullptr)
 {
+    connect(this, SIGNAL(error(QString)), this, SLOT(handleErrorString(QString)));
 
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(250);
+    connect(&m_refreshTimer, SIGNAL(timeout()), this, SLOT(exec()));
+    m_timeoutTimer.setSingleShot(true);
+    connect(&m_timeoutTimer, SIGNAL(timeout()), this, SLOT(handleTimeout()));
+    connect(QmlSqlChangeNotifier::instance(), SIGNAL(tablesChanged(QString,QStringList)), this, SLOT(handleTablesChanged(QString,QStringList)));
+}
+
+QmlSqlQueryModel::~QmlSqlQueryModel() {
+    m_autoRefresh = false;
+    updateSubscriptions();
+    if (m_workerThread != nullptr) {
+        m_worker->cancel(m_ticket);
+        m_worker->setTicket(-1);
+        m_workerThread->quit();
+        m_workerThread->wait();
+    }
 }
 
 /*!
@@ -60,6 +108,7 @@ void QmlSqlQueryModel::setQueryString(const QString& queryString) {
     if (m_queryString == queryString)
         return;
     m_queryString = queryString ;
+    updateSubscriptions();
     emit queryStringChanged();
 }
 
@@ -71,11 +120,16 @@ void QmlSqlQueryModel::setDatabase(QmlSqlDatabase *database) {
     if (database == m_database)
         return;
 
-    if (m_database != nullptr)
-        disconnect(m_database, SIGNAL(connected()), this, SLOT(exec()));
+    if (m_database != nullptr) {
+        disconnect(m_database, SIGNAL(connected()), this, SLOT(handleConnected()));
+        disconnect(m_database, SIGNAL(disconnected()), this, SLOT(handleDisconnected()));
+    }
 
     m_database = database;
-    connect(m_database, SIGNAL(connected()), this, SLOT(exec()));
+    resetStatement();
+    connect(m_database, SIGNAL(connected()), this, SLOT(handleConnected()));
+    connect(m_database, SIGNAL(disconnected()), this, SLOT(handleDisconnected()));
+    updateSubscriptions();
 
     if (m_database->isConnected())
         exec();
@@ -97,34 +151,1339 @@ QString QmlSqlQueryModel::errorString() const {
     return m_error;
 }
 
-// this is not yet implemented
+/*!
+ \qmlproperty bool QmlSqlQueryModel::readOnly
+  When \c false the rows can be edited through setData(), for example by assigning to a role in a
+  delegate, and through setValue(), appendRow() and deleteRow(). Edits are kept in a buffer and written
+  to tableName according to editStrategy, rows are matched by keyColumn. A writable model keeps its rows
+  the way storage Columnar does.
+
+\code
+    QmlSqlQueryModel{
+        id: employees
+        database: db
+        queryString: "SELECT id, name, salary FROM employee"
+        tableName: "employee"
+        keyColumn: "id"
+        readOnly: false
+        editStrategy: QmlSqlQueryModel.OnManualSubmit
+    }
+    ListView{
+        model: employees
+        delegate: TextField{
+            text: name
+            color: rowDirty ? "red" : "black"
+            onEditingFinished: model.name = text
+        }
+    }
+    Button{
+        enabled: employees.pendingChanges > 0
+        onClicked: employees.submitAll()
+    }
+\endcode
+
+  Besides the columns every row has the roles \c rowStatus, one of QmlSqlQueryModel.Clean, Updated,
+  Inserted or Deleted, and \c rowDirty, which is \c true when the row has changes that are not
+  submitted yet.
+
+  The default is \c true.
+
+  \sa editStrategy, submitAll(), revertAll()
+*/
 bool QmlSqlQueryModel::readOnly() const {
     return m_readOnly;
 }
-// this is not yet implemented
+
 void QmlSqlQueryModel::setReadOnly(bool readOnly) {
     if(m_readOnly == readOnly)
         return;
     m_readOnly = readOnly;
+    resetStatement();
     emit readOnlyChanged();
 }
 
+/*!
+ \qmlproperty bool QmlSqlQueryModel::async
+  When \c true exec() runs the query on a worker thread with its own clone of the connection and the
+  rows are added to the model in batches of batchSize as they arrive, so views can show the first rows
+  while the rest are still being fetched. fetching is \c true until the last batch has been added.
+
+  The default is \c false, which fills the model on the calling thread.
+
+  \sa batchSize, fetching, fetchedRows
+*/
+bool QmlSqlQueryModel::async() const {
+    return m_async;
+}
+
+void QmlSqlQueryModel::setAsync(bool async) {
+    if (m_async == async)
+        return;
+    m_async = async;
+    emit asyncChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlQueryModel::batchSize
+  The number of rows the worker fetches before it hands them to the model when async is \c true.
+  The default is 256.
+*/
+int QmlSqlQueryModel::batchSize() const {
+    return m_batchSize;
+}
+
+void QmlSqlQueryModel::setBatchSize(int batchSize) {
+    if (m_batchSize == batchSize || batchSize < 1)
+        return;
+    m_batchSize = batchSize;
+    emit batchSizeChanged();
+}
+
+/*!
+ \qmlproperty bool QmlSqlQueryModel::fetching
+  Returns \c true while an async exec() is still adding rows to the model.
+*/
+bool QmlSqlQueryModel::fetching() const {
+    return m_fetching;
+}
+
+void QmlSqlQueryModel::setFetching(bool fetching) {
+    if (m_fetching == fetching)
+        return;
+    m_fetching = fetching;
+    if (!fetching)
+        m_timeoutTimer.stop();
+    emit fetchingChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlQueryModel::fetchedRows
+  Returns the number of rows that an async exec() has added to the model so far.
+*/
+int QmlSqlQueryModel::fetchedRows() const {
+    return m_rows.rowCount();
+}
+
+/*!
+ \qmlproperty variant QmlSqlQueryModel::bindValues
+  Values that are bound to the placeholders of queryString by exec(). Use an object for named
+  placeholders or an array for \c ? placeholders. As long as queryString does not change the model
+  executes the same prepared statement again with the new values.
+
+\code
+    QmlSqlQueryModel{
+        id: sqlModel
+        database: db
+        queryString: "SELECT name, salary FROM employee WHERE department = :department"
+        bindValues: { "department": departmentBox.currentText }
+        onBindValuesChanged: exec()
+    }
+\endcode
+
+  \sa bindValue()
+*/
+QVariant QmlSqlQueryModel::bindValues() const {
+    return m_bindValues;
+}
+
+void QmlSqlQueryModel::setBindValues(const QVariant& bindValues) {
+    const QVariant values = QmlSqlQueryWorker::normalizeBindValues(bindValues);
+    if (m_bindValues == values)
+        return;
+    m_bindValues = values;
+    emit bindValuesChanged();
+}
+
+/*!
+ \qmlmethod void QmlSqlQueryModel::bindValue(string placeholder, variant value)
+  Binds \c value to the named \c placeholder the next time exec() is called.
+
+  \sa bindValues
+*/
+void QmlSqlQueryModel::bindValue(const QString& placeholder, const QVariant& value) {
+    QVariantMap values = m_bindValues.toMap();
+    values.insert(placeholder, value);
+    setBindValues(values);
+}
+
+/*!
+ \qmlproperty enum QmlSqlQueryModel::storage
+  Selects where the model keeps the rows of a synchronous exec().
+
+  \list
+  \li QmlSqlQueryModel.Cursor keeps the driver's result open and reads rows from it as views ask for
+      them. This is the default.
+  \li QmlSqlQueryModel.Columnar reads all rows at once into typed per column arrays (integers, doubles,
+      interned strings and blobs) and releases the driver's result right away. data() is served from
+      memory, which makes scrolling back cheap on drivers without random access.
+  \endlist
+
+  Rows fetched with async are always kept the Columnar way.
+
+\code
+    QmlSqlQueryModel{
+        database: db
+        storage: QmlSqlQueryModel.Columnar
+        queryString: "SELECT name, salary FROM employee"
+    }
+\endcode
+*/
+QmlSqlQueryModel::Storage QmlSqlQueryModel::storage() const {
+    return m_storage;
+}
+
+void QmlSqlQueryModel::setStorage(const QmlSqlQueryModel::Storage& storage) {
+    if (m_storage == storage)
+        return;
+    m_storage = storage;
+    resetStatement();
+    emit storageChanged();
+}
+
+/*!
+ \qmlproperty string QmlSqlQueryModel::keyColumn
+  The column that identifies a row, usually the primary key. It is needed for an Incremental refreshMode
+  and its values have to be unique.
+
+  \sa refreshMode
+*/
+QString QmlSqlQueryModel::keyColumn() const {
+    return m_keyColumn;
+}
+
+void QmlSqlQueryModel::setKeyColumn(const QString& keyColumn) {
+    if (m_keyColumn == keyColumn)
+        return;
+    m_keyColumn = keyColumn;
+    resetStatement();
+    emit keyColumnChanged();
+}
+
+/*!
+ \qmlproperty enum QmlSqlQueryModel::refreshMode
+  Selects what happens to the rows when exec() runs again.
+
+  \list
+  \li QmlSqlQueryModel.Reset resets the whole model, views recreate all delegates. This is the default.
+  \li QmlSqlQueryModel.Incremental compares the new rows with the current ones by keyColumn and only
+      inserts, removes and moves the rows that differ and signals dataChanged for rows whose values
+      changed. Delegates, the scroll position and the selection of views are kept. The rows are kept the
+      way storage Columnar keeps them. With async the comparison runs on the worker thread.
+  \endlist
+
+  When the key is missing or not unique, or the columns changed, the model is reset.
+
+\code
+    QmlSqlQueryModel{
+        database: db
+        queryString: "SELECT id, name, salary FROM employee ORDER BY name"
+        keyColumn: "id"
+        refreshMode: QmlSqlQueryModel.Incremental
+    }
+\endcode
+
+  \sa keyColumn, storage
+*/
+QmlSqlQueryModel::RefreshMode QmlSqlQueryModel::refreshMode() const {
+    return m_refreshMode;
+}
+
+void QmlSqlQueryModel::setRefreshMode(const QmlSqlQueryModel::RefreshMode& refreshMode) {
+    if (m_refreshMode == refreshMode)
+        return;
+    m_refreshMode = refreshMode;
+    resetStatement();
+    emit refreshModeChanged();
+}
+
+/*!
+ \qmlproperty bool QmlSqlQueryModel::autoRefresh
+  When \c true the model runs exec() again whenever one of its dependentTables has been written. Writes
+  made through QmlSqlQuery are seen once they are committed. On drivers with database notifications,
+  such as PostgreSQL, the model also subscribes to a notification named like each table, so a trigger
+  that runs \c{NOTIFY employee} reports changes made by other programs too.
+
+  Combine it with an Incremental refreshMode to keep the delegates of views across refreshes.
+
+\code
+    QmlSqlQueryModel{
+        database: db
+        queryString: "SELECT id, name, salary FROM employee"
+        keyColumn: "id"
+        refreshMode: QmlSqlQueryModel.Incremental
+        autoRefresh: true
+    }
+\endcode
+
+  The default is \c false.
+
+  \sa dependentTables, refreshDelay
+*/
+bool QmlSqlQueryModel::autoRefresh() const {
+    return m_autoRefresh;
+}
+
+void QmlSqlQueryModel::setAutoRefresh(bool autoRefresh) {
+    if (m_autoRefresh == autoRefresh)
+        return;
+    m_autoRefresh = autoRefresh;
+    if (!m_autoRefresh)
+        m_refreshTimer.stop();
+    updateSubscriptions();
+    emit autoRefreshChanged();
+}
+
+/*!
+ \qmlproperty list<string> QmlSqlQueryModel::dependentTables
+  The tables autoRefresh watches. When it is empty the tables are taken from the FROM and JOIN clauses
+  of queryString, set it for queries that list tables separated by commas or read them through views.
+*/
+QStringList QmlSqlQueryModel::dependentTables() const {
+    return m_dependentTables;
+}
+
+void QmlSqlQueryModel::setDependentTables(const QStringList& dependentTables) {
+    if (m_dependentTables == dependentTables)
+        return;
+    m_dependentTables = dependentTables;
+    updateSubscriptions();
+    emit dependentTablesChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlQueryModel::refreshDelay
+  How many milliseconds autoRefresh waits after the first change before it runs exec(). All changes in
+  that time are picked up by the same exec(). Changes to sortRole, sortOrder and filters run exec() once
+  they have stopped for this long. The default is 250.
+*/
+int QmlSqlQueryModel::refreshDelay() const {
+    return m_refreshTimer.interval();
+}
+
+void QmlSqlQueryModel::setRefreshDelay(int refreshDelay) {
+    if (m_refreshTimer.interval() == refreshDelay || refreshDelay < 0)
+        return;
+    m_refreshTimer.setInterval(refreshDelay);
+    emit refreshDelayChanged();
+}
+
+void QmlSqlQueryModel::updateSubscriptions() {
+    QString connectionName;
+    QStringList tables;
+    if (m_autoRefresh && m_database != nullptr) {
+        connectionName = m_database->connectionName();
+        if (m_dependentTables.isEmpty()) {
+            tables = QmlSqlChangeNotifier::readTables(m_queryString);
+        }
+        else {
+            foreach (const QString& table, m_dependentTables)
+                tables << table.toLower();
+        }
+    }
+    if (connectionName == m_subscribedConnection && tables == m_subscribedTables)
+        return;
+
+    QmlSqlChangeNotifier* notifier = QmlSqlChangeNotifier::instance();
+    foreach (const QString& table, m_subscribedTables)
+        notifier->unsubscribe(m_subscribedConnection, table);
+    foreach (const QString& table, tables)
+        notifier->subscribe(connectionName, table);
+    m_subscribedConnection = connectionName;
+    m_subscribedTables = tables;
+}
+
+void QmlSqlQueryModel::handleTablesChanged(const QString& connectionName, const QStringList& tables) {
+    if (!m_autoRefresh || connectionName != m_subscribedConnection || m_refreshTimer.isActive())
+        return;
+
+    foreach (const QString& table, tables) {
+        if (m_subscribedTables.contains(table)) {
+            m_refreshTimer.start();
+            return;
+        }
+    }
+}
+
+/*!
+ \qmlproperty string QmlSqlQueryModel::tableName
+  The table that submitAll() writes the edits of a model that is not readOnly to. The roles of the
+  model have to be named like the columns of the table.
+*/
+QString QmlSqlQueryModel::tableName() const {
+    return m_tableName;
+}
+
+void QmlSqlQueryModel::setTableName(const QString& tableName) {
+    if (m_tableName == tableName)
+        return;
+    m_tableName = tableName;
+    emit tableNameChanged();
+}
+
+/*!
+ \qmlproperty enum QmlSqlQueryModel::editStrategy
+  Decides when the edits of a model that is not readOnly are written to the database.
+
+  \list
+  \li QmlSqlQueryModel.OnFieldChange writes every change right away.
+  \li QmlSqlQueryModel.OnRowChange writes the changes of a row once a different row is edited. This is
+      the default.
+  \li QmlSqlQueryModel.OnManualSubmit keeps all changes until submitAll() or revertAll() is called.
+  \endlist
+*/
+QmlSqlQueryModel::EditStrategy QmlSqlQueryModel::editStrategy() const {
+    return m_editStrategy;
+}
+
+void QmlSqlQueryModel::setEditStrategy(const QmlSqlQueryModel::EditStrategy& editStrategy) {
+    if (m_editStrategy == editStrategy)
+        return;
+    m_editStrategy = editStrategy;
+    if (m_editStrategy != OnManualSubmit)
+        submitAll();
+    emit editStrategyChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlQueryModel::pendingChanges
+  Returns how many rows have edits that are not written to the database yet.
+
+  While it is above 0 the model does not refresh: exec(), autoRefresh, a change of sortRole or filters
+  and a reconnect of the database are held back until the edits are submitted or reverted, and then run
+  once. Changing queryString or database drops the edits.
+*/
+int QmlSqlQueryModel::pendingChanges() const {
+    int count = m_deletedRows.count() + m_insertedRows.count();
+    QHash<int, QMap<int, QVariant> >::const_iterator it = m_changedValues.constBegin();
+    for (; it != m_changedValues.constEnd(); ++it) {
+        if (!m_deletedRows.contains(it.key()))
+            count++;
+    }
+    return count;
+}
+
+/*!
+ \qmlmethod int QmlSqlQueryModel::rowStatus(int row)
+  Returns QmlSqlQueryModel.Clean, Updated, Inserted or Deleted for \c row, the same as its \c rowStatus role.
+*/
+int QmlSqlQueryModel::rowStatus(int row) const {
+    if (!m_ownsRows || row < 0)
+        return Clean;
+    if (row >= baseRowCount())
+        return row < rowCount() ? Inserted : Clean;
+    if (m_deletedRows.contains(row))
+        return Deleted;
+    if (m_changedValues.contains(row))
+        return Updated;
+    return Clean;
+}
+
+/*!
+ \qmlmethod bool QmlSqlQueryModel::setValue(int row, string column, variant value)
+  Changes \c column of \c row to \c value, like assigning to the role in a delegate does.
+
+  \sa readOnly
+*/
+bool QmlSqlQueryModel::setValue(int row, const QString& column, const QVariant& value) {
+    return setData(index(row, m_rows.columnIndex(column)), value, Qt::EditRole);
+}
+
+/*!
+ \qmlmethod int QmlSqlQueryModel::appendRow(object values)
+  Adds a row with \c values, an object with a property for each column, at the end of the model and
+  returns its row. Columns without a value get the default of the table. Returns -1 if the model is
+  readOnly.
+
+\code
+    employees.appendRow({ "name": "Ada", "salary": 4200 })
+\endcode
+*/
+int QmlSqlQueryModel::appendRow(const QVariantMap& values) {
+    if (!isWritable())
+        return -1;
+    if (m_editStrategy == OnRowChange && pendingChanges() > 0 && !submitAll())
+        return -1;
+
+    QMap<int, QVariant> row;
+    QVariantMap::const_iterator it = values.constBegin();
+    for (; it != values.constEnd(); ++it) {
+        const int column = m_rows.columnIndex(it.key());
+        if (column >= 0)
+            row.insert(column, it.value());
+    }
+
+    const int first = rowCount();
+    beginInsertRows(QModelIndex(), first, first);
+    m_insertedRows.append(row);
+    endInsertRows();
+    m_editRow = first;
+    emit pendingChangesChanged();
+
+    if (m_editStrategy == OnFieldChange && !submitAll())
+        return -1;
+    return first;
+}
+
+/*!
+ \qmlmethod bool QmlSqlQueryModel::deleteRow(int row)
+  Marks \c row to be deleted. The row stays in the model with the rowStatus Deleted until the change is
+  submitted, a row added with appendRow() that was not submitted yet is removed right away.
+*/
+bool QmlSqlQueryModel::deleteRow(int row) {
+    if (!isWritable() || row < 0 || row >= rowCount())
+        return false;
+
+    const int base = baseRowCount();
+    if (row >= base) {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_insertedRows.remove(row - base);
+        endRemoveRows();
+        emit pendingChangesChanged();
+        return true;
+    }
+
+    m_deletedRows.insert(row);
+    emitRowChanged(row);
+    emit pendingChangesChanged();
+    if (m_editStrategy != OnManualSubmit)
+        return submitAll();
+    return true;
+}
+
+namespace {
+// one prepared statement and the values of all rows it runs for, a list per placeholder
+struct EditBatch
+{
+    EditBatch() : rows(0) {}
+    QString query;
+    QVector<QVariantList> columns;
+    int rows;
+};
+
+void addToBatch(QVector<EditBatch>& batches, QHash<QString, int>& byQuery, const QString& query, const QVariantList& values) {
+    int batch = byQuery.value(query, -1);
+    if (batch < 0) {
+        batch = batches.count();
+        byQuery.insert(query, batch);
+        batches.append(EditBatch());
+        batches[batch].query = query;
+        batches[batch].columns.resize(values.count());
+    }
+    for (int i = 0; i < values.count(); i++)
+        batches[batch].columns[i] << values.at(i);
+    batches[batch].rows++;
+}
+}
+
+/*!
+ \qmlmethod bool QmlSqlQueryModel::submitAll()
+  Writes all pending edits to tableName in one transaction, or in a savepoint when a transaction is
+  already open on the database. Rows that change the same columns share one prepared statement that runs
+  as a batch, deletes run first, then updates and then inserts. On success the edit buffer is emptied and
+  the model runs exec() to pick up values the database filled in. On failure everything is rolled back,
+  the edits stay pending and errorString tells why.
+
+  \sa revertAll(), editStrategy
+*/
+bool QmlSqlQueryModel::submitAll() {
+    if (pendingChanges() == 0)
+        return true;
+
+    if (m_database == nullptr || !m_database->isConnected()) {
+        error("could not submit the changes Reason: the database is not open");
+        return false;
+    }
+    if (m_tableName.isEmpty()) {
+        error("could not submit the changes Reason: tableName is not set");
+        return false;
+    }
+    const int keyColumn = m_rows.columnIndex(m_keyColumn);
+    if (keyColumn < 0 && (!m_changedValues.isEmpty() || !m_deletedRows.isEmpty())) {
+        error("could not submit the changes Reason: keyColumn is not a column of queryString");
+        return false;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database(m_database->connectionName());
+    QSqlDriver* driver = db.driver();
+    const QString table = driver->escapeIdentifier(m_tableName, QSqlDriver::TableName);
+    const QString key = keyColumn < 0 ? QString() : driver->escapeIdentifier(m_keyColumn, QSqlDriver::FieldName);
+    QStringList fields;
+    for (int column = 0; column < m_rows.columnCount(); column++)
+        fields << driver->escapeIdentifier(m_rows.columnName(column), QSqlDriver::FieldName);
+
+    QVector<EditBatch> batches;
+    QHash<QString, int> byQuery;
+
+    QList<int> deleted = m_deletedRows.toList();
+    std::sort(deleted.begin(), deleted.end());
+    foreach (int row, deleted) {
+        addToBatch(batches, byQuery, QString("DELETE FROM %1 WHERE %2 = ?").arg(table, key),
+                   QVariantList() << m_rows.value(row, keyColumn));
+    }
+
+    QList<int> updated = m_changedValues.keys();
+    std::sort(updated.begin(), updated.end());
+    foreach (int row, updated) {
+        if (m_deletedRows.contains(row))
+            continue;
+        const QMap<int, QVariant>& values = m_changedValues[row];
+        QStringList assignments;
+        QVariantList bound;
+        QMap<int, QVariant>::const_iterator it = values.constBegin();
+        for (; it != values.constEnd(); ++it) {
+            assignments << QString("%1 = ?").arg(fields.at(it.key()));
+            bound << it.value();
+        }
+        bound << m_rows.value(row, keyColumn);
+        addToBatch(batches, byQuery, QString("UPDATE %1 SET %2 WHERE %3 = ?").arg(table, assignments.join(", "), key), bound);
+    }
+
+    for (int i = 0; i < m_insertedRows.count(); i++) {
+        const QMap<int, QVariant>& values = m_insertedRows.at(i);
+        QStringList columns;
+        QStringList placeholders;
+        QVariantList bound;
+        QMap<int, QVariant>::const_iterator it = values.constBegin();
+        for (; it != values.constEnd(); ++it) {
+            columns << fields.at(it.key());
+            placeholders << "?";
+            bound << it.value();
+        }
+        const QString query = values.isEmpty()
+                ? QString("INSERT INTO %1 DEFAULT VALUES").arg(table)
+                : QString("INSERT INTO %1 (%2) VALUES (%3)").arg(table, columns.join(", "), placeholders.join(", "));
+        addToBatch(batches, byQuery, query, bound);
+    }
+
+    const bool transaction = driver->hasFeature(QSqlDriver::Transactions);
+    if (transaction && !m_database->transaction()) {
+        error(QString("could not submit the changes Reason: %1").arg(m_database->errorString()));
+        return false;
+    }
+
+    QmlSqlQueryWorker worker;
+    for (int i = 0; i < batches.count(); i++) {
+        const EditBatch& batch = batches.at(i);
+        QmlSqlQueryResult result;
+        if (batch.columns.isEmpty()) {
+            for (int row = 0; row < batch.rows; row++) {
+                result = QmlSqlQueryWorker::execute(db, batch.query);
+                if (!result.ok)
+                    break;
+            }
+        }
+        else {
+            QVariantList columns;
+            foreach (const QVariantList& column, batch.columns)
+                columns << QVariant(column);
+            result = worker.executeBatch(db, batch.query, columns, batch.rows, false);
+        }
+
+        if (!result.ok) {
+            if (transaction)
+                m_database->rollback();
+            error(result.errorString);
+            return false;
+        }
+    }
+
+    if (transaction && !m_database->commit()) {
+        error(QString("could not submit the changes Reason: %1").arg(m_database->errorString()));
+        m_database->rollback();
+        return false;
+    }
+
+    // exec() runs here anyway, a refresh held back by the edits is not run a second time
+    m_refreshDeferred = false;
+    revertAll();
+    exec();
+    return true;
+}
+
+/*!
+ \qmlmethod void QmlSqlQueryModel::revertAll()
+  Drops all edits that are not submitted yet.
+*/
+void QmlSqlQueryModel::revertAll() {
+    if (pendingChanges() == 0)
+        return;
+
+    if (!m_insertedRows.isEmpty()) {
+        const int base = baseRowCount();
+        beginRemoveRows(QModelIndex(), base, base + m_insertedRows.count() - 1);
+        m_insertedRows.clear();
+        endRemoveRows();
+    }
+
+    QSet<int> rows = m_deletedRows;
+    QHash<int, QMap<int, QVariant> >::const_iterator it = m_changedValues.constBegin();
+    for (; it != m_changedValues.constEnd(); ++it)
+        rows.insert(it.key());
+    m_changedValues.clear();
+    m_deletedRows.clear();
+    m_editRow = -1;
+    foreach (int row, rows)
+        emitRowChanged(row);
+    emit pendingChangesChanged();
+    execDeferred();
+}
+
+/*!
+ \qmlmethod void QmlSqlQueryModel::revertRow(int row)
+  Drops the edits of \c row that are not submitted yet. A row added with appendRow() is removed.
+*/
+void QmlSqlQueryModel::revertRow(int row) {
+    if (row < 0 || row >= rowCount() || rowStatus(row) == Clean)
+        return;
+
+    if (row >= baseRowCount()) {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_insertedRows.remove(row - baseRowCount());
+        endRemoveRows();
+    }
+    else {
+        m_changedValues.remove(row);
+        m_deletedRows.remove(row);
+        emitRowChanged(row);
+    }
+    if (m_editRow == row)
+        m_editRow = -1;
+    emit pendingChangesChanged();
+    execDeferred();
+}
+
+/*!
+ \qmlproperty string QmlSqlQueryModel::sortRole
+  The role, which is the name of a column of queryString, the rows are ordered by. The database does
+  the sorting, the model runs queryString wrapped in a \c{SELECT * FROM (...) ORDER BY} of its own.
+  When it is empty the order of queryString is kept, which is the default.
+
+  Changing sortRole, sortOrder or filters runs exec() again after refreshDelay, so a user clicking
+  through column headers causes a single query.
+
+\code
+    QmlSqlQueryModel{
+        id: employees
+        database: db
+        queryString: "SELECT id, name, department, salary FROM employee"
+        sortRole: "salary"
+        sortOrder: Qt.DescendingOrder
+        filters: { "department": departmentBox.currentText, "salary": { ">=": minimumSalary.value } }
+    }
+\endcode
+
+  \sa sortOrder, filters
+*/
+QString QmlSqlQueryModel::sortRole() const {
+    return m_sortRole;
+}
+
+void QmlSqlQueryModel::setSortRole(const QString& sortRole) {
+    if (m_sortRole == sortRole)
+        return;
+    m_sortRole = sortRole;
+    requery();
+    emit sortRoleChanged();
+}
+
+/*!
+ \qmlproperty enumeration QmlSqlQueryModel::sortOrder
+  Qt.AscendingOrder, the default, or Qt.DescendingOrder.
+
+  \sa sortRole
+*/
+Qt::SortOrder QmlSqlQueryModel::sortOrder() const {
+    return m_sortOrder;
+}
+
+void QmlSqlQueryModel::setSortOrder(const Qt::SortOrder& sortOrder) {
+    if (m_sortOrder == sortOrder)
+        return;
+    m_sortOrder = sortOrder;
+    if (!m_sortRole.isEmpty())
+        requery();
+    emit sortOrderChanged();
+}
+
+/*!
+ \qmlproperty object QmlSqlQueryModel::filters
+  Conditions on the columns of queryString that the rows have to meet, added as a WHERE clause around
+  queryString with the values bound as parameters. Every property names a column:
+
+  \list
+  \li a value keeps the rows whose column equals it, \c null keeps the rows where it is NULL
+  \li an array keeps the rows whose column is one of its values
+  \li an object compares with each of its properties, which are one of \c{=, !=, <>, <, <=, >, >=},
+      \c like, \c{not like} or \c in, and \c{{ "null": false }} keeps the rows where it is not NULL.
+      Other properties are ignored
+  \endlist
+
+  All conditions have to be met.
+
+  \sa sortRole
+*/
+QVariant QmlSqlQueryModel::filters() const {
+    return m_filters;
+}
+
+void QmlSqlQueryModel::setFilters(const QVariant& filters) {
+    const QVariantMap values = QmlSqlQueryWorker::normalizeBindValues(filters).toMap();
+    if (m_filters == values)
+        return;
+    m_filters = values;
+    requery();
+    emit filtersChanged();
+}
+
+void QmlSqlQueryModel::sort(int column, Qt::SortOrder order) {
+    setSortRole(column < 0 ? QString() : m_roleList.value(column));
+    setSortOrder(order);
+}
+
+// sort and filter changes are collected by the refresh timer into one exec()
+void QmlSqlQueryModel::requery() {
+    if (m_database != nullptr && m_database->isConnected())
+        m_refreshTimer.start();
+}
+
+// queryString with sortRole and filters applied, bindValues gets the filter values added
+QString QmlSqlQueryModel::effectiveQuery(QVariant* bindValues) const {
+    *bindValues = m_bindValues;
+    if (m_sortRole.isEmpty() && m_filters.isEmpty())
+        return m_queryString;
+
+    const QSqlDriver* driver = QSqlDatabase::database(m_database->connectionName()).driver();
+    QString query = m_queryString.trimmed();
+    while (query.endsWith(';'))
+        query.chop(1);
+    // Oracle does not take AS in front of a table alias, every other database is fine without it
+    query = QString("SELECT * FROM (%1) qmlsql_view").arg(query);
+
+    const QString where = filterClause(driver, bindValues);
+    if (!where.isEmpty())
+        query += " WHERE " + where;
+    if (!m_sortRole.isEmpty()) {
+        query += QString(" ORDER BY %1 %2").arg(driver->escapeIdentifier(m_sortRole, QSqlDriver::FieldName),
+                                                m_sortOrder == Qt::AscendingOrder ? "ASC" : "DESC");
+    }
+    return query;
+}
+
+namespace {
+
+// collects the values of a WHERE clause, positional bindValues get "?" placeholders after those of
+// queryString, otherwise named ones are added
+struct FilterValues
+{
+    explicit FilterValues(const QVariant& bindValues)
+        : positional(bindValues.type() == QVariant::List), list(bindValues.toList()), map(bindValues.toMap()) {}
+
+    QString placeholder(const QVariant& value) {
+        if (positional) {
+            list << value;
+            return "?";
+        }
+        const QString name = QString(":qmlsql_filter_%1").arg(map.size());
+        map.insert(name, value);
+        return name;
+    }
+
+    QString in(const QVariantList& values) {
+        if (values.isEmpty())
+            return "IN (NULL)";
+        QStringList names;
+        foreach (const QVariant& value, values)
+            names << placeholder(value);
+        return QString("IN (%1)").arg(names.join(", "));
+    }
+
+    QVariant bindValues(const QVariant& original) const {
+        if (positional)
+            return list;
+        return map.isEmpty() ? original : QVariant(map);
+    }
+
+    bool positional;
+    QVariantList list;
+    QVariantMap map;
+};
+
+} // namespace
+
+QString QmlSqlQueryModel::filterClause(const QSqlDriver* driver, QVariant* bindValues) const {
+    static const QStringList operators = QStringList() << "=" << "!=" << "<>" << "<" << "<=" << ">" << ">=" << "like" << "not like";
+
+    FilterValues values(*bindValues);
+    QStringList conditions;
+    QVariantMap::const_iterator it = m_filters.constBegin();
+    for (; it != m_filters.constEnd(); ++it) {
+        const QString column = driver->escapeIdentifier(it.key(), QSqlDriver::FieldName);
+        const QVariant& value = it.value();
+        if (value.type() == QVariant::List) {
+            conditions << QString("%1 %2").arg(column, values.in(value.toList()));
+        }
+        else if (value.type() == QVariant::Map) {
+            const QVariantMap comparisons = value.toMap();
+            QVariantMap::const_iterator comparison = comparisons.constBegin();
+            for (; comparison != comparisons.constEnd(); ++comparison) {
+                const QString op = comparison.key().trimmed().toLower();
+                if (op == "in")
+                    conditions << QString("%1 %2").arg(column, values.in(comparison.value().toList()));
+                else if (op == "null")
+                    conditions << QString("%1 %2").arg(column, comparison.value().toBool() ? "IS NULL" : "IS NOT NULL");
+                else if (operators.contains(op))
+                    conditions << QString("%1 %2 %3").arg(column, op.toUpper(), values.placeholder(comparison.value()));
+            }
+        }
+        else if (value.isNull()) {
+            conditions << QString("%1 IS NULL").arg(column);
+        }
+        else {
+            conditions << QString("%1 = %2").arg(column, values.placeholder(value));
+        }
+    }
+
+    *bindValues = values.bindValues(*bindValues);
+    return conditions.join(" AND ");
+}
+
+/*!
+ \qmlproperty bool QmlSqlQueryModel::cached
+  When true exec() takes the rows from QmlSqlResultCache if a model has read them for the same
+  queryString, bindValues, sortRole, filters and connection before, and stores the rows it reads there.
+  The rows are dropped from the cache when a table the query reads is written to, see QmlSqlResultCache.
+
+  A cached model keeps its rows itself, as with storage set to Columnar. The default is false.
+
+\code
+    QmlSqlQueryModel{
+        database: db
+        queryString: "SELECT code, name FROM country"
+        cached: true
+        cacheTtl: 60000
+        Component.onCompleted: exec()
+    }
+\endcode
+
+  \sa cacheTtl
+*/
+bool QmlSqlQueryModel::cached() const {
+    return m_cached;
+}
+
+void QmlSqlQueryModel::setCached(bool cached) {
+    if (m_cached == cached)
+        return;
+    m_cached = cached;
+    m_cacheKey.clear();
+    emit cachedChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlQueryModel::cacheTtl
+  For how many milliseconds the rows this model stores in the cache may be used. With 0, the default,
+  they are kept until their tables are written to or they are evicted.
+
+  \sa cached
+*/
+int QmlSqlQueryModel::cacheTtl() const {
+    return m_cacheTtl;
+}
+
+void QmlSqlQueryModel::setCacheTtl(int cacheTtl) {
+    if (m_cacheTtl == cacheTtl)
+        return;
+    m_cacheTtl = cacheTtl;
+    emit cacheTtlChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlQueryModel::timeoutMs
+  When async is set, an exec() that is still fetching after this many milliseconds is cancelled like
+  cancel() does and timedOut() is emitted instead of cancelled(). The default is 0, which never times out.
+  A synchronous exec() can not time out.
+
+  \sa cancel()
+*/
+int QmlSqlQueryModel::timeoutMs() const {
+    return m_timeoutMs;
+}
+
+void QmlSqlQueryModel::setTimeoutMs(int timeoutMs) {
+    if (m_timeoutMs == timeoutMs)
+        return;
+    m_timeoutMs = timeoutMs;
+    emit timeoutMsChanged();
+}
+
+/*!
+ \qmlmethod void QmlSqlQueryModel::cancel()
+  Stops an async exec() that is still fetching. Its statement is aborted the way the driver allows, see
+  QmlSqlQuery::cancel(), and the rows fetched so far stay in the model. fetching turns \c false and
+  cancelled() is emitted, errorString is left alone and nothing is stored in the cache. The next exec()
+  can run right away.
+
+  \sa timeoutMs
+*/
+void QmlSqlQueryModel::cancel() {
+    if (abandonFetch())
+        emit cancelled();
+}
+
+/*!
+ \qmlproperty QmlSqlPlan QmlSqlQueryModel::plan
+  The query plan explain() read last.
+
+  \sa explain()
+*/
+QmlSqlPlan* QmlSqlQueryModel::plan() const {
+    return m_plan;
+}
+
+/*!
+ \qmlmethod bool QmlSqlQueryModel::explain()
+  Reads the query plan of the statement exec() would run, queryString with sortRole and filters applied,
+  into plan without running it. This happens on the calling thread. Returns \c false and sets errorString
+  if the plan could not be read.
+
+  \sa plan, QmlSqlQuery::explain()
+*/
+bool QmlSqlQueryModel::explain() {
+    if (m_database == nullptr) {
+        error(QString("could not explain query of %1 Reason: no database is set").arg(m_queryString));
+        return false;
+    }
+    QVariant bindValues;
+    const QString query = effectiveQuery(&bindValues);
+    if (!m_plan->read(QSqlDatabase::database(m_database->connectionName(), false), query, bindValues)) {
+        error(m_plan->errorString());
+        return false;
+    }
+    return true;
+}
+
+void QmlSqlQueryModel::handleTimeout() {
+    if (abandonFetch())
+        emit timedOut();
+}
+
+void QmlSqlQueryModel::startFetch() {
+    m_worker->setTicket(++m_ticket);
+    setFetching(true);
+    if (m_timeoutMs > 0)
+        m_timeoutTimer.start(m_timeoutMs);
+}
+
+bool QmlSqlQueryModel::abandonFetch() {
+    if (!m_fetching || m_worker == nullptr)
+        return false;
+    const int ticket = m_ticket;
+    m_worker->setTicket(++m_ticket);
+    m_worker->cancel(ticket);
+    m_cacheKey.clear();
+    setFetching(false);
+    return true;
+}
+
+// serves exec() from QmlSqlResultCache, the rows are shared with the other models that use them
+bool QmlSqlQueryModel::execCached() {
+    QmlSqlResultSet rows;
+    if (!QmlSqlResultCache::instance()->find(m_cacheKey, &rows))
+        return false;
+
+    if (m_worker != nullptr)
+        m_worker->setTicket(++m_ticket);
+    setFetching(false);
+    if (incremental() && m_ownsRows)
+        applyDiff(rows, QmlSqlRowDiff::compute(m_rows, rows, rows.columnIndex(m_keyColumn)));
+    else
+        resetRows(rows);
+    emit fetchedRowsChanged();
+    return true;
+}
+
+void QmlSqlQueryModel::storeCached() {
+    if (m_cacheKey.isEmpty())
+        return;
+    QmlSqlResultCache::instance()->insert(m_cacheKey, m_database->connectionName(), m_cacheTables, m_rows, m_cacheTtl);
+    m_cacheKey.clear();
+}
+
+bool QmlSqlQueryModel::isWritable() const {
+    return !m_readOnly && m_ownsRows && !m_diffing && m_rows.columnCount() > 0;
+}
+
+int QmlSqlQueryModel::baseRowCount() const {
+    if (!m_ownsRows)
+        return QSqlQueryModel::rowCount();
+    return m_diffing ? m_rowRefs.count() : m_rows.rowCount();
+}
+
+bool QmlSqlQueryModel::bufferValue(int row, int column, const QVariant& value) {
+    const int base = baseRowCount();
+    if (row >= base) {
+        m_insertedRows[row - base].insert(column, value);
+    }
+    else if (m_deletedRows.contains(row)) {
+        return false;
+    }
+    else if (m_rows.value(row, column) == value) {
+        // back to what the database has
+        QHash<int, QMap<int, QVariant> >::iterator values = m_changedValues.find(row);
+        if (values != m_changedValues.end()) {
+            values->remove(column);
+            if (values->isEmpty())
+                m_changedValues.erase(values);
+        }
+    }
+    else {
+        m_changedValues[row].insert(column, value);
+    }
+    return true;
+}
+
+// the edit buffer belongs to the rows, this goes with a reset of the model
+void QmlSqlQueryModel::clearEdits() {
+    const bool hadChanges = pendingChanges() > 0;
+    m_changedValues.clear();
+    m_deletedRows.clear();
+    m_insertedRows.clear();
+    m_editRow = -1;
+    m_refreshDeferred = false;
+    if (hadChanges)
+        emit pendingChangesChanged();
+}
+
+// a refresh would replace the rows the edit buffer points into, it waits until the buffer is empty
+bool QmlSqlQueryModel::deferRefresh() {
+    if (pendingChanges() == 0)
+        return false;
+    m_refreshDeferred = true;
+    return true;
+}
+
+void QmlSqlQueryModel::execDeferred() {
+    if (!m_refreshDeferred || pendingChanges() > 0)
+        return;
+    m_refreshDeferred = false;
+    exec();
+}
+
+void QmlSqlQueryModel::emitRowChanged(int row) {
+    emit dataChanged(index(row, 0), index(row, qMax(0, columnCount() - 1)));
+}
+
+bool QmlSqlQueryModel::incremental() const {
+    return m_refreshMode == Incremental && !m_keyColumn.isEmpty();
+}
+
+// the prepared statement belongs to the connection that was closed, a reopened one is added anew
+void QmlSqlQueryModel::handleConnected() {
+    resetStatement();
+    exec();
+}
+
+void QmlSqlQueryModel::handleDisconnected() {
+    resetStatement();
+}
+
+void QmlSqlQueryModel::resetStatement() {
+    m_statement = QSqlQuery();
+    m_statementQuery.clear();
+    m_statementConnection.clear();
+}
+
 /*!
  \qmlmethod void QmlSqlQueryModel::exec()
  Fills or refils the model based on the queryString that one sets. If there is a error one can use errorString or its signal onErrorStringChaned to gather information about that error
 
- \sa queryString , errorString
+ While edits are pending it does nothing until they are submitted or reverted, see pendingChanges.
+
+ \sa queryString , errorString, async
 */
 void QmlSqlQueryModel::exec() {
-    QSqlDatabase db = QSqlDatabase::database(m_database->connectionName());
-    QSqlQueryModel::setQuery(m_queryString, db);
+    if (deferRefresh())
+        return;
+
+    QVariant bindValues;
+    const QString query = effectiveQuery(&bindValues);
+
+    m_cacheKey.clear();
+    if (m_cached) {
+        m_cacheKey = QmlSqlResultCache::key(m_database->connectionName(), query, bindValues);
+        m_cacheTables = QmlSqlChangeNotifier::readTables(m_queryString);
+        if (execCached())
+            return;
+    }
+
+    if (m_async) {
+        startWorker();
+        if (incremental() && m_ownsRows && m_rows.columnCount() > 0) {
+            startFetch();
+            emit refreshRequested(QmlSqlConnectionParams::fromConnection(m_database->connectionName()), query, bindValues, m_rows, m_keyColumn, m_ticket);
+            return;
+        }
+        clear();
+        m_ownsRows = true;
+        startFetch();
+        emit fetchRequested(QmlSqlConnectionParams::fromConnection(m_database->connectionName()), query, bindValues, m_batchSize, m_ticket);
+        return;
+    }
+
+    const bool readsRows = m_storage == Columnar || incremental() || !m_readOnly || m_cached;
+    if (m_ownsRows && !readsRows)
+        clear();
+
+    const QString connectionName = m_database->connectionName();
+    QSqlDatabase db = QSqlDatabase::database(connectionName);
+    QmlSqlStats::Sample sample(connectionName, query);
+    if (m_statementQuery != query || m_statementConnection != connectionName) {
+        m_statement = QSqlQuery(db);
+        // the statement is prepared forward only when the rows are read into m_rows
+        m_statement.setForwardOnly(readsRows);
+        if (m_statement.prepare(query)) {
+            m_statementQuery = query;
+            m_statementConnection = connectionName;
+        }
+        else {
+            m_statementQuery.clear();
+            m_statementConnection.clear();
+        }
+    }
+    QmlSqlQueryWorker::bind(m_statement, bindValues);
+    sample.prepared();
+
+    if (readsRows) {
+        execColumnar(sample);
+        QmlSqlStats::instance()->checkPlan(db, sample, bindValues);
+        return;
+    }
+
+    beginResetModel();
+    m_statement.exec();
+    sample.executed();
+    QSqlQueryModel::setQuery(m_statement);
+    // the rows after the first ones are fetched lazily and are not counted
+    sample.fetched(QSqlQueryModel::rowCount(), 0);
+    // the roles have to be in place before the views see the reset
+    const QSqlRecord columns = record();
+    QStringList names;
+    names.reserve(columns.count());
+    for (int i = 0; i < columns.count(); i++)
+        names.append(columns.fieldName(i));
+    updateRoles(names);
+    endResetModel();
+
+    if (this->lastError().isValid())
+        sample.failed();
+    QmlSqlStats::instance()->record(sample);
+
+    QmlSqlStats::instance()->checkPlan(db, sample, bindValues);
 
     if (this->lastError().isValid()) {
         error(parseError(this->lastError().type()));
         return ;
     }
-    else {
-        roleNames();
+}
+
+// reads every row of m_statement into m_rows and lets go of the driver's result
+void QmlSqlQueryModel::execColumnar(QmlSqlStats::Sample& sample) {
+    if (m_worker != nullptr)
+        m_worker->setTicket(++m_ticket);
+    setFetching(false);
+
+    QmlSqlResultSet rows;
+    const bool executed = m_statement.exec();
+    sample.executed();
+    if (executed) {
+        rows = QmlSqlResultSet(m_statement.record());
+        while (m_statement.next())
+            rows.appendRow(m_statement);
+    }
+    const QSqlError lastError = m_statement.lastError();
+    m_statement.finish();
+    sample.fetched(rows.rowCount(), rows.byteSize());
+    if (lastError.isValid())
+        sample.failed();
+    QmlSqlStats::instance()->record(sample);
+
+    if (incremental() && m_ownsRows && !lastError.isValid())
+        applyDiff(rows, QmlSqlRowDiff::compute(m_rows, rows, rows.columnIndex(m_keyColumn)));
+    else
+        resetRows(rows);
+    emit fetchedRowsChanged();
+
+    if (lastError.isValid()) {
+        m_cacheKey.clear();
+        error(parseError(lastError.type()));
+        return;
+    }
+    storeCached();
+}
+
+void QmlSqlQueryModel::resetRows(const QmlSqlResultSet& rows) {
+    beginResetModel();
+    QSqlQueryModel::clear();
+    clearEdits();
+    m_ownsRows = true;
+    m_rows = rows;
+    updateRoles(m_rows.columnNames());
+    endResetModel();
+}
+
+// applies the operations one by one, in between data() serves the rows through m_rowRefs
+void QmlSqlQueryModel::applyDiff(const QmlSqlResultSet& rows, const QmlSqlRowDiff& diff) {
+    if (!diff.isValid()) {
+        resetRows(rows);
+        return;
+    }
+    revertAll();
+
+    m_diffing = true;
+    m_pendingRows = rows;
+    m_rowRefs.resize(m_rows.rowCount());
+    for (int row = 0; row < m_rowRefs.count(); row++)
+        m_rowRefs[row] = -(row + 1);
+
+    const QVector<QmlSqlRowDiff::Operation> operations = diff.operations();
+    for (int i = 0; i < operations.count(); i++) {
+        const QmlSqlRowDiff::Operation& operation = operations.at(i);
+        switch (operation.type) {
+        case QmlSqlRowDiff::Remove:
+            beginRemoveRows(QModelIndex(), operation.first, operation.last);
+            m_rowRefs.remove(operation.first, operation.last - operation.first + 1);
+            endRemoveRows();
+            break;
+        case QmlSqlRowDiff::Insert:
+            beginInsertRows(QModelIndex(), operation.first, operation.last);
+            for (int row = operation.first; row <= operation.last; row++)
+                m_rowRefs.insert(row, row);
+            endInsertRows();
+            break;
+        case QmlSqlRowDiff::Move: {
+            if (!beginMoveRows(QModelIndex(), operation.first, operation.last, QModelIndex(), operation.destination))
+                break;
+            const int ref = m_rowRefs.at(operation.first);
+            m_rowRefs.remove(operation.first);
+            m_rowRefs.insert(operation.destination > operation.first ? operation.destination - 1 : operation.destination, ref);
+            endMoveRows();
+            break;
+        }
+        }
+    }
+
+    m_rows = rows;
+    m_diffing = false;
+    m_rowRefs.clear();
+    m_pendingRows = QmlSqlResultSet();
+
+    const QVector<int> changed = diff.changedRows();
+    const int lastColumn = qMax(0, m_rows.columnCount() - 1);
+    for (int i = 0; i < changed.count(); i++) {
+        const int first = changed.at(i);
+        while (i + 1 < changed.count() && changed.at(i + 1) == changed.at(i) + 1)
+            i++;
+        emit dataChanged(index(first, 0), index(changed.at(i), lastColumn));
     }
 }
 
@@ -132,13 +1491,156 @@ void QmlSqlQueryModel::clearModel() {
     this->clear();
 }
 
-QHash<int, QByteArray>QmlSqlQueryModel::roleNames() const {
-    QHash<int, QByteArray> hash;
-    for(int i = 0; i < record().count(); i++) {
-        hash.insert(Qt::UserRole + i + 1, QByteArray(record().fieldName(i).toLatin1()));
+void QmlSqlQueryModel::clear() {
+    // stop a fetch that is still running, its batches are dropped from here on
+    if (m_worker != nullptr)
+        m_worker->setTicket(++m_ticket);
+    setFetching(false);
+
+    beginResetModel();
+    const bool hadRows = m_rows.rowCount() > 0;
+    clearEdits();
+    m_ownsRows = false;
+    m_rows.clear();
+    QSqlQueryModel::clear();
+    resetStatement();
+    updateRoles(QStringList());
+    endResetModel();
+
+    if (hadRows)
+        emit fetchedRowsChanged();
+}
+
+int QmlSqlQueryModel::rowCount(const QModelIndex& parent) const {
+    if (!m_ownsRows)
+        return QSqlQueryModel::rowCount(parent);
+    if (parent.isValid())
+        return 0;
+    return baseRowCount() + m_insertedRows.count();
+}
+
+int QmlSqlQueryModel::columnCount(const QModelIndex& parent) const {
+    if (!m_ownsRows)
+        return QSqlQueryModel::columnCount(parent);
+    return parent.isValid() ? 0 : m_rows.columnCount();
+}
+
+bool QmlSqlQueryModel::canFetchMore(const QModelIndex& parent) const {
+    if (m_ownsRows)
+        return false;
+    return QSqlQueryModel::canFetchMore(parent);
+}
+
+void QmlSqlQueryModel::fetchMore(const QModelIndex& parent) {
+    if (m_ownsRows)
+        return;
+    QSqlQueryModel::fetchMore(parent);
+}
+
+QVariant QmlSqlQueryModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (!m_ownsRows)
+        return QSqlQueryModel::headerData(section, orientation, role);
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < m_rows.columnCount())
+        return m_rows.columnName(section);
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+void QmlSqlQueryModel::startWorker() {
+    if (m_workerThread != nullptr)
+        return;
+
+    qRegisterMetaType<QmlSqlConnectionParams>();
+    qRegisterMetaType<QmlSqlResultSet>();
+    qRegisterMetaType<QmlSqlRowDiff>();
+
+    m_workerThread = new QThread(this);
+    m_worker = new QmlSqlModelWorker;
+    m_worker->moveToThread(m_workerThread);
+    connect(m_workerThread, SIGNAL(finished()), m_worker, SLOT(deleteLater()));
+    connect(this, SIGNAL(fetchRequested(QmlSqlConnectionParams,QString,QVariant,int,int)), m_worker, SLOT(fetch(QmlSqlConnectionParams,QString,QVariant,int,int)));
+    connect(m_worker, SIGNAL(columnsReady(QmlSqlResultSet,int)), this, SLOT(handleColumnsReady(QmlSqlResultSet,int)));
+    connect(m_worker, SIGNAL(batchReady(QmlSqlResultSet,int)), this, SLOT(handleBatchReady(QmlSqlResultSet,int)));
+    connect(this, SIGNAL(refreshRequested(QmlSqlConnectionParams,QString,QVariant,QmlSqlResultSet,QString,int)), m_worker, SLOT(refresh(QmlSqlConnectionParams,QString,QVariant,QmlSqlResultSet,QString,int)));
+    connect(m_worker, SIGNAL(diffReady(QmlSqlResultSet,QmlSqlRowDiff,int)), this, SLOT(handleDiffReady(QmlSqlResultSet,QmlSqlRowDiff,int)));
+    connect(m_worker, SIGNAL(finished(QString,int)), this, SLOT(handleFetchFinished(QString,int)));
+    m_workerThread->start();
+}
+
+void QmlSqlQueryModel::handleColumnsReady(const QmlSqlResultSet& columns, int ticket) {
+    if (ticket != m_ticket)
+        return;
+
+    beginResetModel();
+    clearEdits();
+    m_rows = columns;
+    updateRoles(columns.columnNames());
+    endResetModel();
+}
+
+void QmlSqlQueryModel::updateRoles(const QStringList& columns) {
+    QHash<int, QByteArray> roles;
+    roles.reserve(columns.count());
+    QVector<int> roleColumns;
+    roleColumns.reserve(columns.count());
+    for (int i = 0; i < columns.count(); i++) {
+        roles.insert(Qt::UserRole + i + 1, columns.at(i).toLatin1());
+        roleColumns.append(i);
     }
-    return hash;
+    // the edit state of a row, after the columns
+    m_statusRole = columns.isEmpty() ? -1 : Qt::UserRole + columns.count() + 1;
+    m_dirtyRole = columns.isEmpty() ? -1 : Qt::UserRole + columns.count() + 2;
+    if (!columns.isEmpty()) {
+        roles.insert(m_statusRole, "rowStatus");
+        roles.insert(m_dirtyRole, "rowDirty");
+    }
+    m_roleNames = roles;
+    m_roleColumns = roleColumns;
+
+    if (m_roleList != columns) {
+        m_roleList = columns;
+        emit rolesListChanged();
+    }
+}
 
+void QmlSqlQueryModel::handleBatchReady(const QmlSqlResultSet& rows, int ticket) {
+    if (ticket != m_ticket || rows.rowCount() == 0)
+        return;
+
+    const int first = m_rows.rowCount();
+    beginInsertRows(QModelIndex(), first, first + rows.rowCount() - 1);
+    m_rows.append(rows);
+    endInsertRows();
+    emit fetchedRowsChanged();
+}
+
+void QmlSqlQueryModel::handleDiffReady(const QmlSqlResultSet& rows, const QmlSqlRowDiff& diff, int ticket) {
+    if (ticket != m_ticket)
+        return;
+
+    // edits made while the rows were fetched keep their rows, the refresh runs again once they are gone
+    if (deferRefresh()) {
+        m_cacheKey.clear();
+        return;
+    }
+    applyDiff(rows, diff);
+    emit fetchedRowsChanged();
+}
+
+void QmlSqlQueryModel::handleFetchFinished(const QString& errorString, int ticket) {
+    if (ticket != m_ticket)
+        return;
+
+    setFetching(false);
+    if (!errorString.isEmpty()) {
+        m_cacheKey.clear();
+        error(errorString);
+        return;
+    }
+    storeCached();
+}
+
+QHash<int, QByteArray>QmlSqlQueryModel::roleNames() const {
+    return m_roleNames;
 }
 
 QString QmlSqlQueryModel::parseError(const QSqlError::ErrorType& mError) {
@@ -171,14 +1673,82 @@ void QmlSqlQueryModel::handleErrorString(const QString& errorString) {
 
 // set up the model
 QVariant QmlSqlQueryModel::data(const QModelIndex& index, int role)const {
-    QVariant value = QSqlQueryModel::data(index, role);
-    if(role < Qt::UserRole) {
-        value = QSqlQueryModel::data(index, role);
+    if (!index.isValid())
+        return QVariant();
+
+    int columnIdx = index.column();
+    if (role >= Qt::UserRole) {
+        const int roleIdx = role - Qt::UserRole - 1;
+        if (roleIdx < 0 || roleIdx >= m_roleColumns.count()) {
+            if (role == m_statusRole)
+                return rowStatus(index.row());
+            if (role == m_dirtyRole)
+                return rowStatus(index.row()) != Clean;
+            return QVariant();
+        }
+        columnIdx = m_roleColumns.at(roleIdx);
+        role = Qt::DisplayRole;
     }
-    else {
-        int columnIdx = role - Qt::UserRole - 1;
-        QModelIndex modelIndex = this->index(index.row(), columnIdx);
-        value = QSqlQueryModel::data(modelIndex, Qt::DisplayRole);
+
+    if (m_ownsRows) {
+        if (role != Qt::DisplayRole && role != Qt::EditRole)
+            return QVariant();
+        if (m_diffing) {
+            const int ref = m_rowRefs.value(index.row(), -1 - m_rows.rowCount());
+            return ref >= 0 ? m_pendingRows.value(ref, columnIdx) : m_rows.value(-(ref + 1), columnIdx);
+        }
+        const int base = m_rows.rowCount();
+        if (index.row() >= base)
+            return m_insertedRows.value(index.row() - base).value(columnIdx);
+        if (!m_changedValues.isEmpty()) {
+            QHash<int, QMap<int, QVariant> >::const_iterator values = m_changedValues.constFind(index.row());
+            if (values != m_changedValues.constEnd() && values->contains(columnIdx))
+                return values->value(columnIdx);
+        }
+        return m_rows.value(index.row(), columnIdx);
+    }
+
+    if (columnIdx == index.column())
+        return QSqlQueryModel::data(index, role);
+    return QSqlQueryModel::data(createIndex(index.row(), columnIdx), role);
+}
+
+bool QmlSqlQueryModel::setData(const QModelIndex& index, const QVariant& value, int role) {
+    if (!isWritable() || !index.isValid())
+        return false;
+
+    int column = index.column();
+    if (role >= Qt::UserRole) {
+        const int roleIdx = role - Qt::UserRole - 1;
+        if (roleIdx < 0 || roleIdx >= m_roleColumns.count())
+            return false;
+        column = m_roleColumns.at(roleIdx);
     }
-    return value;
+    else if (role != Qt::EditRole && role != Qt::DisplayRole) {
+        return false;
+    }
+
+    int row = index.row();
+    if (m_editStrategy == OnRowChange && m_editRow >= 0 && m_editRow != row && pendingChanges() > 0) {
+        // submitAll() runs exec(), the row is looked up again afterwards
+        if (!submitAll() || row >= rowCount())
+            return false;
+    }
+
+    if (!bufferValue(row, column, value))
+        return false;
+    m_editRow = row;
+    emitRowChanged(row);
+    emit pendingChangesChanged();
+
+    if (m_editStrategy == OnFieldChange)
+        return submitAll();
+    return true;
+}
+
+Qt::ItemFlags QmlSqlQueryModel::flags(const QModelIndex& index) const {
+    Qt::ItemFlags flags = QSqlQueryModel::flags(index);
+    if (index.isValid() && isWritable())
+        flags |= Qt::ItemIsEditable;
+    return flags;
 }
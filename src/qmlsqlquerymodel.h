@@ -1,6 +1,7 @@
 #ifndef SQLQUERYMODEL_H
 #define SQLQUERYMODEL_H
 #include <QSqlQueryModel>
+#include <QSqlQuery>
 #include <QSqlDatabase>
 #include <QSqlRecord>
 #include <QSqlField>
@@ -9,7 +10,16 @@
 #include <QDebug>
 #include <QVariant>
 #include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QMap>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
 
+#include "qmlsqlmodelworker.h"
+#include "qmlsqlstats.h"
+#include "qmlsqlplan.h"
 
 class QmlSqlDatabase;
 
@@ -22,10 +32,41 @@ class QmlSqlQueryModel : public QSqlQueryModel
     Q_PROPERTY(QStringList rolesList READ rolesList  NOTIFY rolesListChanged)
     Q_PROPERTY(QString errorString READ errorString NOTIFY errorStringChanged)
     Q_PROPERTY(bool readOnly READ readOnly WRITE setReadOnly NOTIFY readOnlyChanged)
+    Q_PROPERTY(bool async READ async WRITE setAsync NOTIFY asyncChanged)
+    Q_PROPERTY(int batchSize READ batchSize WRITE setBatchSize NOTIFY batchSizeChanged)
+    Q_PROPERTY(bool fetching READ fetching NOTIFY fetchingChanged)
+    Q_PROPERTY(int fetchedRows READ fetchedRows NOTIFY fetchedRowsChanged)
+    Q_PROPERTY(QVariant bindValues READ bindValues WRITE setBindValues NOTIFY bindValuesChanged)
+    Q_PROPERTY(Storage storage READ storage WRITE setStorage NOTIFY storageChanged)
+    Q_PROPERTY(QString keyColumn READ keyColumn WRITE setKeyColumn NOTIFY keyColumnChanged)
+    Q_PROPERTY(RefreshMode refreshMode READ refreshMode WRITE setRefreshMode NOTIFY refreshModeChanged)
+    Q_PROPERTY(bool autoRefresh READ autoRefresh WRITE setAutoRefresh NOTIFY autoRefreshChanged)
+    Q_PROPERTY(QStringList dependentTables READ dependentTables WRITE setDependentTables NOTIFY dependentTablesChanged)
+    Q_PROPERTY(int refreshDelay READ refreshDelay WRITE setRefreshDelay NOTIFY refreshDelayChanged)
+    Q_PROPERTY(QString tableName READ tableName WRITE setTableName NOTIFY tableNameChanged)
+    Q_PROPERTY(EditStrategy editStrategy READ editStrategy WRITE setEditStrategy NOTIFY editStrategyChanged)
+    Q_PROPERTY(int pendingChanges READ pendingChanges NOTIFY pendingChangesChanged)
+    Q_PROPERTY(QString sortRole READ sortRole WRITE setSortRole NOTIFY sortRoleChanged)
+    Q_PROPERTY(Qt::SortOrder sortOrder READ sortOrder WRITE setSortOrder NOTIFY sortOrderChanged)
+    Q_PROPERTY(QVariant filters READ filters WRITE setFilters NOTIFY filtersChanged)
+    Q_PROPERTY(bool cached READ cached WRITE setCached NOTIFY cachedChanged)
+    Q_PROPERTY(int cacheTtl READ cacheTtl WRITE setCacheTtl NOTIFY cacheTtlChanged)
+    Q_PROPERTY(int timeoutMs READ timeoutMs WRITE setTimeoutMs NOTIFY timeoutMsChanged)
+    Q_PROPERTY(QmlSqlPlan* plan READ plan CONSTANT)
+    Q_ENUMS(Storage)
+    Q_ENUMS(RefreshMode)
+    Q_ENUMS(EditStrategy)
+    Q_ENUMS(RowStatus)
 
 
 public:
     explicit QmlSqlQueryModel(QObject *parent = nullptr);
+    ~QmlSqlQueryModel();
+
+    enum Storage{ Cursor, Columnar };
+    enum RefreshMode{ Reset, Incremental };
+    enum EditStrategy{ OnFieldChange, OnRowChange, OnManualSubmit };
+    enum RowStatus{ Clean, Updated, Inserted, Deleted };
 
     QString queryString() const;
     void setQueryString(const QString& queryString);
@@ -40,8 +81,86 @@ public:
     bool readOnly() const;
     void setReadOnly(bool readOnly);
 
+    bool async() const;
+    void setAsync(bool async);
+
+    int batchSize() const;
+    void setBatchSize(int batchSize);
+
+    bool fetching() const;
+    int fetchedRows() const;
+
+    QVariant bindValues() const;
+    void setBindValues(const QVariant& bindValues);
+    Q_INVOKABLE void bindValue(const QString& placeholder, const QVariant& value);
+
+    Storage storage() const;
+    void setStorage(const Storage& storage);
+
+    QString keyColumn() const;
+    void setKeyColumn(const QString& keyColumn);
+
+    RefreshMode refreshMode() const;
+    void setRefreshMode(const RefreshMode& refreshMode);
+
+    bool autoRefresh() const;
+    void setAutoRefresh(bool autoRefresh);
+
+    QStringList dependentTables() const;
+    void setDependentTables(const QStringList& dependentTables);
+
+    int refreshDelay() const;
+    void setRefreshDelay(int refreshDelay);
+
+    QString tableName() const;
+    void setTableName(const QString& tableName);
+
+    EditStrategy editStrategy() const;
+    void setEditStrategy(const EditStrategy& editStrategy);
+
+    int pendingChanges() const;
+    Q_INVOKABLE int rowStatus(int row) const;
+    Q_INVOKABLE bool setValue(int row, const QString& column, const QVariant& value);
+    Q_INVOKABLE int appendRow(const QVariantMap& values);
+    Q_INVOKABLE bool deleteRow(int row);
+    Q_INVOKABLE bool submitAll();
+    Q_INVOKABLE void revertAll();
+    Q_INVOKABLE void revertRow(int row);
+
+    QString sortRole() const;
+    void setSortRole(const QString& sortRole);
+
+    Qt::SortOrder sortOrder() const;
+    void setSortOrder(const Qt::SortOrder& sortOrder);
+
+    QVariant filters() const;
+    void setFilters(const QVariant& filters);
+
+    bool cached() const;
+    void setCached(bool cached);
+
+    int cacheTtl() const;
+    void setCacheTtl(int cacheTtl);
+
+    int timeoutMs() const;
+    void setTimeoutMs(int timeoutMs);
+
+    Q_INVOKABLE void cancel();
+
+    QmlSqlPlan* plan() const;
+    Q_INVOKABLE bool explain();
+
      Q_INVOKABLE void clearModel();
+     void clear();
+     int rowCount(const QModelIndex& parent = QModelIndex()) const;
+     int columnCount(const QModelIndex& parent = QModelIndex()) const;
+     bool canFetchMore(const QModelIndex& parent = QModelIndex()) const;
+     void fetchMore(const QModelIndex& parent = QModelIndex());
+     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
      QVariant data(const QModelIndex& index, int role) const;
+     bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole);
+     Qt::ItemFlags flags(const QModelIndex& index) const;
+     void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
      QHash<int, QByteArray>roleNames() const;
      QString parseError(const QSqlError::ErrorType& mError);
 
@@ -55,15 +174,135 @@ signals:
     void error(const QString err);
     void errorStringChanged();
     void readOnlyChanged();
+    void asyncChanged();
+    void batchSizeChanged();
+    void fetchingChanged();
+    void fetchedRowsChanged();
+    void bindValuesChanged();
+    void storageChanged();
+    void keyColumnChanged();
+    void refreshModeChanged();
+    void autoRefreshChanged();
+    void dependentTablesChanged();
+    void refreshDelayChanged();
+    void tableNameChanged();
+    void editStrategyChanged();
+    void pendingChangesChanged();
+    void sortRoleChanged();
+    void sortOrderChanged();
+    void filtersChanged();
+    void cachedChanged();
+    void cacheTtlChanged();
+    void timeoutMsChanged();
+    void cancelled();
+    void timedOut();
+
+    //INTERNAL
+    void fetchRequested(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, int batchSize, int ticket);
+    void refreshRequested(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, const QmlSqlResultSet& current, const QString& keyColumn, int ticket);
 
 protected slots:
     void handleErrorString(const QString& errorString);
+    void handleColumnsReady(const QmlSqlResultSet& columns, int ticket);
+    void handleBatchReady(const QmlSqlResultSet& rows, int ticket);
+    void handleDiffReady(const QmlSqlResultSet& rows, const QmlSqlRowDiff& diff, int ticket);
+    void handleFetchFinished(const QString& errorString, int ticket);
+    void handleTablesChanged(const QString& connectionName, const QStringList& tables);
+    void handleTimeout();
+    void handleConnected();
+    void handleDisconnected();
 
 private:
+    void startWorker();
+    void setFetching(bool fetching);
+    void updateRoles(const QStringList& columns);
+    void execColumnar(QmlSqlStats::Sample& sample);
+    bool incremental() const;
+    void resetStatement();
+    void resetRows(const QmlSqlResultSet& rows);
+    void applyDiff(const QmlSqlResultSet& rows, const QmlSqlRowDiff& diff);
+    void updateSubscriptions();
+    bool isWritable() const;
+    int baseRowCount() const;
+    bool bufferValue(int row, int column, const QVariant& value);
+    void clearEdits();
+    bool deferRefresh();
+    void execDeferred();
+    void emitRowChanged(int row);
+    void requery();
+    QString effectiveQuery(QVariant* bindValues) const;
+    QString filterClause(const QSqlDriver* driver, QVariant* bindValues) const;
+    bool execCached();
+    void storeCached();
+    void startFetch();
+    bool abandonFetch();
+
     QmlSqlDatabase* m_database;
     QString m_queryString;
     QStringList m_roleList;
+    // built once per exec(), roleNames() and data() only read them
+    QHash<int, QByteArray> m_roleNames;
+    QVector<int> m_roleColumns;
     QString m_error;
     bool m_readOnly;
+    bool m_async;
+    int m_batchSize;
+    bool m_fetching;
+    QVariant m_bindValues;
+    Storage m_storage;
+    QString m_keyColumn;
+    RefreshMode m_refreshMode;
+    bool m_autoRefresh;
+    QStringList m_dependentTables;
+    QTimer m_refreshTimer;
+    // the tables auto refresh listens to and their connection
+    QString m_subscribedConnection;
+    QStringList m_subscribedTables;
+
+    // the edit buffer, changed values and deleted rows by row and column of m_rows, appended rows by column
+    QString m_tableName;
+    EditStrategy m_editStrategy;
+    QHash<int, QMap<int, QVariant> > m_changedValues;
+    QSet<int> m_deletedRows;
+    QVector<QMap<int, QVariant> > m_insertedRows;
+    int m_editRow;
+    int m_statusRole;
+    int m_dirtyRole;
+    // a refresh was asked for while edits were pending, it runs once they are submitted or reverted
+    bool m_refreshDeferred;
+
+    // sorting and filtering wrap queryString in a SELECT of their own
+    QString m_sortRole;
+    Qt::SortOrder m_sortOrder;
+    QVariantMap m_filters;
+
+    // the rows of the last exec() are stored in QmlSqlResultCache under m_cacheKey
+    bool m_cached;
+    int m_cacheTtl;
+    QString m_cacheKey;
+    QStringList m_cacheTables;
+
+    // an async exec() still fetching after m_timeoutMs is cancelled
+    int m_timeoutMs;
+    QTimer m_timeoutTimer;
+
+    QmlSqlPlan* m_plan;
+
+    // prepared statement of the last synchronous exec(), reused while queryString and the connection stay the same
+    QSqlQuery m_statement;
+    QString m_statementQuery;
+    QString m_statementConnection;
+
+    // rows fetched by the worker or read by a Columnar exec(), used instead of the QSqlQueryModel cache while m_ownsRows is set
+    bool m_ownsRows;
+    QmlSqlResultSet m_rows;
+    // while a diff is applied the rows are looked up through m_rowRefs, >= 0 is a row of m_pendingRows
+    // and < 0 is row -(ref + 1) of m_rows
+    bool m_diffing;
+    QVector<int> m_rowRefs;
+    QmlSqlResultSet m_pendingRows;
+    int m_ticket;
+    QThread* m_workerThread;
+    QmlSqlModelWorker* m_worker;
 };
 #endif // QSQLQUERYMODEL_H
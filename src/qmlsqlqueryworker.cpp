@@ -0,0 +1,589 @@
+#include "qmlsqlqueryworker.h"
+#include "qmlsqlstatementcache.h"
+#include "qmlsqlchangenotifier.h"
+#include "qmlsqlstats.h"
+#include <QJSValue>
+#include <QElapsedTimer>
+#include <QSqlDriver>
+#include <QVector>
+#include <QRegularExpression>
+
+// rough size of a value, used to enforce QmlSqlStreamOptions::maxBytes
+static int valueSize(const QVariant& value) {
+    switch (value.type()) {
+    case QVariant::String:
+        return 2 * value.toString().size();
+    case QVariant::ByteArray:
+        return value.toByteArray().size();
+    default:
+        return 8;
+    }
+}
+
+// rows handed to a single QSqlQuery::execBatch() call, execBatch() reports progress after each of them
+static const int batchChunkRows = 1000;
+
+// the end of every statement that ran successfully, whichever way it was run: it is recorded, the
+// models reading the tables it wrote to are told and its plan is checked
+static void statementSucceeded(const QSqlDatabase& db, const QString& query, const QVariant& bindValues, bool isSelect, const QmlSqlStats::Sample& sample) {
+    QmlSqlStats::instance()->record(sample);
+    if (!isSelect) {
+        QmlSqlChangeNotifier::instance()->publish(db.connectionName(), QmlSqlChangeNotifier::writtenTables(query));
+        if (QmlSqlChangeNotifier::isSchemaChange(query))
+            QmlSqlChangeNotifier::instance()->publishSchemaChange(db.connectionName());
+    }
+    QmlSqlStats::instance()->checkPlan(db, sample, bindValues);
+}
+
+static QString placeholderName(const QString& name) {
+    return name.startsWith(':') ? name : QLatin1Char(':') + name;
+}
+
+// chunks a streaming worker may have handed out that the receiver has not taken yet
+static const int chunksInFlight = 2;
+
+QmlSqlQueryWorker::QmlSqlQueryWorker(QObject *parent)
+    : QObject(parent), m_pooled(false), m_started(0), m_chunkCredits(chunksInFlight), m_aborted(0)
+{
+}
+
+// runs on the worker thread once it has finished, so the clones are removed by their own thread
+QmlSqlQueryWorker::~QmlSqlQueryWorker() {
+    if (m_pooled)
+        QmlSqlConnectionPool::instance()->removeThreadConnections();
+}
+
+void QmlSqlQueryWorker::chunkConsumed() {
+    if (m_chunkCredits.available() < chunksInFlight)
+        m_chunkCredits.release();
+}
+
+/*!
+ \brief void QmlSqlQueryWorker::abort()
+ Stops a stream that is waiting for its receiver, called before the worker thread is shut down.
+ */
+void QmlSqlQueryWorker::abort() {
+    m_aborted.store(1);
+    m_chunkCredits.release(chunksInFlight);
+}
+
+/*!
+ \brief void QmlSqlQueryWorker::cancel(int upTo)
+ Cancels the requests up to the \c upTo th one this worker was given, see QmlSqlCanceller. Must be
+ called from the thread that owns the connection the requests run against.
+ */
+void QmlSqlQueryWorker::cancel(int upTo) {
+    m_canceller.cancel(upTo);
+}
+
+bool QmlSqlQueryWorker::waitForChunkCredit() {
+    while (!m_chunkCredits.tryAcquire(1, 50)) {
+        if (m_aborted.load() || m_canceller.isCancelled())
+            return false;
+    }
+    return !m_aborted.load();
+}
+
+QString QmlSqlQueryWorker::cancelledError(const QString& query) {
+    return QString("query of %1 was cancelled").arg(query);
+}
+
+QSqlDatabase QmlSqlQueryWorker::acquire(const QmlSqlConnectionParams& params) {
+    m_pooled = true;
+    return QmlSqlConnectionPool::instance()->acquire(params);
+}
+
+/*!
+ \brief QVariant QmlSqlQueryWorker::normalizeBindValues(const QVariant& bindValues)
+ Turns the bind values that were set from QML into either a QVariantMap of named values or a
+ QVariantList of positional values, which unlike a QJSValue can be passed to another thread.
+ */
+QVariant QmlSqlQueryWorker::normalizeBindValues(const QVariant& bindValues) {
+    QVariant values = bindValues;
+    if (values.userType() == qMetaTypeId<QJSValue>())
+        values = values.value<QJSValue>().toVariant();
+
+    if (values.type() == QVariant::Map || values.type() == QVariant::List)
+        return values;
+    if (values.canConvert<QVariantList>() && values.type() != QVariant::String)
+        return values.toList();
+    return QVariant();
+}
+
+/*!
+ \brief void QmlSqlQueryWorker::bind(QSqlQuery& query, const QVariant& bindValues)
+ Binds the normalized \c bindValues to the placeholders of the prepared \c query. Map keys are
+ placeholder names with or without the leading colon, list entries are bound in order.
+ */
+void QmlSqlQueryWorker::bind(QSqlQuery& query, const QVariant& bindValues) {
+    if (bindValues.type() == QVariant::Map) {
+        const QVariantMap values = bindValues.toMap();
+        QVariantMap::const_iterator it = values.constBegin();
+        for (; it != values.constEnd(); ++it) {
+            query.bindValue(placeholderName(it.key()), it.value());
+        }
+    }
+    else if (bindValues.type() == QVariant::List) {
+        const QVariantList values = bindValues.toList();
+        for (int i = 0; i < values.count(); i++) {
+            query.bindValue(i, values.at(i));
+        }
+    }
+}
+
+/*!
+ \brief QVariant QmlSqlQueryWorker::batchColumns(const QVariant& rows, int* rowCount)
+ Converts the rows passed to QmlSqlQuery::execBatch() into one QVariantList per placeholder, the form
+ QSqlQuery::execBatch() expects. \c rows can be an array of arrays (positional placeholders), an array
+ of objects or an object of equally long arrays (named placeholders).
+
+ Returns a QVariantMap of named columns or a QVariantList of positional columns and sets \c rowCount,
+ or an invalid QVariant if \c rows has none of those shapes.
+ */
+QVariant QmlSqlQueryWorker::batchColumns(const QVariant& rows, int* rowCount) {
+    *rowCount = 0;
+    QVariant values = rows;
+    if (values.userType() == qMetaTypeId<QJSValue>())
+        values = values.value<QJSValue>().toVariant();
+
+    if (values.type() == QVariant::Map) {
+        const QVariantMap map = values.toMap();
+        QVariantMap columns;
+        int count = -1;
+        QVariantMap::const_iterator it = map.constBegin();
+        for (; it != map.constEnd(); ++it) {
+            const QVariantList column = it.value().toList();
+            if (count >= 0 && column.count() != count)
+                return QVariant();
+            count = column.count();
+            columns.insert(placeholderName(it.key()), column);
+        }
+        *rowCount = qMax(0, count);
+        return columns;
+    }
+
+    const QVariantList list = values.toList();
+    if (list.isEmpty())
+        return QVariant();
+
+    if (list.first().type() == QVariant::Map) {
+        const QStringList keys = list.first().toMap().keys();
+        QVector<QVariantList> columns(keys.count());
+        foreach (const QVariant& row, list) {
+            const QVariantMap map = row.toMap();
+            for (int c = 0; c < keys.count(); c++) {
+                columns[c] << map.value(keys.at(c));
+            }
+        }
+        QVariantMap named;
+        for (int c = 0; c < keys.count(); c++) {
+            named.insert(placeholderName(keys.at(c)), columns.at(c));
+        }
+        *rowCount = list.count();
+        return named;
+    }
+
+    const int columnCount = list.first().toList().count();
+    if (columnCount == 0)
+        return QVariant();
+    QVector<QVariantList> columns(columnCount);
+    for (int c = 0; c < columnCount; c++) {
+        columns[c].reserve(list.count());
+    }
+    foreach (const QVariant& row, list) {
+        const QVariantList cells = row.toList();
+        if (cells.count() != columnCount)
+            return QVariant();
+        for (int c = 0; c < columnCount; c++) {
+            columns[c] << cells.at(c);
+        }
+    }
+    QVariantList positional;
+    foreach (const QVariantList& column, columns) {
+        positional << QVariant(column);
+    }
+    *rowCount = list.count();
+    return positional;
+}
+
+/*!
+ \brief bool QmlSqlQueryWorker::isReplayable(const QString& query)
+ Returns true if \c query only reads, so running it a second time after its connection was lost has no
+ other effect than the first run would have had.
+ */
+bool QmlSqlQueryWorker::isReplayable(const QString& query) {
+    static const QRegularExpression reads("^\\s*(?:SELECT|WITH|VALUES|SHOW|EXPLAIN)\\b", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression locks("\\bFOR\\s+(?:UPDATE|SHARE)\\b", QRegularExpression::CaseInsensitiveOption);
+    return reads.match(query).hasMatch() && !locks.match(query).hasMatch()
+            && QmlSqlChangeNotifier::writtenTables(query).isEmpty();
+}
+
+/*!
+ \brief bool QmlSqlQueryWorker::recoverConnection(const QSqlDatabase& db, const QString& query, const QSqlError& error)
+ Called after \c query failed on \c db with \c error. If the connection was lost this is reported to the
+ QmlSqlDatabase that owns it, and a pooled clone is reopened when \c query can be replayed. Returns true
+ if \c query may be run again on \c db.
+ */
+bool QmlSqlQueryWorker::recoverConnection(const QSqlDatabase& db, const QString& query, const QSqlError& error) {
+    if (!QmlSqlConnectionPool::isConnectionError(error))
+        return false;
+    QmlSqlChangeNotifier::instance()->reportConnectionLost(db.connectionName());
+    return isReplayable(query) && QmlSqlConnectionPool::instance()->reopen(db);
+}
+
+/*!
+ \brief QmlSqlQueryResult QmlSqlQueryWorker::execute(const QSqlDatabase& db, const QString& query, const QVariant& bindValues, bool replay, const QmlSqlCanceller* canceller)
+ Prepares and runs \c query with \c bindValues on \c db and collects its output. This is shared by the synchronous
+ and the asynchronous code paths of QmlSqlQuery and must be called from the thread that owns \c db.
+ The prepared statement is taken from and kept in the QmlSqlStatementCache of \c db.
+
+ When \c replay is set, a read that fails because a pooled connection was lost runs once more on the
+ reopened connection. When \c canceller is cancelled reading the rows stops and the result is dropped.
+ */
+QmlSqlQueryResult QmlSqlQueryWorker::execute(const QSqlDatabase& db, const QString& query, const QVariant& bindValues, bool replay, const QmlSqlCanceller* canceller) {
+    QmlSqlQueryResult result;
+    QElapsedTimer timer;
+    timer.start();
+    QmlSqlStats::Sample sample(db.connectionName(), query);
+    QSqlQuery db_query = QmlSqlStatementCache::instance()->prepare(db, query);
+    bind(db_query, bindValues);
+    sample.prepared();
+
+    if (!db_query.exec())
+    {
+        const QSqlError error = db_query.lastError();
+        result.errorString = QString("could not run query of %1 Reason: %2").arg(query).arg(error.text());
+        sample.failed();
+        sample.executed();
+        QmlSqlStats::instance()->record(sample);
+        db_query.finish();
+        if (replay && recoverConnection(db, query, error))
+            return execute(db, query, bindValues, false, canceller);
+        return result;
+    }
+    sample.executed();
+
+    if (db_query.lastError().type() != QSqlError::NoError) {
+        result.errorString = db_query.lastError().text();
+        sample.failed();
+        QmlSqlStats::instance()->record(sample);
+        return result;
+    }
+
+    if (db_query.isSelect()) {
+        result.isSelect = true;
+        result.resultSet = QmlSqlResultSet(db_query.record());
+        while (db_query.next()) {
+            if (canceller != nullptr && canceller->isCancelled()) {
+                db_query.finish();
+                result.errorString = cancelledError(query);
+                sample.failed();
+                QmlSqlStats::instance()->record(sample);
+                return result;
+            }
+            result.resultSet.appendRow(db_query);
+        }
+        result.rowsAffected = result.resultSet.rowCount();
+        sample.fetched(result.rowsAffected, result.resultSet.byteSize());
+    }
+    else {
+        result.rowsAffected = db_query.numRowsAffected();
+        result.output = tr("(%n row(s) affected)", "", result.rowsAffected);
+    }
+    // the statement stays cached, let go of its result set so it does not hold locks
+    db_query.finish();
+    statementSucceeded(db, query, bindValues, result.isSelect, sample);
+    result.elapsed = timer.elapsed();
+    result.ok = true;
+    return result;
+}
+
+/*!
+ \brief void QmlSqlQueryWorker::run(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues)
+ Runs \c query on this thread's pooled connection for \c params and reports the outcome through finished().
+ */
+void QmlSqlQueryWorker::run(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues) {
+    const int sequence = ++m_started;
+    QmlSqlConnectionPool* pool = QmlSqlConnectionPool::instance();
+    QSqlDatabase db = acquire(params);
+    if (!db.isValid()) {
+        QmlSqlQueryResult result;
+        result.errorString = QString("could not get a connection for the connectionName of %1").arg(params.connectionName);
+        emit finished(result);
+        return;
+    }
+
+    QmlSqlQueryResult result;
+    if (!db.isOpen())
+        result.errorString = QString("could not open connection %1 Reason: %2").arg(params.connectionName).arg(db.lastError().text());
+    else if (!m_canceller.begin(db, sequence))
+        result.errorString = cancelledError(query);
+    else {
+        result = execute(db, query, bindValues, true, &m_canceller);
+        m_canceller.end();
+    }
+
+    pool->release(db);
+    emit finished(result);
+}
+
+/*!
+ \brief void QmlSqlQueryWorker::runBatch(const QmlSqlConnectionParams& params, const QString& query, const QVariant& columns, int rowCount)
+ Runs \c query once for each of the \c rowCount rows in \c columns on this thread's pooled connection
+ and reports the outcome through batchFinished().
+ */
+void QmlSqlQueryWorker::runBatch(const QmlSqlConnectionParams& params, const QString& query, const QVariant& columns, int rowCount) {
+    const int sequence = ++m_started;
+    QmlSqlConnectionPool* pool = QmlSqlConnectionPool::instance();
+    QSqlDatabase db = acquire(params);
+    if (!db.isValid()) {
+        QmlSqlQueryResult result;
+        result.errorString = QString("could not get a connection for the connectionName of %1").arg(params.connectionName);
+        emit batchFinished(result);
+        return;
+    }
+
+    QmlSqlQueryResult result;
+    if (!db.isOpen())
+        result.errorString = QString("could not open connection %1 Reason: %2").arg(params.connectionName).arg(db.lastError().text());
+    else if (!m_canceller.begin(db, sequence))
+        result.errorString = cancelledError(query);
+    else {
+        result = executeBatch(db, query, columns, rowCount);
+        m_canceller.end();
+    }
+
+    pool->release(db);
+    emit batchFinished(result);
+}
+
+/*!
+ \brief QmlSqlQueryResult QmlSqlQueryWorker::executeBatch(QSqlDatabase db, const QString& query, const QVariant& columns, int rowCount, bool ownTransaction)
+ Writes all rows through one prepared statement. With \c ownTransaction the rows go in through one
+ transaction that is committed only if every chunk succeeded, otherwise they join the transaction that
+ is already open on \c db.
+ */
+QmlSqlQueryResult QmlSqlQueryWorker::executeBatch(QSqlDatabase db, const QString& query, const QVariant& columns, int rowCount, bool ownTransaction) {
+    QmlSqlQueryResult result;
+    QElapsedTimer timer;
+    timer.start();
+
+    QStringList names;
+    QVector<QVariantList> data;
+    if (columns.type() == QVariant::Map) {
+        const QVariantMap map = columns.toMap();
+        QVariantMap::const_iterator it = map.constBegin();
+        for (; it != map.constEnd(); ++it) {
+            names << it.key();
+            data << it.value().toList();
+        }
+    }
+    else {
+        foreach (const QVariant& column, columns.toList()) {
+            data << column.toList();
+        }
+    }
+
+    QmlSqlStats::Sample sample(db.connectionName(), query);
+    QSqlQuery db_query(db);
+    if (!db_query.prepare(query)) {
+        result.errorString = QString("could not prepare query of %1 Reason: %2").arg(query).arg(db_query.lastError().text());
+        sample.failed();
+        sample.prepared();
+        QmlSqlStats::instance()->record(sample);
+        return result;
+    }
+    sample.prepared();
+
+    const bool transaction = ownTransaction && db.driver()->hasFeature(QSqlDriver::Transactions) && db.transaction();
+    for (int offset = 0; offset < rowCount; offset += batchChunkRows) {
+        if (m_canceller.isCancelled()) {
+            result.errorString = cancelledError(query);
+            if (transaction)
+                db.rollback();
+            sample.failed();
+            sample.executed();
+            QmlSqlStats::instance()->record(sample);
+            return result;
+        }
+        const int count = qMin(batchChunkRows, rowCount - offset);
+        for (int c = 0; c < data.count(); c++) {
+            const QVariantList chunk = data.at(c).mid(offset, count);
+            if (names.isEmpty())
+                db_query.bindValue(c, chunk);
+            else
+                db_query.bindValue(names.at(c), chunk);
+        }
+
+        if (!db_query.execBatch()) {
+            result.errorString = QString("could not run batch of %1 Reason: %2").arg(query).arg(db_query.lastError().text());
+            if (transaction)
+                db.rollback();
+            sample.failed();
+            sample.executed();
+            QmlSqlStats::instance()->record(sample);
+            return result;
+        }
+        result.rowsAffected += count;
+        emit batchProgress(result.rowsAffected, rowCount);
+    }
+
+    sample.executed();
+    if (transaction && !db.commit()) {
+        result.errorString = QString("could not commit batch of %1 Reason: %2").arg(query).arg(db.lastError().text());
+        result.rowsAffected = 0;
+        db.rollback();
+        sample.failed();
+        QmlSqlStats::instance()->record(sample);
+        return result;
+    }
+    // the values are bound per chunk, the plan is read without them
+    statementSucceeded(db, query, QVariant(), false, sample);
+    result.output = tr("(%n row(s) affected)", "", result.rowsAffected);
+    result.elapsed = timer.elapsed();
+    result.ok = true;
+    return result;
+}
+
+/*!
+ \brief void QmlSqlQueryWorker::stream(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, const QmlSqlStreamOptions& options)
+ Streams the rows of \c query on this thread's pooled connection through chunkReady() and reports the
+ outcome through finished().
+ */
+void QmlSqlQueryWorker::stream(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, const QmlSqlStreamOptions& options) {
+    const int sequence = ++m_started;
+    QmlSqlConnectionPool* pool = QmlSqlConnectionPool::instance();
+    QSqlDatabase db = acquire(params);
+    if (!db.isValid()) {
+        QmlSqlQueryResult result;
+        result.errorString = QString("could not get a connection for the connectionName of %1").arg(params.connectionName);
+        emit finished(result);
+        return;
+    }
+
+    QmlSqlQueryResult result;
+    if (!db.isOpen())
+        result.errorString = QString("could not open connection %1 Reason: %2").arg(params.connectionName).arg(db.lastError().text());
+    else if (!m_canceller.begin(db, sequence))
+        result.errorString = cancelledError(query);
+    else {
+        result = executeStreaming(db, query, bindValues, options);
+        m_canceller.end();
+    }
+
+    pool->release(db);
+    emit finished(result);
+}
+
+/*!
+ \brief QmlSqlQueryResult QmlSqlQueryWorker::executeStreaming(QSqlDatabase db, const QString& query, const QVariant& bindValues, const QmlSqlStreamOptions& options)
+ Runs \c query forward only and hands its rows out through chunkReady() every \c options.chunkSize rows
+ or \c options.chunkInterval milliseconds, whichever comes first. Only the current chunk is kept in
+ memory. Reading stops early once \c options.maxRows rows or about \c options.maxBytes bytes have been
+ read, the result is then marked as truncated.
+ */
+QmlSqlQueryResult QmlSqlQueryWorker::executeStreaming(QSqlDatabase db, const QString& query, const QVariant& bindValues, const QmlSqlStreamOptions& options) {
+    QmlSqlQueryResult result;
+    QElapsedTimer timer;
+    timer.start();
+
+    QmlSqlStats::Sample sample(db.connectionName(), query);
+    QSqlQuery db_query(db);
+    db_query.setForwardOnly(true);
+    db_query.prepare(query);
+    bind(db_query, bindValues);
+    sample.prepared();
+    if (!db_query.exec()) {
+        result.errorString = QString("could not run query of %1 Reason: %2").arg(query).arg(db_query.lastError().text());
+        sample.failed();
+        sample.executed();
+        QmlSqlStats::instance()->record(sample);
+        return result;
+    }
+    sample.executed();
+
+    if (!db_query.isSelect()) {
+        result.rowsAffected = db_query.numRowsAffected();
+        result.output = tr("(%n row(s) affected)", "", result.rowsAffected);
+        db_query.finish();
+        statementSucceeded(db, query, bindValues, false, sample);
+        result.elapsed = timer.elapsed();
+        result.ok = true;
+        return result;
+    }
+
+    result.isSelect = true;
+    const QSqlRecord rec = db_query.record();
+    const int chunkSize = qMax(1, options.chunkSize);
+    QmlSqlResultSet chunk(rec);
+    QElapsedTimer chunkTimer;
+    chunkTimer.start();
+    int offset = 0;
+    qint64 bytes = 0;
+    qint64 streamed = 0;
+
+    while (db_query.next()) {
+        if (m_canceller.isCancelled()) {
+            streamCancelled(&db_query, query, &sample, &result);
+            return result;
+        }
+        chunk.appendRow(db_query);
+        result.rowsAffected++;
+        if (options.maxBytes > 0) {
+            for (int i = 0; i < rec.count(); i++) {
+                bytes += valueSize(db_query.value(i));
+            }
+        }
+
+        const bool capped = (options.maxRows > 0 && result.rowsAffected >= options.maxRows)
+                || (options.maxBytes > 0 && bytes >= options.maxBytes);
+        const bool due = chunk.rowCount() >= chunkSize
+                || (options.chunkInterval > 0 && chunkTimer.elapsed() >= options.chunkInterval);
+        if (due || capped) {
+            if (options.throttled && !waitForChunkCredit()) {
+                streamCancelled(&db_query, query, &sample, &result);
+                return result;
+            }
+            streamed += chunk.byteSize();
+            emit chunkReady(chunk, offset);
+            offset += chunk.rowCount();
+            chunk = QmlSqlResultSet(rec);
+            chunkTimer.restart();
+        }
+        if (capped) {
+            result.truncated = db_query.next();
+            break;
+        }
+    }
+
+    if (chunk.rowCount() > 0) {
+        if (options.throttled && !waitForChunkCredit()) {
+            streamCancelled(&db_query, query, &sample, &result);
+            return result;
+        }
+        streamed += chunk.byteSize();
+        emit chunkReady(chunk, offset);
+    }
+
+    // the time spent waiting for the receiver to take its chunks counts as fetch time
+    sample.fetched(result.rowsAffected, streamed);
+    if (db_query.lastError().type() != QSqlError::NoError) {
+        result.errorString = db_query.lastError().text();
+        sample.failed();
+        QmlSqlStats::instance()->record(sample);
+        return result;
+    }
+    db_query.finish();
+    statementSucceeded(db, query, bindValues, true, sample);
+    result.elapsed = timer.elapsed();
+    result.ok = true;
+    return result;
+}
+
+// a stream that was cancelled or aborted, by the caller or while it waited for its receiver
+void QmlSqlQueryWorker::streamCancelled(QSqlQuery* db_query, const QString& query, QmlSqlStats::Sample* sample, QmlSqlQueryResult* result) {
+    db_query->finish();
+    result->errorString = cancelledError(query);
+    sample->failed();
+    QmlSqlStats::instance()->record(*sample);
+}
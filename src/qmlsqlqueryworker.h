@@ -0,0 +1,98 @@
+#ifndef QMLSQLQUERYWORKER_H
+#define QMLSQLQUERYWORKER_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QMetaType>
+#include <QString>
+#include <QVariant>
+#include <QSemaphore>
+#include <QAtomicInt>
+
+#include "qmlsqlconnectionpool.h"
+#include "qmlsqlresultset.h"
+#include "qmlsqlcanceller.h"
+#include "qmlsqlstats.h"
+
+struct QmlSqlQueryResult
+{
+    QmlSqlQueryResult() : ok(false), isSelect(false), truncated(false), rowsAffected(0), elapsed(0) {}
+
+    bool ok;
+    bool isSelect;
+    // a streamed SELECT stopped at maxRows or maxBytes
+    bool truncated;
+    QString errorString;
+    // the rows of a SELECT, for other statements the "(n row(s) affected)" text is in output
+    QmlSqlResultSet resultSet;
+    QString output;
+    int rowsAffected;
+    qint64 elapsed;
+};
+Q_DECLARE_METATYPE(QmlSqlQueryResult)
+
+struct QmlSqlStreamOptions
+{
+    QmlSqlStreamOptions() : chunkSize(500), chunkInterval(100), maxRows(0), maxBytes(0), throttled(true) {}
+
+    int chunkSize;
+    int chunkInterval;
+    int maxRows;
+    int maxBytes;
+    // wait for the receiver to take a chunk before reading far ahead, needed when it lives on another thread
+    bool throttled;
+};
+Q_DECLARE_METATYPE(QmlSqlStreamOptions)
+
+class QmlSqlQueryWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QmlSqlQueryWorker(QObject *parent = nullptr);
+    ~QmlSqlQueryWorker();
+
+    static QmlSqlQueryResult execute(const QSqlDatabase& db, const QString& query, const QVariant& bindValues = QVariant(), bool replay = true, const QmlSqlCanceller* canceller = nullptr);
+    static bool isReplayable(const QString& query);
+    static bool recoverConnection(const QSqlDatabase& db, const QString& query, const QSqlError& error);
+    static QVariant normalizeBindValues(const QVariant& bindValues);
+    static void bind(QSqlQuery& query, const QVariant& bindValues);
+    static QVariant batchColumns(const QVariant& rows, int* rowCount);
+
+    QmlSqlQueryResult executeBatch(QSqlDatabase db, const QString& query, const QVariant& columns, int rowCount, bool ownTransaction = true);
+    QmlSqlQueryResult executeStreaming(QSqlDatabase db, const QString& query, const QVariant& bindValues, const QmlSqlStreamOptions& options);
+
+    // thread safe
+    void chunkConsumed();
+    void abort();
+    void cancel(int upTo);
+
+signals:
+    void finished(const QmlSqlQueryResult& result);
+    void batchProgress(int rows, int total);
+    void batchFinished(const QmlSqlQueryResult& result);
+    void chunkReady(const QmlSqlResultSet& chunk, int offset);
+
+public slots:
+    void run(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues);
+    void runBatch(const QmlSqlConnectionParams& params, const QString& query, const QVariant& columns, int rowCount);
+    void stream(const QmlSqlConnectionParams& params, const QString& query, const QVariant& bindValues, const QmlSqlStreamOptions& options);
+
+private:
+    QSqlDatabase acquire(const QmlSqlConnectionParams& params);
+    bool waitForChunkCredit();
+    static QString cancelledError(const QString& query);
+    static void streamCancelled(QSqlQuery* db_query, const QString& query, QmlSqlStats::Sample* sample, QmlSqlQueryResult* result);
+
+    bool m_pooled;
+    // requests taken so far, the numbers cancel() refers to
+    int m_started;
+    QmlSqlCanceller m_canceller;
+    QSemaphore m_chunkCredits;
+    QAtomicInt m_aborted;
+};
+
+#endif // QMLSQLQUERYWORKER_H
@@ -0,0 +1,125 @@
+#include "qmlsqlresult.h"
+
+/*!
+   \qmltype QmlSqlResult
+   \inqmlmodule QmlSql 1.0
+   \ingroup QmlSql
+   \inherits QObject
+   \brief The rows returned by the last SELECT of a QmlSqlQuery, with their database types.
+
+   A QmlSqlResult is not created from QML, it is read through QmlSqlQuery::result. Columns can be
+   addressed by their index or their name and values keep their type, numbers stay numbers and
+   dates stay dates.
+
+\code
+    QmlSqlQuery{
+        id: query
+        database: db
+        queryString: "SELECT name, salary FROM employee"
+        onDone: {
+            for (var i = 0; i < result.rowCount; i++)
+                console.log(result.value(i, "name"), result.value(i, "salary") * 12)
+        }
+    }
+\endcode
+
+  \sa QmlSqlQuery
+*/
+
+QmlSqlResult::QmlSqlResult(QObject *parent)
+    : QObject(parent)
+{
+}
+
+/*!
+  \qmlproperty int QmlSqlResult::rowCount
+  Returns the number of rows.
+*/
+int QmlSqlResult::rowCount() const {
+    return m_resultSet.rowCount();
+}
+
+/*!
+  \qmlproperty int QmlSqlResult::columnCount
+  Returns the number of columns.
+*/
+int QmlSqlResult::columnCount() const {
+    return m_resultSet.columnCount();
+}
+
+/*!
+  \qmlproperty list QmlSqlResult::columns
+  Returns the names of the columns.
+*/
+QStringList QmlSqlResult::columns() const {
+    return m_resultSet.columnNames();
+}
+
+/*!
+  \qmlproperty list QmlSqlResult::columnTypes
+  Returns the name of the type the database reported for every column, for example \c int, \c double or \c QString.
+*/
+QStringList QmlSqlResult::columnTypes() const {
+    QStringList types;
+    for (int i = 0; i < m_resultSet.columnCount(); i++) {
+        types << QString::fromLatin1(QMetaType::typeName(m_resultSet.columnType(i)));
+    }
+    return types;
+}
+
+QmlSqlResultSet QmlSqlResult::resultSet() const {
+    return m_resultSet;
+}
+
+void QmlSqlResult::setResultSet(const QmlSqlResultSet& resultSet) {
+    m_resultSet = resultSet;
+    emit changed();
+}
+
+int QmlSqlResult::columnIndex(const QVariant& column) const {
+    if (column.type() == QVariant::String)
+        return m_resultSet.columnIndex(column.toString());
+    return column.toInt();
+}
+
+/*!
+  \qmlmethod variant QmlSqlResult::value(int row, variant column)
+  Returns the value of \c column in \c row, \c column is either the index or the name of the column.
+*/
+QVariant QmlSqlResult::value(int row, const QVariant& column) const {
+    return m_resultSet.value(row, columnIndex(column));
+}
+
+/*!
+  \qmlmethod object QmlSqlResult::row(int row)
+  Returns \c row as an object with one property per column.
+*/
+QVariantMap QmlSqlResult::row(int row) const {
+    QVariantMap map;
+    for (int i = 0; i < m_resultSet.columnCount(); i++) {
+        map.insert(m_resultSet.columnName(i), m_resultSet.value(row, i));
+    }
+    return map;
+}
+
+/*!
+  \qmlmethod list QmlSqlResult::column(variant column)
+  Returns all values of \c column, which is either the index or the name of the column.
+*/
+QVariantList QmlSqlResult::column(const QVariant& column) const {
+    return m_resultSet.column(columnIndex(column));
+}
+
+/*!
+  \qmlmethod list QmlSqlResult::rows()
+  Returns every row as an object with one property per column. Prefer value() or column() for large
+  results, this creates one object per row.
+*/
+QVariantList QmlSqlResult::rows() const {
+    QVariantList list;
+    list.reserve(m_resultSet.rowCount());
+    for (int i = 0; i < m_resultSet.rowCount(); i++) {
+        list << row(i);
+    }
+    return list;
+}
@@ -0,0 +1,44 @@
+#ifndef QMLSQLRESULT_H
+#define QMLSQLRESULT_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVariant>
+
+#include "qmlsqlresultset.h"
+
+class QmlSqlResult : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(int rowCount READ rowCount NOTIFY changed)
+    Q_PROPERTY(int columnCount READ columnCount NOTIFY changed)
+    Q_PROPERTY(QStringList columns READ columns NOTIFY changed)
+    Q_PROPERTY(QStringList columnTypes READ columnTypes NOTIFY changed)
+
+public:
+    explicit QmlSqlResult(QObject *parent = nullptr);
+
+    int rowCount() const;
+    int columnCount() const;
+    QStringList columns() const;
+    QStringList columnTypes() const;
+
+    QmlSqlResultSet resultSet() const;
+    void setResultSet(const QmlSqlResultSet& resultSet);
+
+    Q_INVOKABLE QVariant value(int row, const QVariant& column) const;
+    Q_INVOKABLE QVariantMap row(int row) const;
+    Q_INVOKABLE QVariantList column(const QVariant& column) const;
+    Q_INVOKABLE QVariantList rows() const;
+
+signals:
+    void changed();
+
+private:
+    int columnIndex(const QVariant& column) const;
+
+    QmlSqlResultSet m_resultSet;
+};
+
+#endif // QMLSQLRESULT_H
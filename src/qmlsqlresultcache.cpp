@@ -0,0 +1,266 @@
+#include "qmlsqlresultcache.h"
+#include "qmlsqlchangenotifier.h"
+#include <QQmlEngine>
+#include <QDataStream>
+#include <QByteArray>
+#include <QStringBuilder>
+#include <limits>
+
+static const int defaultMaxBytes = 32 * 1024 * 1024;
+
+/*!
+   \qmltype QmlSqlResultCache
+   \inqmlmodule QmlSql 1.0
+   \ingroup QmlSql
+   \inherits QObject
+   \brief The QmlSqlResultCache singleton holds the rows of the queries of cached QmlSqlQueryModels.
+
+A QmlSqlQueryModel with \c cached set looks its rows up here before it runs its query, so a page that is
+created again, or a second model with the same queryString, bindValues and connection, gets its rows
+without a round trip to the database. The models share the rows, they are not copied.
+
+An entry is dropped
+\list
+\li once the cacheTtl of the model that stored it has passed
+\li when a write through QmlSql, or a notification of the database, changes one of the tables its query reads
+\li when its connection is opened or closed
+\li when the least recently used entries have to make room for maxBytes
+\endlist
+
+Writes made by other processes are only seen through the notifications of drivers that have them, use
+cacheTtl for the other ones.
+
+\code
+    Text {
+        text: "cache: " + QmlSqlResultCache.count + " queries, " + Math.round(QmlSqlResultCache.hitRate * 100) + "% hits"
+    }
+\endcode
+
+ */
+QmlSqlResultCache::QmlSqlResultCache(QObject *parent) :
+    QObject(parent),
+    m_hits(0),
+    m_misses(0),
+    m_evictions(0),
+    m_invalidations(0)
+{
+    m_entries.setMaxCost(defaultMaxBytes);
+    m_clock.start();
+    // direct, so a write is invalidated before the writer can read again
+    connect(QmlSqlChangeNotifier::instance(), SIGNAL(tablesChanged(QString,QStringList)),
+            this, SLOT(handleTablesChanged(QString,QStringList)), Qt::DirectConnection);
+}
+
+QmlSqlResultCache* QmlSqlResultCache::instance() {
+    static QmlSqlResultCache cache;
+    return &cache;
+}
+
+QObject* QmlSqlResultCache::qmlInstance(QQmlEngine* engine, QJSEngine* scriptEngine) {
+    Q_UNUSED(engine)
+    Q_UNUSED(scriptEngine)
+    QQmlEngine::setObjectOwnership(instance(), QQmlEngine::CppOwnership);
+    return instance();
+}
+
+// pooled clones are named "<connectionName>@<thread>"
+QString QmlSqlResultCache::baseName(const QString& connectionName) {
+    const int at = connectionName.lastIndexOf('@');
+    return at < 0 ? connectionName : connectionName.left(at);
+}
+
+/*!
+ \brief QString QmlSqlResultCache::key(const QString& connectionName, const QString& query, const QVariant& bindValues)
+ The key the rows of \c query bound to \c bindValues on \c connectionName are cached under.
+ */
+QString QmlSqlResultCache::key(const QString& connectionName, const QString& query, const QVariant& bindValues) {
+    QByteArray values;
+    QDataStream stream(&values, QIODevice::WriteOnly);
+    stream << bindValues;
+    return baseName(connectionName) % QLatin1Char('\n') % QString::fromLatin1(values.toBase64()) % QLatin1Char('\n') % query;
+}
+
+/*!
+ \brief bool QmlSqlResultCache::find(const QString& key, QmlSqlResultSet* rows)
+ Sets \c rows to the rows cached under \c key and returns true, or returns false when there are none or
+ they have expired.
+ */
+bool QmlSqlResultCache::find(const QString& key, QmlSqlResultSet* rows) {
+    bool found = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        Entry* entry = m_entries.object(key);
+        if (entry != nullptr && entry->expires >= 0 && entry->expires <= m_clock.elapsed()) {
+            m_entries.remove(key);
+            entry = nullptr;
+        }
+        if (entry != nullptr) {
+            *rows = entry->rows;
+            found = true;
+            m_hits++;
+        }
+        else {
+            m_misses++;
+        }
+    }
+    emit statsChanged();
+    return found;
+}
+
+/*!
+ \brief void QmlSqlResultCache::insert(const QString& key, const QString& connectionName, const QStringList& tables, const QmlSqlResultSet& rows, int ttl)
+ Caches \c rows under \c key until one of \c tables of \c connectionName is written to or, when \c ttl
+ is greater than 0, for \c ttl milliseconds. Rows larger than maxBytes are not cached.
+ */
+void QmlSqlResultCache::insert(const QString& key, const QString& connectionName, const QStringList& tables, const QmlSqlResultSet& rows, int ttl) {
+    Entry* entry = new Entry;
+    entry->connectionName = baseName(connectionName);
+    entry->tables = tables.toSet();
+    entry->rows = rows;
+    entry->expires = ttl > 0 ? m_clock.elapsed() + ttl : -1;
+    const int cost = int(qBound<qint64>(1, rows.byteSize(), std::numeric_limits<int>::max()));
+    {
+        QMutexLocker locker(&m_mutex);
+        const int kept = m_entries.count() - (m_entries.contains(key) ? 1 : 0);
+        if (m_entries.insert(key, entry, cost))
+            m_evictions += kept + 1 - m_entries.count();
+    }
+    emit statsChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlResultCache::maxBytes
+  How much memory the cached rows may take before the least recently used ones are dropped. 0 turns the
+  cache off. The default is 32 MiB.
+*/
+int QmlSqlResultCache::maxBytes() const {
+    QMutexLocker locker(&m_mutex);
+    return m_entries.maxCost();
+}
+
+void QmlSqlResultCache::setMaxBytes(int maxBytes) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_entries.maxCost() == qMax(0, maxBytes))
+            return;
+        const int before = m_entries.count();
+        m_entries.setMaxCost(qMax(0, maxBytes));
+        m_evictions += before - m_entries.count();
+    }
+    emit maxBytesChanged();
+    emit statsChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlResultCache::count
+  How many queries have their rows cached.
+*/
+int QmlSqlResultCache::count() const {
+    QMutexLocker locker(&m_mutex);
+    return m_entries.count();
+}
+
+/*!
+ \qmlproperty int QmlSqlResultCache::bytes
+  Roughly how much memory the cached rows take.
+*/
+int QmlSqlResultCache::bytes() const {
+    QMutexLocker locker(&m_mutex);
+    return m_entries.totalCost();
+}
+
+/*!
+ \qmlproperty int QmlSqlResultCache::hits
+  How many times a model got its rows from the cache.
+*/
+int QmlSqlResultCache::hits() const {
+    QMutexLocker locker(&m_mutex);
+    return int(m_hits);
+}
+
+/*!
+ \qmlproperty int QmlSqlResultCache::misses
+  How many times a model had to run its query because its rows were not cached.
+*/
+int QmlSqlResultCache::misses() const {
+    QMutexLocker locker(&m_mutex);
+    return int(m_misses);
+}
+
+/*!
+ \qmlproperty real QmlSqlResultCache::hitRate
+  hits divided by the number of lookups, 0 before the first one.
+*/
+double QmlSqlResultCache::hitRate() const {
+    QMutexLocker locker(&m_mutex);
+    const qint64 lookups = m_hits + m_misses;
+    return lookups > 0 ? double(m_hits) / lookups : 0.0;
+}
+
+/*!
+ \qmlmethod object QmlSqlResultCache::stats()
+ Returns \c count, \c bytes, \c maxBytes, \c hits, \c misses, \c hitRate, \c evictions, the entries
+ dropped to make room, and \c invalidations, the entries dropped because their tables were written to.
+ */
+QVariantMap QmlSqlResultCache::stats() const {
+    QMutexLocker locker(&m_mutex);
+    const qint64 lookups = m_hits + m_misses;
+    QVariantMap map;
+    map.insert("count", m_entries.count());
+    map.insert("bytes", m_entries.totalCost());
+    map.insert("maxBytes", m_entries.maxCost());
+    map.insert("hits", m_hits);
+    map.insert("misses", m_misses);
+    map.insert("hitRate", lookups > 0 ? double(m_hits) / lookups : 0.0);
+    map.insert("evictions", m_evictions);
+    map.insert("invalidations", m_invalidations);
+    return map;
+}
+
+/*!
+ \qmlmethod void QmlSqlResultCache::invalidate(string connectionName, list tables)
+ Drops the cached rows of \c connectionName that were read from one of \c tables, or all of them when
+ \c tables is empty.
+ */
+void QmlSqlResultCache::invalidate(const QString& connectionName, const QStringList& tables) {
+    QSet<QString> names;
+    foreach (const QString& table, tables)
+        names.insert(table.toLower());
+    if (removeEntries(baseName(connectionName), names) > 0)
+        emit statsChanged();
+}
+
+/*!
+ \qmlmethod void QmlSqlResultCache::clear()
+ Drops all cached rows, the statistics are kept.
+ */
+void QmlSqlResultCache::clear() {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_entries.clear();
+    }
+    emit statsChanged();
+}
+
+void QmlSqlResultCache::handleTablesChanged(const QString& connectionName, const QStringList& tables) {
+    if (tables.isEmpty())
+        return;
+    invalidate(connectionName, tables);
+}
+
+int QmlSqlResultCache::removeEntries(const QString& connectionName, const QSet<QString>& tables) {
+    QMutexLocker locker(&m_mutex);
+    int removed = 0;
+    foreach (const QString& key, m_entries.keys()) {
+        const Entry* entry = m_entries.object(key);
+        if (entry->connectionName != connectionName)
+            continue;
+        if (!tables.isEmpty() && !entry->tables.intersects(tables))
+            continue;
+        m_entries.remove(key);
+        removed++;
+    }
+    if (!tables.isEmpty())
+        m_invalidations += removed;
+    return removed;
+}
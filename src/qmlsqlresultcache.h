@@ -0,0 +1,93 @@
+#ifndef QMLSQLRESULTCACHE_H
+#define QMLSQLRESULTCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVariantMap>
+
+#include "qmlsqlresultset.h"
+
+class QQmlEngine;
+class QJSEngine;
+
+/*!
+ * \brief The QmlSqlResultCache class
+ * Process wide LRU cache of the rows of SELECTs, keyed by connection, statement and bound values.
+ * Models that run the same query share one copy of its rows. Entries are dropped when their time to
+ * live has passed, when QmlSqlChangeNotifier reports a write to one of the tables they read and when
+ * their connection is opened or closed again.
+ *
+ * All members are thread safe.
+ */
+class QmlSqlResultCache : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int maxBytes READ maxBytes WRITE setMaxBytes NOTIFY maxBytesChanged)
+    Q_PROPERTY(int count READ count NOTIFY statsChanged)
+    Q_PROPERTY(int bytes READ bytes NOTIFY statsChanged)
+    Q_PROPERTY(int hits READ hits NOTIFY statsChanged)
+    Q_PROPERTY(int misses READ misses NOTIFY statsChanged)
+    Q_PROPERTY(double hitRate READ hitRate NOTIFY statsChanged)
+
+public:
+    static QmlSqlResultCache* instance();
+    static QObject* qmlInstance(QQmlEngine* engine, QJSEngine* scriptEngine);
+
+    static QString key(const QString& connectionName, const QString& query, const QVariant& bindValues);
+
+    bool find(const QString& key, QmlSqlResultSet* rows);
+    void insert(const QString& key, const QString& connectionName, const QStringList& tables, const QmlSqlResultSet& rows, int ttl);
+
+    int maxBytes() const;
+    void setMaxBytes(int maxBytes);
+
+    int count() const;
+    int bytes() const;
+    int hits() const;
+    int misses() const;
+    double hitRate() const;
+
+    Q_INVOKABLE QVariantMap stats() const;
+    Q_INVOKABLE void invalidate(const QString& connectionName, const QStringList& tables = QStringList());
+    Q_INVOKABLE void clear();
+
+signals:
+    void maxBytesChanged();
+    void statsChanged();
+
+private slots:
+    void handleTablesChanged(const QString& connectionName, const QStringList& tables);
+
+private:
+    struct Entry
+    {
+        Entry() : expires(-1) {}
+        QString connectionName;
+        QSet<QString> tables;
+        QmlSqlResultSet rows;
+        // m_clock time after which the entry is stale, -1 keeps it until it is invalidated
+        qint64 expires;
+    };
+
+    explicit QmlSqlResultCache(QObject *parent = nullptr);
+    Q_DISABLE_COPY(QmlSqlResultCache)
+
+    static QString baseName(const QString& connectionName);
+    int removeEntries(const QString& connectionName, const QSet<QString>& tables);
+
+    mutable QMutex m_mutex;
+    QCache<QString, Entry> m_entries;
+    QElapsedTimer m_clock;
+    qint64 m_hits;
+    qint64 m_misses;
+    qint64 m_evictions;
+    qint64 m_invalidations;
+};
+
+#endif // QMLSQLRESULTCACHE_H
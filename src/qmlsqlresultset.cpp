@@ -0,0 +1,336 @@
+#include "qmlsqlresultset.h"
+#include <QSqlField>
+#include <QStringBuilder>
+
+QmlSqlResultSet::QmlSqlResultSet()
+    : m_rowCount(0)
+{
+}
+
+QmlSqlResultSet::QmlSqlResultSet(const QSqlRecord& record)
+    : m_rowCount(0)
+{
+    const int columnCount = record.count();
+    m_columns.resize(columnCount);
+    for (int i = 0; i < columnCount; i++) {
+        m_names << record.fieldName(i);
+        m_columns[i].type = int(record.field(i).type());
+    }
+}
+
+int QmlSqlResultSet::rowCount() const {
+    return m_rowCount;
+}
+
+int QmlSqlResultSet::columnCount() const {
+    return m_names.count();
+}
+
+QStringList QmlSqlResultSet::columnNames() const {
+    return m_names;
+}
+
+QString QmlSqlResultSet::columnName(int column) const {
+    return m_names.value(column);
+}
+
+int QmlSqlResultSet::columnIndex(const QString& name) const {
+    return m_names.indexOf(name);
+}
+
+/*!
+ \brief int QmlSqlResultSet::columnType(int column) const
+ Returns the QVariant type id the driver reported for \c column, or QVariant::Invalid.
+ */
+int QmlSqlResultSet::columnType(int column) const {
+    if (column < 0 || column >= m_columns.count())
+        return int(QVariant::Invalid);
+    return m_columns.at(column).type;
+}
+
+QVariant QmlSqlResultSet::value(int row, int column) const {
+    if (column < 0 || column >= m_columns.count() || row < 0 || row >= m_rowCount)
+        return QVariant();
+    return cellValue(m_columns.at(column), row);
+}
+
+QVariantList QmlSqlResultSet::column(int column) const {
+    QVariantList values;
+    if (column < 0 || column >= m_columns.count())
+        return values;
+
+    const Column& col = m_columns.at(column);
+    values.reserve(m_rowCount);
+    for (int row = 0; row < m_rowCount; row++) {
+        values << cellValue(col, row);
+    }
+    return values;
+}
+
+/*!
+ \brief void QmlSqlResultSet::appendRow(const QSqlQuery& query)
+ Appends the row \c query is positioned on. The columns must match the record this set was created from.
+ */
+void QmlSqlResultSet::appendRow(const QSqlQuery& query) {
+    for (int i = 0; i < m_columns.count(); i++) {
+        appendValue(m_columns[i], m_rowCount, query.value(i));
+    }
+    m_rowCount++;
+}
+
+/*!
+ \brief void QmlSqlResultSet::append(const QmlSqlResultSet& other)
+ Appends the rows of \c other, which has to come from the same query. Columns that are kept the same
+ way in both sets are appended array by array, strings are interned again into this set.
+ */
+void QmlSqlResultSet::append(const QmlSqlResultSet& other) {
+    if (m_names.isEmpty() && m_rowCount == 0) {
+        *this = other;
+        return;
+    }
+    if (other.m_rowCount == 0 || other.m_columns.count() != m_columns.count())
+        return;
+
+    for (int i = 0; i < m_columns.count(); i++) {
+        appendColumn(m_columns[i], m_rowCount, other.m_columns.at(i), other.m_rowCount);
+    }
+    m_rowCount += other.m_rowCount;
+}
+
+void QmlSqlResultSet::clear() {
+    m_names.clear();
+    m_columns.clear();
+    m_rowCount = 0;
+}
+
+/*!
+ \brief QString QmlSqlResultSet::toText() const
+ Formats the rows the way QmlSqlQuery::lastQueryOutput has always shown them, one line per row with
+ every value followed by a tab.
+ */
+QString QmlSqlResultSet::toText() const {
+    QString output;
+    for (int row = 0; row < m_rowCount; row++) {
+        for (int i = 0; i < m_columns.count(); i++) {
+            output.append(cellValue(m_columns.at(i), row).toString() % '\t');
+        }
+        output.append('\n');
+    }
+    return output;
+}
+
+/*!
+ \brief qint64 QmlSqlResultSet::byteSize() const
+ Roughly how much memory the values take, without the overhead of the containers.
+ */
+qint64 QmlSqlResultSet::byteSize() const {
+    qint64 size = 0;
+    foreach (const Column& column, m_columns) {
+        size += column.ints.count() * sizeof(qint64);
+        size += column.doubles.count() * sizeof(double);
+        size += column.strings.count() * sizeof(int);
+        foreach (const QString& string, column.dictionary)
+            size += sizeof(QString) + string.size() * sizeof(QChar);
+        foreach (const QByteArray& blob, column.blobs)
+            size += sizeof(QByteArray) + blob.size();
+        foreach (const QVariant& variant, column.variants) {
+            size += sizeof(QVariant);
+            if (variant.type() == QVariant::String)
+                size += variant.toString().size() * sizeof(QChar);
+            else if (variant.type() == QVariant::ByteArray)
+                size += variant.toByteArray().size();
+        }
+        size += column.nulls.size() / 8;
+    }
+    return size;
+}
+
+QmlSqlResultSet::Storage QmlSqlResultSet::storageFor(int valueType) {
+    switch (valueType) {
+    case QMetaType::Bool:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        return IntStorage;
+    case QMetaType::Double:
+        return DoubleStorage;
+    case QMetaType::QString:
+        return StringStorage;
+    case QMetaType::QByteArray:
+        return BlobStorage;
+    default:
+        return VariantStorage;
+    }
+}
+
+bool QmlSqlResultSet::isNull(const Column& column, int row) {
+    return row < column.nulls.size() && column.nulls.testBit(row);
+}
+
+QVariant QmlSqlResultSet::cellValue(const Column& column, int row) {
+    if (column.storage == NoStorage || isNull(column, row))
+        return QVariant(QVariant::Type(column.type));
+
+    switch (column.storage) {
+    case IntStorage: {
+        const qint64 value = column.ints.at(row);
+        switch (column.valueType) {
+        case QMetaType::Bool:
+            return QVariant(value != 0);
+        case QMetaType::Int:
+            return QVariant(int(value));
+        case QMetaType::UInt:
+            return QVariant(uint(value));
+        case QMetaType::ULongLong:
+            return QVariant(qulonglong(value));
+        default:
+            return QVariant(qlonglong(value));
+        }
+    }
+    case DoubleStorage:
+        return QVariant(column.doubles.at(row));
+    case StringStorage:
+        return QVariant(column.dictionary.at(column.strings.at(row)));
+    case BlobStorage:
+        return QVariant(column.blobs.at(row));
+    default:
+        return column.variants.at(row);
+    }
+}
+
+// row is the index the value gets, all rows before it are already in the column
+void QmlSqlResultSet::appendValue(Column& column, int row, const QVariant& value) {
+    if (value.isNull()) {
+        if (column.nulls.size() <= row)
+            column.nulls.resize(row + 1);
+        column.nulls.setBit(row);
+        appendDefault(column, 1);
+        return;
+    }
+
+    if (column.storage == NoStorage) {
+        column.valueType = value.userType();
+        column.storage = storageFor(column.valueType);
+        appendDefault(column, row);
+    }
+    else if (column.storage != VariantStorage && value.userType() != column.valueType) {
+        widen(column, row);
+    }
+
+    switch (column.storage) {
+    case IntStorage:
+        column.ints.append(value.toLongLong());
+        break;
+    case DoubleStorage:
+        column.doubles.append(value.toDouble());
+        break;
+    case StringStorage:
+        column.strings.append(intern(column, value.toString()));
+        break;
+    case BlobStorage:
+        column.blobs.append(value.toByteArray());
+        break;
+    default:
+        column.variants.append(value);
+        break;
+    }
+}
+
+// placeholders for null rows, cellValue() never reads them
+void QmlSqlResultSet::appendDefault(Column& column, int count) {
+    if (count <= 0)
+        return;
+
+    switch (column.storage) {
+    case IntStorage:
+        column.ints.insert(column.ints.end(), count, 0);
+        break;
+    case DoubleStorage:
+        column.doubles.insert(column.doubles.end(), count, 0.0);
+        break;
+    case StringStorage:
+        column.strings.insert(column.strings.end(), count, intern(column, QString()));
+        break;
+    case BlobStorage:
+        column.blobs.insert(column.blobs.end(), count, QByteArray());
+        break;
+    case VariantStorage:
+        column.variants.insert(column.variants.end(), count, QVariant(QVariant::Type(column.type)));
+        break;
+    default:
+        break;
+    }
+}
+
+// a value of another type showed up, keep the column as QVariants from here on
+void QmlSqlResultSet::widen(Column& column, int rowCount) {
+    QVector<QVariant> variants;
+    variants.reserve(rowCount + 1);
+    for (int row = 0; row < rowCount; row++) {
+        variants.append(cellValue(column, row));
+    }
+
+    column.ints.clear();
+    column.doubles.clear();
+    column.strings.clear();
+    column.dictionary.clear();
+    column.dictionaryIndex.clear();
+    column.blobs.clear();
+    column.variants = variants;
+    column.storage = VariantStorage;
+}
+
+int QmlSqlResultSet::intern(Column& column, const QString& string) {
+    QHash<QString, int>::const_iterator it = column.dictionaryIndex.constFind(string);
+    if (it != column.dictionaryIndex.constEnd())
+        return it.value();
+
+    const int id = column.dictionary.count();
+    column.dictionary.append(string);
+    column.dictionaryIndex.insert(string, id);
+    return id;
+}
+
+void QmlSqlResultSet::appendColumn(Column& column, int rowCount, const Column& other, int otherRowCount) {
+    if (column.storage == NoStorage || column.storage != other.storage || column.valueType != other.valueType) {
+        for (int row = 0; row < otherRowCount; row++) {
+            appendValue(column, rowCount + row, cellValue(other, row));
+        }
+        return;
+    }
+
+    switch (column.storage) {
+    case IntStorage:
+        column.ints += other.ints;
+        break;
+    case DoubleStorage:
+        column.doubles += other.doubles;
+        break;
+    case StringStorage: {
+        QVector<int> ids(other.dictionary.count());
+        for (int i = 0; i < other.dictionary.count(); i++) {
+            ids[i] = intern(column, other.dictionary.at(i));
+        }
+        column.strings.reserve(rowCount + otherRowCount);
+        for (int i = 0; i < other.strings.count(); i++) {
+            column.strings.append(ids.at(other.strings.at(i)));
+        }
+        break;
+    }
+    case BlobStorage:
+        column.blobs += other.blobs;
+        break;
+    default:
+        column.variants += other.variants;
+        break;
+    }
+
+    if (other.nulls.count(true) > 0) {
+        column.nulls.resize(rowCount + otherRowCount);
+        for (int row = 0; row < other.nulls.size(); row++) {
+            if (other.nulls.testBit(row))
+                column.nulls.setBit(rowCount + row);
+        }
+    }
+}
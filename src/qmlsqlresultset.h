@@ -0,0 +1,88 @@
+#ifndef QMLSQLRESULTSET_H
+#define QMLSQLRESULTSET_H
+
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QHash>
+#include <QBitArray>
+#include <QByteArray>
+#include <QMetaType>
+
+/*!
+ * \brief The QmlSqlResultSet class
+ * Column oriented copy of the rows of a SELECT. Every column keeps its name, the QVariant type the
+ * driver reported for it and its values. Copies are cheap, the columns are implicitly shared.
+ *
+ * The values of a column are kept in a typed array picked from the first value that is not null:
+ * integers and doubles unboxed, strings interned per column and blobs as byte arrays. A column whose
+ * values do not all have the same type falls back to a list of QVariants.
+ */
+class QmlSqlResultSet
+{
+public:
+    QmlSqlResultSet();
+    explicit QmlSqlResultSet(const QSqlRecord& record);
+
+    int rowCount() const;
+    int columnCount() const;
+
+    QStringList columnNames() const;
+    QString columnName(int column) const;
+    int columnIndex(const QString& name) const;
+    int columnType(int column) const;
+
+    QVariant value(int row, int column) const;
+    QVariantList column(int column) const;
+
+    void appendRow(const QSqlQuery& query);
+    void append(const QmlSqlResultSet& other);
+    void clear();
+
+    QString toText() const;
+    qint64 byteSize() const;
+
+private:
+    enum Storage {
+        NoStorage,
+        IntStorage,
+        DoubleStorage,
+        StringStorage,
+        BlobStorage,
+        VariantStorage
+    };
+
+    struct Column
+    {
+        Column() : type(QVariant::Invalid), valueType(QMetaType::UnknownType), storage(NoStorage) {}
+        int type;
+        int valueType;
+        Storage storage;
+        QVector<qint64> ints;
+        QVector<double> doubles;
+        QVector<int> strings;
+        QVector<QString> dictionary;
+        QHash<QString, int> dictionaryIndex;
+        QVector<QByteArray> blobs;
+        QVector<QVariant> variants;
+        QBitArray nulls;
+    };
+
+    static Storage storageFor(int valueType);
+    static bool isNull(const Column& column, int row);
+    static QVariant cellValue(const Column& column, int row);
+    static void appendValue(Column& column, int row, const QVariant& value);
+    static void appendDefault(Column& column, int count);
+    static void widen(Column& column, int rowCount);
+    static int intern(Column& column, const QString& string);
+    static void appendColumn(Column& column, int rowCount, const Column& other, int otherRowCount);
+
+    QStringList m_names;
+    QVector<Column> m_columns;
+    int m_rowCount;
+};
+Q_DECLARE_METATYPE(QmlSqlResultSet)
+
+#endif // QMLSQLRESULTSET_H
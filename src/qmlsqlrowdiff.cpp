@@ -0,0 +1,166 @@
+#include "qmlsqlrowdiff.h"
+#include <QHash>
+
+QmlSqlRowDiff::QmlSqlRowDiff()
+    : m_valid(false)
+{
+}
+
+/*!
+ \brief QmlSqlRowDiff QmlSqlRowDiff::compute(const QmlSqlResultSet& from, const QmlSqlResultSet& to, int keyColumn)
+ Compares \c from and \c to by the values of \c keyColumn. Rows missing from \c to are removed first,
+ then the rows are put in the order of \c to. Rows that keep their relative order, the longest
+ increasing run of their new positions, stay where they are and only the others are moved.
+ */
+QmlSqlRowDiff QmlSqlRowDiff::compute(const QmlSqlResultSet& from, const QmlSqlResultSet& to, int keyColumn) {
+    QmlSqlRowDiff diff;
+    if (from.columnNames() != to.columnNames() || keyColumn < 0 || keyColumn >= to.columnCount())
+        return diff;
+
+    const int newCount = to.rowCount();
+    QHash<QString, int> newRows;
+    newRows.reserve(newCount);
+    for (int row = 0; row < newCount; row++) {
+        const QString key = to.value(row, keyColumn).toString();
+        if (newRows.contains(key))
+            return diff;
+        newRows.insert(key, row);
+    }
+
+    // the row of to that every row of from ends up as, -1 when it goes away
+    const int oldCount = from.rowCount();
+    QVector<int> targets(oldCount);
+    QVector<int> oldRows(newCount, -1);
+    for (int row = 0; row < oldCount; row++) {
+        const int target = newRows.value(from.value(row, keyColumn).toString(), -1);
+        if (target >= 0) {
+            if (oldRows.at(target) >= 0)
+                return diff;
+            oldRows[target] = row;
+        }
+        targets[row] = target;
+    }
+
+    // removes run from the bottom up so the rows above keep their index
+    QVector<int> current;
+    current.reserve(newCount);
+    for (int row = oldCount - 1; row >= 0; row--) {
+        if (targets.at(row) >= 0)
+            continue;
+        const int last = row;
+        while (row > 0 && targets.at(row - 1) < 0)
+            row--;
+        diff.addOperation(Remove, row, last);
+    }
+    for (int row = 0; row < oldCount; row++) {
+        if (targets.at(row) >= 0)
+            current.append(targets.at(row));
+    }
+
+    QVector<bool> stable(newCount, false);
+    const QVector<bool> increasing = longestIncreasing(current);
+    for (int i = 0; i < current.count(); i++) {
+        if (increasing.at(i))
+            stable[current.at(i)] = true;
+    }
+
+    // rows before i are in their final place
+    int i = 0;
+    while (i < newCount) {
+        if (i < current.count() && current.at(i) == i) {
+            i++;
+            continue;
+        }
+
+        if (oldRows.at(i) < 0) {
+            int last = i;
+            while (last + 1 < newCount && oldRows.at(last + 1) < 0)
+                last++;
+            diff.addOperation(Insert, i, last);
+            for (int row = i; row <= last; row++)
+                current.insert(row, row);
+            i = last + 1;
+            continue;
+        }
+
+        if (!stable.at(i)) {
+            const int from = current.indexOf(i, i);
+            diff.addOperation(Move, from, from, i);
+            current.remove(from);
+            current.insert(i, i);
+            i++;
+            continue;
+        }
+
+        // i stays, the row in its way still has to move further down, park it at the end
+        const int parked = current.at(i);
+        diff.addOperation(Move, i, i, current.count());
+        current.remove(i);
+        current.append(parked);
+    }
+
+    const int columnCount = to.columnCount();
+    for (int row = 0; row < newCount; row++) {
+        const int oldRow = oldRows.at(row);
+        if (oldRow < 0)
+            continue;
+        for (int column = 0; column < columnCount; column++) {
+            if (from.value(oldRow, column) != to.value(row, column)) {
+                diff.m_changedRows.append(row);
+                break;
+            }
+        }
+    }
+
+    diff.m_valid = true;
+    return diff;
+}
+
+bool QmlSqlRowDiff::isValid() const {
+    return m_valid;
+}
+
+QVector<QmlSqlRowDiff::Operation> QmlSqlRowDiff::operations() const {
+    return m_operations;
+}
+
+QVector<int> QmlSqlRowDiff::changedRows() const {
+    return m_changedRows;
+}
+
+// flags the members of one longest strictly increasing subsequence of values
+QVector<bool> QmlSqlRowDiff::longestIncreasing(const QVector<int>& values) {
+    QVector<int> tails;
+    QVector<int> previous(values.count(), -1);
+    for (int i = 0; i < values.count(); i++) {
+        int low = 0;
+        int high = tails.count();
+        while (low < high) {
+            const int middle = (low + high) / 2;
+            if (values.at(tails.at(middle)) < values.at(i))
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        if (low > 0)
+            previous[i] = tails.at(low - 1);
+        if (low == tails.count())
+            tails.append(i);
+        else
+            tails[low] = i;
+    }
+
+    QVector<bool> members(values.count(), false);
+    for (int i = tails.isEmpty() ? -1 : tails.last(); i >= 0; i = previous.at(i))
+        members[i] = true;
+    return members;
+}
+
+void QmlSqlRowDiff::addOperation(OperationType type, int first, int last, int destination) {
+    Operation operation;
+    operation.type = type;
+    operation.first = first;
+    operation.last = last;
+    operation.destination = destination;
+    m_operations.append(operation);
+}
@@ -0,0 +1,51 @@
+#ifndef QMLSQLROWDIFF_H
+#define QMLSQLROWDIFF_H
+
+#include <QVector>
+#include <QMetaType>
+
+#include "qmlsqlresultset.h"
+
+/*!
+ * \brief The QmlSqlRowDiff class
+ * The steps that turn the rows of one result into the rows of a newer result of the same query. Rows
+ * are matched by the value of a key column. The operations are meant to be applied in order, each
+ * index refers to the rows as they are after the operations before it. Rows that are in both results
+ * but whose values differ are listed by their index in the newer result.
+ *
+ * A diff is not valid when the columns differ or the key is missing or not unique, the model is then
+ * reset instead.
+ */
+class QmlSqlRowDiff
+{
+public:
+    enum OperationType{ Remove, Insert, Move };
+
+    struct Operation
+    {
+        OperationType type;
+        int first;
+        int last;
+        // for Move, the row the moved rows are put in front of, as for QAbstractItemModel::beginMoveRows()
+        int destination;
+    };
+
+    QmlSqlRowDiff();
+
+    static QmlSqlRowDiff compute(const QmlSqlResultSet& from, const QmlSqlResultSet& to, int keyColumn);
+
+    bool isValid() const;
+    QVector<Operation> operations() const;
+    QVector<int> changedRows() const;
+
+private:
+    static QVector<bool> longestIncreasing(const QVector<int>& values);
+    void addOperation(OperationType type, int first, int last, int destination = -1);
+
+    bool m_valid;
+    QVector<Operation> m_operations;
+    QVector<int> m_changedRows;
+};
+Q_DECLARE_METATYPE(QmlSqlRowDiff)
+
+#endif // QMLSQLROWDIFF_H
@@ -0,0 +1,367 @@
+#include "qmlsqlschemacache.h"
+#include "qmlsqlchangenotifier.h"
+#include <QQmlEngine>
+#include <QSqlDriver>
+#include <QSqlQuery>
+
+/*!
+   \qmltype QmlSqlSchemaCache
+   \inqmlmodule QmlSql 1.0
+   \ingroup QmlSql
+   \inherits QObject
+   \brief The QmlSqlSchemaCache singleton keeps the schema of every connection in memory.
+
+The tables, views, columns, primary keys and indexes of a connection are read from the catalog of the
+database once and answered from memory after that, QmlSqlDatabase::tables() and QmlSqlSchemaModel use
+them as well. A CREATE, ALTER, DROP or RENAME run through QmlSql drops the schema of its connection, so
+does opening or closing the connection. Call invalidate() after the schema was changed some other way.
+
+\code
+    ListView {
+        model: QmlSqlSchemaCache.columns("customdb-connection", "employee")
+        delegate: Text { text: modelData.name + " " + modelData.type + (modelData.primaryKey ? " (key)" : "") }
+    }
+\endcode
+
+ */
+QmlSqlSchemaCache::QmlSqlSchemaCache(QObject *parent) :
+    QObject(parent),
+    m_hits(0),
+    m_misses(0)
+{
+    // direct, so the schema is dropped before the statement that changed it returns
+    connect(QmlSqlChangeNotifier::instance(), SIGNAL(schemaChanged(QString)),
+            this, SLOT(handleSchemaChanged(QString)), Qt::DirectConnection);
+}
+
+QmlSqlSchemaCache* QmlSqlSchemaCache::instance() {
+    static QmlSqlSchemaCache cache;
+    return &cache;
+}
+
+QObject* QmlSqlSchemaCache::qmlInstance(QQmlEngine* engine, QJSEngine* scriptEngine) {
+    Q_UNUSED(engine)
+    Q_UNUSED(scriptEngine)
+    QQmlEngine::setObjectOwnership(instance(), QQmlEngine::CppOwnership);
+    return instance();
+}
+
+// pooled clones are named "<connectionName>@<thread>"
+QString QmlSqlSchemaCache::baseName(const QString& connectionName) {
+    const int at = connectionName.lastIndexOf('@');
+    return at < 0 ? connectionName : connectionName.left(at);
+}
+
+/*!
+ \brief QVariantMap QmlSqlSchemaCache::fieldInfo(const QSqlField& field, bool primaryKey)
+ Describes the column \c field as \c name, \c type, \c length, \c precision, \c nullable, \c defaultValue,
+ \c autoValue and \c primaryKey.
+ */
+QVariantMap QmlSqlSchemaCache::fieldInfo(const QSqlField& field, bool primaryKey) {
+    QVariantMap info;
+    info.insert("name", field.name());
+    info.insert("type", QString::fromLatin1(QVariant::typeToName(field.type())));
+    info.insert("length", field.length());
+    info.insert("precision", field.precision());
+    info.insert("nullable", field.requiredStatus() != QSqlField::Required);
+    info.insert("defaultValue", field.defaultValue());
+    info.insert("autoValue", field.isAutoValue());
+    info.insert("primaryKey", primaryKey);
+    return info;
+}
+
+QmlSqlSchemaCache::Schema& QmlSqlSchemaCache::schema(const QSqlDatabase& db) {
+    Schema& schema = m_schemas[baseName(db.connectionName())];
+    if (schema.loaded) {
+        m_hits++;
+        return schema;
+    }
+
+    m_misses++;
+    schema.tables = db.tables(QSql::Tables);
+    schema.views = db.tables(QSql::Views);
+    schema.systemTables = db.tables(QSql::SystemTables);
+    schema.loaded = true;
+    return schema;
+}
+
+QmlSqlSchemaCache::Table& QmlSqlSchemaCache::table(const QSqlDatabase& db, const QString& name) {
+    Table& table = m_schemas[baseName(db.connectionName())].details[name];
+    if (table.loaded) {
+        m_hits++;
+        return table;
+    }
+
+    m_misses++;
+    table.record = db.record(name);
+    table.primaryIndex = db.primaryIndex(name);
+    table.loaded = true;
+    return table;
+}
+
+/*!
+ \brief QStringList QmlSqlSchemaCache::tables(const QSqlDatabase& db, QSql::TableType type)
+ Returns the tables of \c db of \c type, like QSqlDatabase::tables(). A closed \c db has none.
+ */
+QStringList QmlSqlSchemaCache::tables(const QSqlDatabase& db, QSql::TableType type) {
+    QStringList names;
+    if (!db.isOpen())
+        return names;
+    {
+        QMutexLocker locker(&m_mutex);
+        const Schema& s = schema(db);
+        if (type == QSql::Tables || type == QSql::AllTables)
+            names << s.tables;
+        if (type == QSql::SystemTables || type == QSql::AllTables)
+            names << s.systemTables;
+        if (type == QSql::Views || type == QSql::AllTables)
+            names << s.views;
+    }
+    emit statsChanged();
+    return names;
+}
+
+/*!
+ \brief QSqlRecord QmlSqlSchemaCache::record(const QSqlDatabase& db, const QString& table)
+ Returns the columns of \c table, like QSqlDatabase::record().
+ */
+QSqlRecord QmlSqlSchemaCache::record(const QSqlDatabase& db, const QString& table) {
+    QSqlRecord record;
+    if (!db.isOpen())
+        return record;
+    {
+        QMutexLocker locker(&m_mutex);
+        record = this->table(db, table).record;
+    }
+    emit statsChanged();
+    return record;
+}
+
+/*!
+ \brief QSqlIndex QmlSqlSchemaCache::primaryIndex(const QSqlDatabase& db, const QString& table)
+ Returns the primary key of \c table, like QSqlDatabase::primaryIndex().
+ */
+QSqlIndex QmlSqlSchemaCache::primaryIndex(const QSqlDatabase& db, const QString& table) {
+    QSqlIndex index;
+    if (!db.isOpen())
+        return index;
+    {
+        QMutexLocker locker(&m_mutex);
+        index = this->table(db, table).primaryIndex;
+    }
+    emit statsChanged();
+    return index;
+}
+
+/*!
+ \brief QVariantList QmlSqlSchemaCache::indexList(const QSqlDatabase& db, const QString& table)
+ Returns the indexes of \c table, see indexes().
+ */
+QVariantList QmlSqlSchemaCache::indexList(const QSqlDatabase& db, const QString& table) {
+    QVariantList indexes;
+    if (!db.isOpen())
+        return indexes;
+    {
+        QMutexLocker locker(&m_mutex);
+        Table& t = this->table(db, table);
+        if (!t.indexesLoaded) {
+            t.indexes = readIndexes(db, table, t.primaryIndex);
+            t.indexesLoaded = true;
+        }
+        indexes = t.indexes;
+    }
+    emit statsChanged();
+    return indexes;
+}
+
+// Qt has no driver independent way to list indexes, the catalogs of SQLite, PostgreSQL and MySQL are
+// asked directly, the other drivers only report their primary key
+QVariantList QmlSqlSchemaCache::readIndexes(const QSqlDatabase& db, const QString& table, const QSqlIndex& primaryIndex) {
+    QStringList names;
+    QHash<QString, QVariantMap> found;
+    const QString driver = db.driverName();
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+
+    if (driver == "QSQLITE") {
+        QList<QVariantMap> list;
+        if (query.exec(QString("PRAGMA index_list(%1)").arg(db.driver()->escapeIdentifier(table, QSqlDriver::TableName)))) {
+            while (query.next()) {
+                QVariantMap index;
+                index.insert("name", query.value("name"));
+                index.insert("unique", query.value("unique").toBool());
+                index.insert("primary", query.value("origin").toString() == "pk");
+                list << index;
+            }
+        }
+        foreach (QVariantMap index, list) {
+            QStringList columns;
+            QSqlQuery info(db);
+            if (info.exec(QString("PRAGMA index_info(%1)").arg(db.driver()->escapeIdentifier(index.value("name").toString(), QSqlDriver::TableName)))) {
+                while (info.next())
+                    columns << info.value("name").toString();
+            }
+            index.insert("columns", columns);
+            names << index.value("name").toString();
+            found.insert(names.last(), index);
+        }
+    }
+    else if (driver == "QPSQL") {
+        query.prepare("SELECT i.relname, ix.indisunique, ix.indisprimary, a.attname"
+                      " FROM pg_index ix"
+                      " JOIN pg_class t ON t.oid = ix.indrelid"
+                      " JOIN pg_class i ON i.oid = ix.indexrelid"
+                      " JOIN pg_attribute a ON a.attrelid = t.oid AND a.attnum = ANY(ix.indkey)"
+                      " WHERE t.relname = ?"
+                      " ORDER BY i.relname, array_position(ix.indkey::int2[], a.attnum)");
+        query.addBindValue(table);
+        if (query.exec()) {
+            while (query.next()) {
+                const QString name = query.value(0).toString();
+                if (!found.contains(name)) {
+                    names << name;
+                    found[name].insert("name", name);
+                    found[name].insert("unique", query.value(1).toBool());
+                    found[name].insert("primary", query.value(2).toBool());
+                }
+                found[name]["columns"] = found[name].value("columns").toStringList() << query.value(3).toString();
+            }
+        }
+    }
+    else if (driver == "QMYSQL") {
+        if (query.exec(QString("SHOW INDEX FROM %1").arg(db.driver()->escapeIdentifier(table, QSqlDriver::TableName)))) {
+            while (query.next()) {
+                const QString name = query.value("Key_name").toString();
+                if (!found.contains(name)) {
+                    names << name;
+                    found[name].insert("name", name);
+                    found[name].insert("unique", query.value("Non_unique").toInt() == 0);
+                    found[name].insert("primary", name == "PRIMARY");
+                }
+                found[name]["columns"] = found[name].value("columns").toStringList() << query.value("Column_name").toString();
+            }
+        }
+    }
+    else if (!primaryIndex.isEmpty()) {
+        QStringList columns;
+        for (int i = 0; i < primaryIndex.count(); i++)
+            columns << primaryIndex.fieldName(i);
+        QVariantMap index;
+        index.insert("name", primaryIndex.name());
+        index.insert("unique", true);
+        index.insert("primary", true);
+        index.insert("columns", columns);
+        names << primaryIndex.name();
+        found.insert(primaryIndex.name(), index);
+    }
+
+    QVariantList indexes;
+    foreach (const QString& name, names)
+        indexes << found.value(name);
+    return indexes;
+}
+
+/*!
+ \qmlproperty int QmlSqlSchemaCache::hits
+ How many lookups were answered from memory.
+*/
+int QmlSqlSchemaCache::hits() const {
+    QMutexLocker locker(&m_mutex);
+    return int(m_hits);
+}
+
+/*!
+ \qmlproperty int QmlSqlSchemaCache::misses
+ How many lookups had to read the catalog of the database.
+*/
+int QmlSqlSchemaCache::misses() const {
+    QMutexLocker locker(&m_mutex);
+    return int(m_misses);
+}
+
+/*!
+ \qmlmethod list<string> QmlSqlSchemaCache::tableNames(string connectionName)
+ Returns the tables of \c connectionName, without views and system tables.
+ */
+QStringList QmlSqlSchemaCache::tableNames(const QString& connectionName) {
+    return tables(QSqlDatabase::database(connectionName, false), QSql::Tables);
+}
+
+/*!
+ \qmlmethod list<string> QmlSqlSchemaCache::viewNames(string connectionName)
+ Returns the views of \c connectionName.
+ */
+QStringList QmlSqlSchemaCache::viewNames(const QString& connectionName) {
+    return tables(QSqlDatabase::database(connectionName, false), QSql::Views);
+}
+
+/*!
+ \qmlmethod list<object> QmlSqlSchemaCache::columns(string connectionName, string table)
+ Returns the columns of \c table in order, each with its \c name, \c type, \c length, \c precision,
+ \c nullable, \c defaultValue, \c autoValue and whether it is part of the \c primaryKey. What the driver
+ does not know is -1 or undefined.
+ */
+QVariantList QmlSqlSchemaCache::columns(const QString& connectionName, const QString& table) {
+    const QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+    const QSqlRecord fields = record(db, table);
+    const QSqlIndex key = primaryIndex(db, table);
+
+    QVariantList columns;
+    for (int i = 0; i < fields.count(); i++)
+        columns << fieldInfo(fields.field(i), key.contains(fields.fieldName(i)));
+    return columns;
+}
+
+/*!
+ \qmlmethod list<string> QmlSqlSchemaCache::primaryKey(string connectionName, string table)
+ Returns the columns of the primary key of \c table, empty if it has none.
+ */
+QStringList QmlSqlSchemaCache::primaryKey(const QString& connectionName, const QString& table) {
+    const QSqlIndex key = primaryIndex(QSqlDatabase::database(connectionName, false), table);
+    QStringList columns;
+    for (int i = 0; i < key.count(); i++)
+        columns << key.fieldName(i);
+    return columns;
+}
+
+/*!
+ \qmlmethod list<object> QmlSqlSchemaCache::indexes(string connectionName, string table)
+ Returns the indexes of \c table, each with its \c name, its \c columns and whether it is \c unique and
+ the \c primary key. SQLite, PostgreSQL and MySQL report all indexes, other drivers only the primary key.
+ */
+QVariantList QmlSqlSchemaCache::indexes(const QString& connectionName, const QString& table) {
+    return indexList(QSqlDatabase::database(connectionName, false), table);
+}
+
+/*!
+ \qmlmethod void QmlSqlSchemaCache::invalidate(string connectionName)
+ Drops the schema of \c connectionName, it is read again the next time it is needed.
+ */
+void QmlSqlSchemaCache::invalidate(const QString& connectionName) {
+    const QString name = baseName(connectionName);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_schemas.remove(name) == 0)
+            return;
+    }
+    emit schemaChanged(name);
+}
+
+/*!
+ \qmlmethod void QmlSqlSchemaCache::clear()
+ Drops the schema of every connection.
+ */
+void QmlSqlSchemaCache::clear() {
+    QStringList names;
+    {
+        QMutexLocker locker(&m_mutex);
+        names = m_schemas.keys();
+        m_schemas.clear();
+    }
+    foreach (const QString& name, names)
+        emit schemaChanged(name);
+}
+
+void QmlSqlSchemaCache::handleSchemaChanged(const QString& connectionName) {
+    invalidate(connectionName);
+}
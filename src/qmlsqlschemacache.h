@@ -0,0 +1,102 @@
+#ifndef QMLSQLSCHEMACACHE_H
+#define QMLSQLSCHEMACACHE_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlRecord>
+#include <QSqlIndex>
+#include <QSqlField>
+#include <QMutex>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVariantList>
+#include <QVariantMap>
+
+class QQmlEngine;
+class QJSEngine;
+
+/*!
+ * \brief The QmlSqlSchemaCache class
+ * Process wide cache of the schema of every connection: its tables, views and system tables, and the
+ * columns, primary key and indexes of each table. Each part is read from the catalog the first time it
+ * is asked for and kept until a statement run through QmlSql changes the schema, which
+ * QmlSqlChangeNotifier reports, or until the connection is opened or closed again.
+ *
+ * All members are thread safe. The members that take a QSqlDatabase must be called from the thread that
+ * owns it, the ones that take a connectionName from the thread that opened that connection.
+ */
+class QmlSqlSchemaCache : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int hits READ hits NOTIFY statsChanged)
+    Q_PROPERTY(int misses READ misses NOTIFY statsChanged)
+
+public:
+    static QmlSqlSchemaCache* instance();
+    static QObject* qmlInstance(QQmlEngine* engine, QJSEngine* scriptEngine);
+
+    static QVariantMap fieldInfo(const QSqlField& field, bool primaryKey);
+
+    QStringList tables(const QSqlDatabase& db, QSql::TableType type);
+    QSqlRecord record(const QSqlDatabase& db, const QString& table);
+    QSqlIndex primaryIndex(const QSqlDatabase& db, const QString& table);
+    QVariantList indexList(const QSqlDatabase& db, const QString& table);
+
+    int hits() const;
+    int misses() const;
+
+    Q_INVOKABLE QStringList tableNames(const QString& connectionName);
+    Q_INVOKABLE QStringList viewNames(const QString& connectionName);
+    Q_INVOKABLE QVariantList columns(const QString& connectionName, const QString& table);
+    Q_INVOKABLE QStringList primaryKey(const QString& connectionName, const QString& table);
+    Q_INVOKABLE QVariantList indexes(const QString& connectionName, const QString& table);
+    Q_INVOKABLE void invalidate(const QString& connectionName);
+    Q_INVOKABLE void clear();
+
+signals:
+    void schemaChanged(const QString& connectionName);
+    void statsChanged();
+
+private slots:
+    void handleSchemaChanged(const QString& connectionName);
+
+private:
+    struct Table
+    {
+        Table() : loaded(false), indexesLoaded(false) {}
+        QSqlRecord record;
+        QSqlIndex primaryIndex;
+        bool loaded;
+        QVariantList indexes;
+        bool indexesLoaded;
+    };
+
+    struct Schema
+    {
+        Schema() : loaded(false) {}
+        bool loaded;
+        QStringList tables;
+        QStringList views;
+        QStringList systemTables;
+        QHash<QString, Table> details;
+    };
+
+    explicit QmlSqlSchemaCache(QObject *parent = nullptr);
+    Q_DISABLE_COPY(QmlSqlSchemaCache)
+
+    static QString baseName(const QString& connectionName);
+    static QVariantList readIndexes(const QSqlDatabase& db, const QString& table, const QSqlIndex& primaryIndex);
+
+    // the caller holds m_mutex
+    Schema& schema(const QSqlDatabase& db);
+    Table& table(const QSqlDatabase& db, const QString& name);
+
+    mutable QMutex m_mutex;
+    QHash<QString, Schema> m_schemas;
+    qint64 m_hits;
+    qint64 m_misses;
+};
+
+#endif // QMLSQLSCHEMACACHE_H
@@ -0,0 +1,246 @@
+#include "qmlsqlschemamodel.h"
+#include "qmlsqldatabase.h"
+#include "qmlsqlschemacache.h"
+#include <QSqlDatabase>
+#include <QSqlRecord>
+#include <QSqlIndex>
+
+/*!
+   \qmltype QmlSqlSchemaModel
+   \inqmlmodule QmlSql 1.0
+   \ingroup QmlSql
+   \inherits QAbstractItemModel
+   \brief The QmlSqlSchemaModel object shows the schema of a database as a tree.
+
+The top level rows are the tables of database, followed by its views when showViews is set and its
+system tables when showSystemTables is set. The children of a table are its columns followed by its
+indexes, they are read the first time the table is expanded. Everything comes from QmlSqlSchemaCache, so
+expanding a table again, or a second model on the same connection, does not ask the database.
+
+The model is reset when database connects and whenever its schema changes.
+
+Each row has the roles
+\list
+\li \c name, also \c display, the name of the table, view, column or index
+\li \c kind, one of \c "table", \c "view", \c "systemTable", \c "column" or \c "index"
+\li \c details, for a column the map QmlSqlSchemaCache::columns() describes it with, for an index the
+    map of QmlSqlSchemaCache::indexes(), empty for the others
+\endlist
+
+\code
+    TreeView {
+        model: QmlSqlSchemaModel { database: db }
+        TableViewColumn { role: "name"; title: "Name" }
+        TableViewColumn { role: "kind"; title: "Kind" }
+    }
+\endcode
+ */
+QmlSqlSchemaModel::QmlSqlSchemaModel(QObject *parent)
+    : QAbstractItemModel(parent),
+      m_database(nullptr),
+      m_showViews(true),
+      m_showSystemTables(false)
+{
+    m_nodes.append(Node());
+    connect(QmlSqlSchemaCache::instance(), SIGNAL(schemaChanged(QString)), this, SLOT(handleSchemaChanged(QString)));
+}
+
+QmlSqlDatabase* QmlSqlSchemaModel::database() const {
+    return m_database;
+}
+
+void QmlSqlSchemaModel::setDatabase(QmlSqlDatabase* database) {
+    if (database == m_database)
+        return;
+
+    if (m_database != nullptr) {
+        disconnect(m_database, SIGNAL(connected()), this, SLOT(reload()));
+        disconnect(m_database, SIGNAL(disconnected()), this, SLOT(reload()));
+    }
+
+    m_database = database;
+    connect(m_database, SIGNAL(connected()), this, SLOT(reload()));
+    connect(m_database, SIGNAL(disconnected()), this, SLOT(reload()));
+
+    reload();
+    emit databaseChanged();
+}
+
+/*!
+  \qmlproperty bool QmlSqlSchemaModel::showViews
+  Whether the views are listed after the tables. The default is \c true.
+*/
+bool QmlSqlSchemaModel::showViews() const {
+    return m_showViews;
+}
+
+void QmlSqlSchemaModel::setShowViews(bool showViews) {
+    if (m_showViews == showViews)
+        return;
+    m_showViews = showViews;
+    reload();
+    emit showViewsChanged();
+}
+
+/*!
+  \qmlproperty bool QmlSqlSchemaModel::showSystemTables
+  Whether the system tables of the database are listed last. The default is \c false.
+*/
+bool QmlSqlSchemaModel::showSystemTables() const {
+    return m_showSystemTables;
+}
+
+void QmlSqlSchemaModel::setShowSystemTables(bool showSystemTables) {
+    if (m_showSystemTables == showSystemTables)
+        return;
+    m_showSystemTables = showSystemTables;
+    reload();
+    emit showSystemTablesChanged();
+}
+
+/*!
+  \qmlproperty int QmlSqlSchemaModel::count
+  The number of top level rows.
+*/
+int QmlSqlSchemaModel::count() const {
+    return m_nodes.at(0).children.count();
+}
+
+/*!
+ \qmlmethod void QmlSqlSchemaModel::reload()
+ Reads the list of tables again. Nothing is read from the database unless the schema has changed.
+ */
+void QmlSqlSchemaModel::reload() {
+    const int oldCount = count();
+    beginResetModel();
+    m_nodes.clear();
+    m_nodes.append(Node());
+
+    if (m_database != nullptr && m_database->isConnected()) {
+        const QSqlDatabase db = QSqlDatabase::database(m_database->connectionName(), false);
+        QmlSqlSchemaCache* cache = QmlSqlSchemaCache::instance();
+        foreach (const QString& table, cache->tables(db, QSql::Tables))
+            addNode(0, "table", table, QVariantMap(), false);
+        if (m_showViews) {
+            foreach (const QString& view, cache->tables(db, QSql::Views))
+                addNode(0, "view", view, QVariantMap(), false);
+        }
+        if (m_showSystemTables) {
+            foreach (const QString& table, cache->tables(db, QSql::SystemTables))
+                addNode(0, "systemTable", table, QVariantMap(), false);
+        }
+    }
+    endResetModel();
+
+    if (count() != oldCount)
+        emit countChanged();
+}
+
+void QmlSqlSchemaModel::handleSchemaChanged(const QString& connectionName) {
+    if (m_database != nullptr && m_database->connectionName() == connectionName)
+        reload();
+}
+
+int QmlSqlSchemaModel::nodeOf(const QModelIndex& index) const {
+    return index.isValid() ? int(index.internalId()) : 0;
+}
+
+int QmlSqlSchemaModel::addNode(int parent, const QString& kind, const QString& name, const QVariantMap& details, bool fetched) {
+    Node node;
+    node.parent = parent;
+    node.row = m_nodes.at(parent).children.count();
+    node.kind = kind;
+    node.name = name;
+    node.details = details;
+    node.fetched = fetched;
+    m_nodes.append(node);
+    const int id = m_nodes.count() - 1;
+    m_nodes[parent].children.append(id);
+    return id;
+}
+
+QModelIndex QmlSqlSchemaModel::index(int row, int column, const QModelIndex& parent) const {
+    const Node& node = m_nodes.at(nodeOf(parent));
+    if (row < 0 || row >= node.children.count() || column != 0)
+        return QModelIndex();
+    return createIndex(row, column, quintptr(node.children.at(row)));
+}
+
+QModelIndex QmlSqlSchemaModel::parent(const QModelIndex& child) const {
+    if (!child.isValid())
+        return QModelIndex();
+    const int parent = m_nodes.at(nodeOf(child)).parent;
+    if (parent <= 0)
+        return QModelIndex();
+    return createIndex(m_nodes.at(parent).row, 0, quintptr(parent));
+}
+
+int QmlSqlSchemaModel::rowCount(const QModelIndex& parent) const {
+    if (parent.column() > 0)
+        return 0;
+    return m_nodes.at(nodeOf(parent)).children.count();
+}
+
+int QmlSqlSchemaModel::columnCount(const QModelIndex& parent) const {
+    Q_UNUSED(parent)
+    return 1;
+}
+
+bool QmlSqlSchemaModel::hasChildren(const QModelIndex& parent) const {
+    const Node& node = m_nodes.at(nodeOf(parent));
+    return !node.fetched || !node.children.isEmpty();
+}
+
+bool QmlSqlSchemaModel::canFetchMore(const QModelIndex& parent) const {
+    return parent.isValid() && !m_nodes.at(nodeOf(parent)).fetched;
+}
+
+void QmlSqlSchemaModel::fetchMore(const QModelIndex& parent) {
+    const int id = nodeOf(parent);
+    if (!parent.isValid() || m_nodes.at(id).fetched || m_database == nullptr)
+        return;
+    m_nodes[id].fetched = true;
+
+    const QSqlDatabase db = QSqlDatabase::database(m_database->connectionName(), false);
+    QmlSqlSchemaCache* cache = QmlSqlSchemaCache::instance();
+    const QString table = m_nodes.at(id).name;
+    const QSqlRecord fields = cache->record(db, table);
+    const QSqlIndex key = cache->primaryIndex(db, table);
+    const QVariantList indexes = m_nodes.at(id).kind == "view" ? QVariantList() : cache->indexList(db, table);
+    if (fields.isEmpty() && indexes.isEmpty())
+        return;
+
+    beginInsertRows(parent, 0, fields.count() + indexes.count() - 1);
+    for (int i = 0; i < fields.count(); i++)
+        addNode(id, "column", fields.fieldName(i), QmlSqlSchemaCache::fieldInfo(fields.field(i), key.contains(fields.fieldName(i))), true);
+    foreach (const QVariant& index, indexes)
+        addNode(id, "index", index.toMap().value("name").toString(), index.toMap(), true);
+    endInsertRows();
+}
+
+QVariant QmlSqlSchemaModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid())
+        return QVariant();
+
+    const Node& node = m_nodes.at(nodeOf(index));
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return node.name;
+    case KindRole:
+        return node.kind;
+    case DetailsRole:
+        return node.details;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> QmlSqlSchemaModel::roleNames() const {
+    QHash<int, QByteArray> roles;
+    roles.insert(Qt::DisplayRole, "display");
+    roles.insert(NameRole, "name");
+    roles.insert(KindRole, "kind");
+    roles.insert(DetailsRole, "details");
+    return roles;
+}
@@ -0,0 +1,84 @@
+#ifndef QMLSQLSCHEMAMODEL_H
+#define QMLSQLSCHEMAMODEL_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QString>
+#include <QVariant>
+#include <QVariantMap>
+#include <QVector>
+
+class QmlSqlDatabase;
+
+class QmlSqlSchemaModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QmlSqlDatabase* database READ database WRITE setDatabase NOTIFY databaseChanged)
+    Q_PROPERTY(bool showViews READ showViews WRITE setShowViews NOTIFY showViewsChanged)
+    Q_PROPERTY(bool showSystemTables READ showSystemTables WRITE setShowSystemTables NOTIFY showSystemTablesChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    explicit QmlSqlSchemaModel(QObject *parent = nullptr);
+
+    enum Roles{ NameRole = Qt::UserRole + 1, KindRole, DetailsRole };
+
+    QmlSqlDatabase* database() const;
+    void setDatabase(QmlSqlDatabase* database);
+
+    bool showViews() const;
+    void setShowViews(bool showViews);
+
+    bool showSystemTables() const;
+    void setShowSystemTables(bool showSystemTables);
+
+    int count() const;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex& child) const;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const;
+    bool canFetchMore(const QModelIndex& parent) const;
+    void fetchMore(const QModelIndex& parent);
+    QVariant data(const QModelIndex& index, int role) const;
+    QHash<int, QByteArray> roleNames() const;
+
+public slots:
+    void reload();
+
+signals:
+    void databaseChanged();
+    void showViewsChanged();
+    void showSystemTablesChanged();
+    void countChanged();
+
+private slots:
+    void handleSchemaChanged(const QString& connectionName);
+
+private:
+    struct Node
+    {
+        Node() : parent(-1), row(0), fetched(true) {}
+        int parent;
+        int row;
+        QString kind;
+        QString name;
+        QVariantMap details;
+        QVector<int> children;
+        // tables and views read their columns and indexes once they are expanded
+        bool fetched;
+    };
+
+    int nodeOf(const QModelIndex& index) const;
+    int addNode(int parent, const QString& kind, const QString& name, const QVariantMap& details, bool fetched);
+
+    QmlSqlDatabase* m_database;
+    bool m_showViews;
+    bool m_showSystemTables;
+    // m_nodes[0] is the invisible root
+    QVector<Node> m_nodes;
+};
+
+#endif // QMLSQLSCHEMAMODEL_H
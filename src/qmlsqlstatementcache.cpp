@@ -0,0 +1,107 @@
+#include "qmlsqlstatementcache.h"
+
+static const int defaultCapacity = 32;
+
+QmlSqlStatementCache* QmlSqlStatementCache::instance() {
+    static QmlSqlStatementCache cache;
+    return &cache;
+}
+
+// pooled clones are named "<connectionName>@<thread>"
+QString QmlSqlStatementCache::baseName(const QString& connectionName) {
+    const int at = connectionName.lastIndexOf('@');
+    return at < 0 ? connectionName : connectionName.left(at);
+}
+
+int QmlSqlStatementCache::capacity(const QString& connectionName) const {
+    return m_capacity.value(baseName(connectionName), defaultCapacity);
+}
+
+/*!
+ \brief QSqlQuery QmlSqlStatementCache::prepare(const QSqlDatabase& db, const QString& query)
+ Returns \c query prepared on \c db. A statement that has been prepared on this connection before is
+ handed out from the cache instead of being prepared again. The returned QSqlQuery shares its result
+ with the cached one, so call finish() on it once its rows have been read.
+ */
+QSqlQuery QmlSqlStatementCache::prepare(const QSqlDatabase& db, const QString& query) {
+    const QString name = db.connectionName();
+    {
+        QMutexLocker locker(&m_mutex);
+        Statements* statements = m_statements.value(name);
+        if (statements == nullptr) {
+            statements = new Statements;
+            m_statements.insert(name, statements);
+        }
+        // a smaller capacity deletes statements, which only the thread of the connection may do
+        if (statements->queries.maxCost() != capacity(name))
+            statements->queries.setMaxCost(capacity(name));
+
+        if (statements->queries.maxCost() > 0) {
+            QSqlQuery* cached = statements->queries.object(query);
+            if (cached != nullptr) {
+                statements->hits++;
+                return *cached;
+            }
+            statements->misses++;
+        }
+    }
+
+    QSqlQuery prepared(db);
+    if (!prepared.prepare(query))
+        return prepared;
+
+    QMutexLocker locker(&m_mutex);
+    Statements* statements = m_statements.value(name);
+    if (statements != nullptr && statements->queries.maxCost() > 0)
+        statements->queries.insert(query, new QSqlQuery(prepared));
+    return prepared;
+}
+
+/*!
+ \brief void QmlSqlStatementCache::invalidate(const QString& connectionName)
+ Drops every statement cached for the connection \c connectionName. This must happen before the
+ connection is removed, a prepared statement can not outlive its driver. Deleting a statement talks to
+ its driver, so this must be called from the thread that owns the connection. The statements of the
+ pooled clones are dropped by QmlSqlConnectionPool on the thread of each clone.
+ */
+void QmlSqlStatementCache::invalidate(const QString& connectionName) {
+    QMutexLocker locker(&m_mutex);
+    delete m_statements.take(connectionName);
+}
+
+/*!
+ \brief void QmlSqlStatementCache::setCapacity(const QString& connectionName, int capacity)
+ Sets how many statements are cached per connection of \c connectionName. 0 turns the cache off.
+ Every connection takes the new capacity the next time it prepares a statement on its own thread.
+ */
+void QmlSqlStatementCache::setCapacity(const QString& connectionName, int capacity) {
+    QMutexLocker locker(&m_mutex);
+    m_capacity.insert(baseName(connectionName), qMax(0, capacity));
+}
+
+/*!
+ \brief QVariantMap QmlSqlStatementCache::stats(const QString& connectionName)
+ Returns the \c hits, \c misses and number of \c cached statements of \c connectionName and its clones.
+ */
+QVariantMap QmlSqlStatementCache::stats(const QString& connectionName) {
+    QMutexLocker locker(&m_mutex);
+    const QString base = baseName(connectionName);
+    qint64 hits = 0;
+    qint64 misses = 0;
+    int cached = 0;
+    QHash<QString, Statements*>::const_iterator it = m_statements.constBegin();
+    for (; it != m_statements.constEnd(); ++it) {
+        if (baseName(it.key()) != base)
+            continue;
+        hits += it.value()->hits;
+        misses += it.value()->misses;
+        cached += it.value()->queries.count();
+    }
+
+    QVariantMap map;
+    map.insert("hits", hits);
+    map.insert("misses", misses);
+    map.insert("cached", cached);
+    map.insert("capacity", capacity(base));
+    return map;
+}
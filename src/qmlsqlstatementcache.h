@@ -0,0 +1,51 @@
+#ifndef QMLSQLSTATEMENTCACHE_H
+#define QMLSQLSTATEMENTCACHE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+
+/*!
+ * \brief The QmlSqlStatementCache class
+ * Process wide LRU cache of prepared QSqlQuery objects, one cache per connection keyed by the
+ * statement text. The pooled clones of a connection share its capacity and statistics.
+ *
+ * All members are thread safe, the cached statements themselves must only be used and dropped on the
+ * thread that owns their connection.
+ */
+class QmlSqlStatementCache
+{
+public:
+    static QmlSqlStatementCache* instance();
+
+    QSqlQuery prepare(const QSqlDatabase& db, const QString& query);
+    void invalidate(const QString& connectionName);
+
+    void setCapacity(const QString& connectionName, int capacity);
+    QVariantMap stats(const QString& connectionName);
+
+private:
+    struct Statements
+    {
+        Statements() : hits(0), misses(0) {}
+        QCache<QString, QSqlQuery> queries;
+        qint64 hits;
+        qint64 misses;
+    };
+
+    QmlSqlStatementCache() {}
+    Q_DISABLE_COPY(QmlSqlStatementCache)
+
+    static QString baseName(const QString& connectionName);
+    int capacity(const QString& connectionName) const;
+
+    QMutex m_mutex;
+    QHash<QString, Statements*> m_statements;
+    QHash<QString, int> m_capacity;
+};
+
+#endif // QMLSQLSTATEMENTCACHE_H
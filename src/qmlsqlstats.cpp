@@ -0,0 +1,514 @@
+#include "qmlsqlstats.h"
+#include "qmlsqlplan.h"
+#include "qmlsqlchangenotifier.h"
+#include <QQmlEngine>
+#include <QDebug>
+#include <QRegularExpression>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QFile>
+#include <QtMath>
+#include <QStringBuilder>
+#include <algorithm>
+
+// latency buckets four per power of two microseconds, the last one ends after about an hour
+static const int histogramBuckets = 128;
+
+/*!
+   \qmltype QmlSqlStats
+   \inqmlmodule QmlSql 1.0
+   \ingroup QmlSql
+   \inherits QObject
+   \brief The QmlSqlStats singleton records how long the statements of QmlSql take.
+
+Every statement run by QmlSqlQuery, QmlSqlQueryModel and QmlSqlPagedModel is timed. The statistics are
+grouped by connection and by the fingerprint of the statement, which is the statement with its literals
+replaced by \c ?, so \c{WHERE id = 1} and \c{WHERE id = 2} count as one statement.
+
+For every statement statements() returns how often it ran and failed, the rows and bytes it returned, the
+mean time spent preparing, executing and fetching, and the p50, p95 and p99 of its latency. Statements
+that took longer than slowQueryThreshold are also kept in slowQueries() and reported with slowQuery().
+
+\code
+    Connections {
+        target: QmlSqlStats
+        onSlowQuery: console.warn("slow query", query.elapsedMs, "ms:", query.query)
+    }
+
+    Timer {
+        interval: 60000; repeat: true; running: true
+        onTriggered: QmlSqlStats.dump(telemetryDir + "/sql-stats.json")
+    }
+\endcode
+
+During development autoExplain reads the plan of every statement once and warns about the ones that
+scan a large table or sort through a temporary B-tree, see planWarning().
+
+ */
+QmlSqlStats::QmlSqlStats(QObject *parent) :
+    QObject(parent),
+    m_enabled(true),
+    m_slowQueryThreshold(500),
+    m_slowQueryLogSize(100),
+    m_queryCount(0),
+    m_slowQueryCount(0),
+    m_autoExplain(false),
+    m_explainThreshold(1000)
+{
+    connect(this, SIGNAL(error(QString)), this, SLOT(handleErrorString(QString)));
+    // direct, so a plan is checked again once an index has been added or dropped
+    connect(QmlSqlChangeNotifier::instance(), SIGNAL(schemaChanged(QString)),
+            this, SLOT(handleSchemaChanged(QString)), Qt::DirectConnection);
+}
+
+QmlSqlStats* QmlSqlStats::instance() {
+    static QmlSqlStats stats;
+    return &stats;
+}
+
+QObject* QmlSqlStats::qmlInstance(QQmlEngine* engine, QJSEngine* scriptEngine) {
+    Q_UNUSED(engine)
+    Q_UNUSED(scriptEngine)
+    QQmlEngine::setObjectOwnership(instance(), QQmlEngine::CppOwnership);
+    return instance();
+}
+
+QmlSqlStats::Sample::Sample(const QString& connectionName, const QString& query) :
+    m_connectionName(connectionName),
+    m_query(query),
+    m_lap(0),
+    m_prepare(0),
+    m_exec(0),
+    m_fetch(0),
+    m_rows(0),
+    m_bytes(0),
+    m_ok(true)
+{
+    m_timer.start();
+}
+
+// microseconds since the previous step
+qint64 QmlSqlStats::Sample::lap() {
+    const qint64 now = m_timer.nsecsElapsed();
+    const qint64 micros = (now - m_lap) / 1000;
+    m_lap = now;
+    return micros;
+}
+
+void QmlSqlStats::Sample::prepared() {
+    m_prepare = lap();
+}
+
+void QmlSqlStats::Sample::executed() {
+    m_exec = lap();
+}
+
+void QmlSqlStats::Sample::fetched(int rows, qint64 bytes) {
+    m_fetch = lap();
+    m_rows = rows;
+    m_bytes = bytes;
+}
+
+void QmlSqlStats::Sample::failed() {
+    m_ok = false;
+}
+
+// pooled clones are named "<connectionName>@<thread>"
+QString QmlSqlStats::baseName(const QString& connectionName) {
+    const int at = connectionName.lastIndexOf('@');
+    return at < 0 ? connectionName : connectionName.left(at);
+}
+
+/*!
+ \brief QString QmlSqlStats::fingerprint(const QString& query)
+ Returns \c query with its string and number literals replaced by "?", lists of them in an IN collapsed
+ to one "?" and its white space collapsed.
+ */
+QString QmlSqlStats::fingerprint(const QString& query) {
+    static const QRegularExpression strings("'(?:[^']|'')*'");
+    static const QRegularExpression numbers("\\b\\d+(?:\\.\\d+)?\\b");
+    static const QRegularExpression lists("\\bIN\\s*\\(\\s*\\?(?:\\s*,\\s*\\?)*\\s*\\)", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression space("\\s+");
+
+    QString text = query;
+    text.replace(strings, "?");
+    text.replace(numbers, "?");
+    text.replace(lists, "IN (?)");
+    text.replace(space, " ");
+    text = text.trimmed();
+    while (text.endsWith(';'))
+        text.chop(1);
+    return text;
+}
+
+int QmlSqlStats::bucket(qint64 micros) {
+    if (micros <= 1)
+        return 0;
+    return qMin(histogramBuckets - 1, int(4 * std::log2(double(micros))));
+}
+
+// the upper bound of the bucket the fraction of runs falls into, in microseconds
+qint64 QmlSqlStats::percentile(const Statement& statement, double fraction) {
+    const qint64 rank = qMax<qint64>(1, qCeil(fraction * statement.count));
+    qint64 seen = 0;
+    for (int i = 0; i < statement.histogram.count(); i++) {
+        seen += statement.histogram.at(i);
+        if (seen >= rank)
+            return qMin(statement.max, qint64(qCeil(std::pow(2.0, (i + 1) / 4.0))));
+    }
+    return statement.max;
+}
+
+/*!
+ \brief void QmlSqlStats::record(const QmlSqlStats::Sample& sample)
+ Adds a timed run of a statement to the statistics of its fingerprint.
+ */
+void QmlSqlStats::record(const Sample& sample) {
+    const qint64 total = sample.m_prepare + sample.m_exec + sample.m_fetch;
+    QVariantMap slow;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_enabled)
+            return;
+
+        const QString connectionName = baseName(sample.m_connectionName);
+        const QString print = fingerprint(sample.m_query);
+        Statement& statement = m_statements[connectionName % QLatin1Char('\n') % print];
+        if (statement.count == 0) {
+            statement.connectionName = connectionName;
+            statement.fingerprint = print;
+            statement.histogram.fill(0, histogramBuckets);
+        }
+        statement.count++;
+        if (!sample.m_ok)
+            statement.errors++;
+        statement.rows += sample.m_rows;
+        statement.bytes += sample.m_bytes;
+        statement.prepare += sample.m_prepare;
+        statement.exec += sample.m_exec;
+        statement.fetch += sample.m_fetch;
+        statement.max = qMax(statement.max, total);
+        statement.histogram[bucket(total)]++;
+        m_queryCount++;
+
+        if (m_slowQueryThreshold >= 0 && total >= qint64(m_slowQueryThreshold) * 1000) {
+            slow.insert("time", QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs));
+            slow.insert("connectionName", connectionName);
+            slow.insert("query", sample.m_query);
+            slow.insert("fingerprint", print);
+            slow.insert("elapsedMs", total / 1000.0);
+            slow.insert("rows", sample.m_rows);
+            slow.insert("ok", sample.m_ok);
+            m_slowQueries.append(slow);
+            while (m_slowQueries.count() > m_slowQueryLogSize)
+                m_slowQueries.removeFirst();
+            m_slowQueryCount++;
+        }
+    }
+
+    emit statsChanged();
+    if (!slow.isEmpty())
+        emit slowQuery(slow);
+}
+
+/*!
+ \brief void QmlSqlStats::checkPlan(const QSqlDatabase& db, const QmlSqlStats::Sample& sample, const QVariant& bindValues)
+ When autoExplain is set, reads the plan of the statement \c sample timed the first time it has run
+ successfully on its connection and reports its full scans and temporary B-trees with planWarning().
+ Must be called from the thread that owns \c db, right after record().
+ */
+void QmlSqlStats::checkPlan(const QSqlDatabase& db, const Sample& sample, const QVariant& bindValues) {
+    if (!sample.m_ok || !QmlSqlPlan::isExplainable(sample.m_query))
+        return;
+
+    const QString connectionName = baseName(sample.m_connectionName);
+    qint64 threshold = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_autoExplain)
+            return;
+        const QString key = connectionName % QLatin1Char('\n') % fingerprint(sample.m_query);
+        if (m_explained.contains(key))
+            return;
+        m_explained.insert(key);
+        threshold = m_explainThreshold;
+    }
+
+    QString errorString;
+    const QVector<QmlSqlPlan::Step> steps = QmlSqlPlan::explain(db, sample.m_query, bindValues, &errorString);
+    // without an estimate a step counts as big as the number of rows the statement returned
+    const QStringList findings = QmlSqlPlan::findings(steps, threshold, sample.m_rows);
+    if (findings.isEmpty())
+        return;
+
+    const qint64 total = sample.m_prepare + sample.m_exec + sample.m_fetch;
+    QVariantMap warning;
+    warning.insert("time", QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs));
+    warning.insert("connectionName", connectionName);
+    warning.insert("query", sample.m_query);
+    warning.insert("elapsedMs", total / 1000.0);
+    warning.insert("rows", sample.m_rows);
+    warning.insert("findings", findings);
+    qWarning().noquote() << "QmlSql plan of" << sample.m_query << "took" << total / 1000.0 << "ms:" << findings.join("; ");
+    emit planWarning(warning);
+}
+
+void QmlSqlStats::handleSchemaChanged(const QString& connectionName) {
+    QMutexLocker locker(&m_mutex);
+    const QString prefix = connectionName % QLatin1Char('\n');
+    QSet<QString>::iterator it = m_explained.begin();
+    while (it != m_explained.end()) {
+        if (it->startsWith(prefix))
+            it = m_explained.erase(it);
+        else
+            ++it;
+    }
+}
+
+/*!
+ \qmlproperty bool QmlSqlStats::autoExplain
+  A development aid: when true the plan of every SELECT, INSERT, UPDATE and DELETE is read with
+  QmlSqlPlan the first time it runs on a connection. Statements whose plan reads a whole table or builds
+  a temporary B-tree of at least explainThreshold rows are logged as a warning together with the time
+  they took, and reported with planWarning(). Its argument has the \c time, \c connectionName,
+  \c query, \c elapsedMs, \c rows and the \c findings of QmlSqlPlan::findings(). A statement is
+  checked again once the schema of its connection has changed. This costs an extra round trip per new
+  statement, the default is false.
+
+  \sa QmlSqlPlan, QmlSqlQuery::explain()
+*/
+bool QmlSqlStats::autoExplain() const {
+    QMutexLocker locker(&m_mutex);
+    return m_autoExplain;
+}
+
+void QmlSqlStats::setAutoExplain(bool autoExplain) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_autoExplain == autoExplain)
+            return;
+        m_autoExplain = autoExplain;
+    }
+    emit autoExplainChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlStats::explainThreshold
+  How many rows a full scan or temporary B-tree has to touch before autoExplain warns about it. The
+  estimate of the database is used where its plan has one, otherwise the number of rows the statement
+  returned. The default is 1000.
+*/
+int QmlSqlStats::explainThreshold() const {
+    QMutexLocker locker(&m_mutex);
+    return m_explainThreshold;
+}
+
+void QmlSqlStats::setExplainThreshold(int explainThreshold) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_explainThreshold == explainThreshold)
+            return;
+        m_explainThreshold = explainThreshold;
+    }
+    emit explainThresholdChanged();
+}
+
+/*!
+ \qmlproperty bool QmlSqlStats::enabled
+  Whether statements are recorded. The default is true.
+*/
+bool QmlSqlStats::isEnabled() const {
+    QMutexLocker locker(&m_mutex);
+    return m_enabled;
+}
+
+void QmlSqlStats::setEnabled(bool enabled) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_enabled == enabled)
+            return;
+        m_enabled = enabled;
+    }
+    emit enabledChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlStats::slowQueryThreshold
+  How many milliseconds a statement may take before it is logged as a slow query. A negative value turns
+  the slow query log off. The default is 500.
+*/
+int QmlSqlStats::slowQueryThreshold() const {
+    QMutexLocker locker(&m_mutex);
+    return m_slowQueryThreshold;
+}
+
+void QmlSqlStats::setSlowQueryThreshold(int slowQueryThreshold) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_slowQueryThreshold == slowQueryThreshold)
+            return;
+        m_slowQueryThreshold = slowQueryThreshold;
+    }
+    emit slowQueryThresholdChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlStats::slowQueryLogSize
+  How many slow queries are kept, the oldest ones are dropped first. The default is 100.
+*/
+int QmlSqlStats::slowQueryLogSize() const {
+    QMutexLocker locker(&m_mutex);
+    return m_slowQueryLogSize;
+}
+
+void QmlSqlStats::setSlowQueryLogSize(int slowQueryLogSize) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_slowQueryLogSize == qMax(0, slowQueryLogSize))
+            return;
+        m_slowQueryLogSize = qMax(0, slowQueryLogSize);
+        while (m_slowQueries.count() > m_slowQueryLogSize)
+            m_slowQueries.removeFirst();
+    }
+    emit slowQueryLogSizeChanged();
+}
+
+/*!
+ \qmlproperty int QmlSqlStats::queryCount
+  How many statements have been recorded since the start or the last reset().
+*/
+int QmlSqlStats::queryCount() const {
+    QMutexLocker locker(&m_mutex);
+    return int(m_queryCount);
+}
+
+/*!
+ \qmlproperty int QmlSqlStats::slowQueryCount
+  How many of them were slower than slowQueryThreshold, including the ones dropped from the log.
+*/
+int QmlSqlStats::slowQueryCount() const {
+    QMutexLocker locker(&m_mutex);
+    return int(m_slowQueryCount);
+}
+
+/*!
+ \qmlproperty string QmlSqlStats::errorString
+  Why the last dump() failed.
+*/
+QString QmlSqlStats::errorString() const {
+    return m_error;
+}
+
+void QmlSqlStats::handleErrorString(const QString& errorString) {
+    if (m_error == errorString)
+        return;
+    m_error = errorString;
+    emit errorStringChanged();
+}
+
+bool QmlSqlStats::slowerThan(const Statement& a, const Statement& b) {
+    return a.prepare + a.exec + a.fetch > b.prepare + b.exec + b.fetch;
+}
+
+QVariantMap QmlSqlStats::toMap(const Statement& statement) {
+    const double count = qMax<qint64>(1, statement.count);
+    QVariantMap map;
+    map.insert("connectionName", statement.connectionName);
+    map.insert("fingerprint", statement.fingerprint);
+    map.insert("count", statement.count);
+    map.insert("errors", statement.errors);
+    map.insert("rows", statement.rows);
+    map.insert("bytes", statement.bytes);
+    map.insert("prepareMs", statement.prepare / count / 1000.0);
+    map.insert("execMs", statement.exec / count / 1000.0);
+    map.insert("fetchMs", statement.fetch / count / 1000.0);
+    map.insert("meanMs", (statement.prepare + statement.exec + statement.fetch) / count / 1000.0);
+    map.insert("maxMs", statement.max / 1000.0);
+    map.insert("p50Ms", percentile(statement, 0.50) / 1000.0);
+    map.insert("p95Ms", percentile(statement, 0.95) / 1000.0);
+    map.insert("p99Ms", percentile(statement, 0.99) / 1000.0);
+    return map;
+}
+
+/*!
+ \qmlmethod list QmlSqlStats::statements()
+ Returns one object per connection and fingerprint with its \c connectionName, \c fingerprint, \c count,
+ \c errors, \c rows and \c bytes, the mean \c prepareMs, \c execMs, \c fetchMs and \c meanMs, and the
+ \c maxMs, \c p50Ms, \c p95Ms and \c p99Ms of its latency. The slowest statements come first.
+ */
+QVariantList QmlSqlStats::statements() const {
+    QList<Statement> sorted;
+    {
+        QMutexLocker locker(&m_mutex);
+        sorted = m_statements.values();
+    }
+    std::sort(sorted.begin(), sorted.end(), slowerThan);
+
+    QVariantList list;
+    foreach (const Statement& statement, sorted)
+        list << toMap(statement);
+    return list;
+}
+
+/*!
+ \qmlmethod list QmlSqlStats::slowQueries()
+ Returns the logged slow queries, oldest first, with the \c time they finished, their \c connectionName,
+ \c query, \c fingerprint, \c elapsedMs, \c rows and whether they were \c ok.
+ */
+QVariantList QmlSqlStats::slowQueries() const {
+    QMutexLocker locker(&m_mutex);
+    QVariantList list;
+    foreach (const QVariantMap& query, m_slowQueries)
+        list << query;
+    return list;
+}
+
+/*!
+ \qmlmethod string QmlSqlStats::toJson()
+ Returns statements() and slowQueries() as a JSON document, along with the time it was taken, queryCount,
+ slowQueryCount and slowQueryThreshold.
+ */
+QString QmlSqlStats::toJson() const {
+    QJsonObject object;
+    object.insert("time", QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs));
+    object.insert("queryCount", double(queryCount()));
+    object.insert("slowQueryCount", double(slowQueryCount()));
+    object.insert("slowQueryThreshold", slowQueryThreshold());
+    object.insert("statements", QJsonArray::fromVariantList(statements()));
+    object.insert("slowQueries", QJsonArray::fromVariantList(slowQueries()));
+    return QString::fromUtf8(QJsonDocument(object).toJson(QJsonDocument::Indented));
+}
+
+/*!
+ \qmlmethod bool QmlSqlStats::dump(string fileName)
+ Writes toJson() to \c fileName, replacing what was in it. Returns false and sets errorString when the
+ file can not be written.
+ */
+bool QmlSqlStats::dump(const QString& fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        error(QString("Could not open the file %1 for writing to ").arg(fileName));
+        return false;
+    }
+    file.write(toJson().toUtf8());
+    file.close();
+    return true;
+}
+
+/*!
+ \qmlmethod void QmlSqlStats::reset()
+ Forgets all statements and slow queries, and which plans autoExplain has checked.
+ */
+void QmlSqlStats::reset() {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_statements.clear();
+        m_slowQueries.clear();
+        m_queryCount = 0;
+        m_slowQueryCount = 0;
+        m_explained.clear();
+    }
+    emit statsChanged();
+}
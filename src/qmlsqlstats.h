@@ -0,0 +1,164 @@
+#ifndef QMLSQLSTATS_H
+#define QMLSQLSTATS_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QVector>
+#include <QString>
+#include <QVariant>
+#include <QVariantList>
+#include <QVariantMap>
+
+class QQmlEngine;
+class QJSEngine;
+
+/*!
+ * \brief The QmlSqlStats class
+ * Process wide statistics of the statements QmlSql runs, grouped by connection and statement
+ * fingerprint, which is the statement with its literals replaced by "?". Every statement keeps its
+ * prepare, exec and fetch times, the rows and bytes it returned and a latency histogram the p50, p95
+ * and p99 are read from. Statements slower than slowQueryThreshold are kept in a slow query log.
+ *
+ * All members are thread safe.
+ */
+class QmlSqlStats : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(int slowQueryThreshold READ slowQueryThreshold WRITE setSlowQueryThreshold NOTIFY slowQueryThresholdChanged)
+    Q_PROPERTY(int slowQueryLogSize READ slowQueryLogSize WRITE setSlowQueryLogSize NOTIFY slowQueryLogSizeChanged)
+    Q_PROPERTY(int queryCount READ queryCount NOTIFY statsChanged)
+    Q_PROPERTY(int slowQueryCount READ slowQueryCount NOTIFY statsChanged)
+    Q_PROPERTY(QString errorString READ errorString NOTIFY errorStringChanged)
+    Q_PROPERTY(bool autoExplain READ autoExplain WRITE setAutoExplain NOTIFY autoExplainChanged)
+    Q_PROPERTY(int explainThreshold READ explainThreshold WRITE setExplainThreshold NOTIFY explainThresholdChanged)
+
+public:
+    /*!
+     * \brief The Sample class
+     * Times one run of a statement. Call prepared(), executed() and fetched() as the statement gets
+     * through these steps, then hand it to record().
+     */
+    class Sample
+    {
+    public:
+        Sample(const QString& connectionName, const QString& query);
+
+        void prepared();
+        void executed();
+        void fetched(int rows, qint64 bytes);
+        void failed();
+
+    private:
+        friend class QmlSqlStats;
+        qint64 lap();
+
+        QString m_connectionName;
+        QString m_query;
+        QElapsedTimer m_timer;
+        qint64 m_lap;
+        qint64 m_prepare;
+        qint64 m_exec;
+        qint64 m_fetch;
+        int m_rows;
+        qint64 m_bytes;
+        bool m_ok;
+    };
+
+    static QmlSqlStats* instance();
+    static QObject* qmlInstance(QQmlEngine* engine, QJSEngine* scriptEngine);
+
+    static QString fingerprint(const QString& query);
+
+    void record(const Sample& sample);
+    void checkPlan(const QSqlDatabase& db, const Sample& sample, const QVariant& bindValues);
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    int slowQueryThreshold() const;
+    void setSlowQueryThreshold(int slowQueryThreshold);
+
+    int slowQueryLogSize() const;
+    void setSlowQueryLogSize(int slowQueryLogSize);
+
+    int queryCount() const;
+    int slowQueryCount() const;
+    QString errorString() const;
+
+    bool autoExplain() const;
+    void setAutoExplain(bool autoExplain);
+
+    int explainThreshold() const;
+    void setExplainThreshold(int explainThreshold);
+
+    Q_INVOKABLE QVariantList statements() const;
+    Q_INVOKABLE QVariantList slowQueries() const;
+    Q_INVOKABLE QString toJson() const;
+    Q_INVOKABLE bool dump(const QString& fileName);
+    Q_INVOKABLE void reset();
+
+signals:
+    void enabledChanged();
+    void slowQueryThresholdChanged();
+    void slowQueryLogSizeChanged();
+    void statsChanged();
+    void slowQuery(const QVariantMap& query);
+    void error(const QString& errorString);
+    void errorStringChanged();
+    void autoExplainChanged();
+    void explainThresholdChanged();
+    void planWarning(const QVariantMap& warning);
+
+private slots:
+    void handleErrorString(const QString& errorString);
+    void handleSchemaChanged(const QString& connectionName);
+
+private:
+    struct Statement
+    {
+        Statement() : count(0), errors(0), rows(0), bytes(0), prepare(0), exec(0), fetch(0), max(0) {}
+        QString connectionName;
+        QString fingerprint;
+        qint64 count;
+        qint64 errors;
+        qint64 rows;
+        qint64 bytes;
+        // totals in microseconds
+        qint64 prepare;
+        qint64 exec;
+        qint64 fetch;
+        qint64 max;
+        QVector<qint64> histogram;
+    };
+
+    explicit QmlSqlStats(QObject *parent = nullptr);
+    Q_DISABLE_COPY(QmlSqlStats)
+
+    static QString baseName(const QString& connectionName);
+    static int bucket(qint64 micros);
+    static qint64 percentile(const Statement& statement, double fraction);
+    static bool slowerThan(const Statement& a, const Statement& b);
+    static QVariantMap toMap(const Statement& statement);
+
+    mutable QMutex m_mutex;
+    bool m_enabled;
+    int m_slowQueryThreshold;
+    int m_slowQueryLogSize;
+    QHash<QString, Statement> m_statements;
+    QList<QVariantMap> m_slowQueries;
+    qint64 m_queryCount;
+    qint64 m_slowQueryCount;
+    QString m_error;
+    bool m_autoExplain;
+    int m_explainThreshold;
+    // connection and fingerprint of the statements whose plan has been checked
+    QSet<QString> m_explained;
+};
+
+#endif // QMLSQLSTATS_H
@@ -12,20 +12,59 @@ CONFIG += qt plugin c++11
 TARGET = $$qtLibraryTarget($$TARGET)
 uri = QmlSql
 
+# lets QmlSqlQuery::cancel() interrupt a running SQLite statement, only safe when Qt's QSQLITE
+# driver is built against the same system SQLite (-system-sqlite)
+qmlsql_sqlite_interrupt {
+    DEFINES += QMLSQL_SQLITE_INTERRUPT
+    LIBS += -lsqlite3
+}
+
 # Input
 SOURCES += \
     plugin.cpp \
     qmlsqldatabase.cpp \
     qmlsqlquerymodel.cpp \
     qmlsqlcreatedatabase.cpp \
-    qmlsqlquery.cpp
+    qmlsqlquery.cpp \
+    qmlsqlqueryworker.cpp \
+    qmlsqlmodelworker.cpp \
+    qmlsqlconnectionpool.cpp \
+    qmlsqlstatementcache.cpp \
+    qmlsqlresultset.cpp \
+    qmlsqlresult.cpp \
+    qmlsqlrowdiff.cpp \
+    qmlsqlchangenotifier.cpp \
+    qmlsqlpagedmodel.cpp \
+    qmlsqlresultcache.cpp \
+    qmlsqlstats.cpp \
+    qmlsqlopenworker.cpp \
+    qmlsqlschemacache.cpp \
+    qmlsqlschemamodel.cpp \
+    qmlsqlcanceller.cpp \
+    qmlsqlplan.cpp
 
 HEADERS += \
     plugin.h \
     qmlsqldatabase.h \
     qmlsqlquerymodel.h \
     qmlsqlcreatedatabase.h \
-    qmlsqlquery.h
+    qmlsqlquery.h \
+    qmlsqlqueryworker.h \
+    qmlsqlmodelworker.h \
+    qmlsqlconnectionpool.h \
+    qmlsqlstatementcache.h \
+    qmlsqlresultset.h \
+    qmlsqlresult.h \
+    qmlsqlrowdiff.h \
+    qmlsqlchangenotifier.h \
+    qmlsqlpagedmodel.h \
+    qmlsqlresultcache.h \
+    qmlsqlstats.h \
+    qmlsqlopenworker.h \
+    qmlsqlschemacache.h \
+    qmlsqlschemamodel.h \
+    qmlsqlcanceller.h \
+    qmlsqlplan.h
 
 
 DISTFILES = qmldir
@@ -0,0 +1,131 @@
+#include <QtTest>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "qmlsqldatabase.h"
+#include "qmlsqlquerymodel.h"
+
+static const char* connectionName = "qmlsql-querymodel";
+
+/*!
+ * \brief The tst_QmlSqlQueryModel class
+ * Tests of the writable QmlSqlQueryModel against an in-memory SQLite database with the table person.
+ */
+class tst_QmlSqlQueryModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+
+    void refreshKeepsPendingEdits();
+    void refreshKeepsPendingEditsIncremental();
+
+private:
+    void setUpModel(QmlSqlQueryModel* model, QmlSqlQueryModel::RefreshMode refreshMode);
+    QVariant value(const QmlSqlQueryModel& model, int row, const QByteArray& column) const;
+    int count(const QString& statement) const;
+
+    QmlSqlDatabase* m_database;
+};
+
+void tst_QmlSqlQueryModel::initTestCase() {
+    QVERIFY(QSqlDatabase::isDriverAvailable("QSQLITE"));
+
+    m_database = new QmlSqlDatabase(this);
+    m_database->setDatabaseDriver(QmlSqlDatabase::SQLite);
+    m_database->setDatabaseName(":memory:");
+    m_database->setConnectionName(connectionName);
+    m_database->open();
+    QVERIFY2(m_database->isConnected(), qPrintable(m_database->errorString()));
+
+    QSqlQuery query(QSqlDatabase::database(connectionName));
+    QVERIFY(query.exec("CREATE TABLE person (id INTEGER PRIMARY KEY, name TEXT)"));
+}
+
+void tst_QmlSqlQueryModel::cleanupTestCase() {
+    m_database->close();
+}
+
+void tst_QmlSqlQueryModel::init() {
+    QSqlQuery query(QSqlDatabase::database(connectionName));
+    QVERIFY(query.exec("DELETE FROM person"));
+    QVERIFY(query.exec("INSERT INTO person (id, name) VALUES (1, 'ada'), (2, 'grace')"));
+}
+
+void tst_QmlSqlQueryModel::setUpModel(QmlSqlQueryModel* model, QmlSqlQueryModel::RefreshMode refreshMode) {
+    model->setQueryString("SELECT id, name FROM person ORDER BY id");
+    model->setReadOnly(false);
+    model->setTableName("person");
+    model->setKeyColumn("id");
+    model->setRefreshMode(refreshMode);
+    model->setEditStrategy(QmlSqlQueryModel::OnManualSubmit);
+    // the model runs exec() as soon as it has a connected database
+    model->setDatabase(m_database);
+}
+
+QVariant tst_QmlSqlQueryModel::value(const QmlSqlQueryModel& model, int row, const QByteArray& column) const {
+    return model.data(model.index(row, 0), model.roleNames().key(column));
+}
+
+int tst_QmlSqlQueryModel::count(const QString& statement) const {
+    QSqlQuery query(QSqlDatabase::database(connectionName));
+    if (!query.exec(statement) || !query.next())
+        return -1;
+    return query.value(0).toInt();
+}
+
+// a refresh while edits are pending waits for submitAll() or revertAll() instead of dropping them
+void tst_QmlSqlQueryModel::refreshKeepsPendingEdits() {
+    QmlSqlQueryModel model;
+    setUpModel(&model, QmlSqlQueryModel::Reset);
+    QCOMPARE(model.rowCount(), 2);
+
+    QVERIFY(model.setValue(0, "name", "ada lovelace"));
+    QCOMPARE(model.pendingChanges(), 1);
+
+    QSqlQuery insert(QSqlDatabase::database(connectionName));
+    QVERIFY(insert.exec("INSERT INTO person (id, name) VALUES (3, 'edsger')"));
+    model.exec();
+    QCOMPARE(model.pendingChanges(), 1);
+    QCOMPARE(model.rowCount(), 2);
+    QCOMPARE(value(model, 0, "name").toString(), QString("ada lovelace"));
+    QCOMPARE(model.rowStatus(0), int(QmlSqlQueryModel::Updated));
+
+    // the held back refresh runs once the edits are gone
+    model.revertAll();
+    QCOMPARE(model.pendingChanges(), 0);
+    QCOMPARE(model.rowCount(), 3);
+    QCOMPARE(value(model, 0, "name").toString(), QString("ada"));
+
+    QVERIFY(model.setValue(1, "name", "grace hopper"));
+    model.exec();
+    QVERIFY2(model.submitAll(), qPrintable(model.errorString()));
+    QCOMPARE(model.pendingChanges(), 0);
+    QCOMPARE(value(model, 1, "name").toString(), QString("grace hopper"));
+    QCOMPARE(count("SELECT COUNT(*) FROM person WHERE name = 'grace hopper'"), 1);
+}
+
+void tst_QmlSqlQueryModel::refreshKeepsPendingEditsIncremental() {
+    QmlSqlQueryModel model;
+    setUpModel(&model, QmlSqlQueryModel::Incremental);
+    QCOMPARE(model.rowCount(), 2);
+
+    QVERIFY(model.deleteRow(1));
+    QSqlQuery update(QSqlDatabase::database(connectionName));
+    QVERIFY(update.exec("UPDATE person SET name = 'ada byron' WHERE id = 1"));
+    model.exec();
+    QCOMPARE(model.pendingChanges(), 1);
+    QCOMPARE(model.rowStatus(1), int(QmlSqlQueryModel::Deleted));
+    QCOMPARE(value(model, 0, "name").toString(), QString("ada"));
+
+    model.revertRow(1);
+    QCOMPARE(model.pendingChanges(), 0);
+    QCOMPARE(value(model, 0, "name").toString(), QString("ada byron"));
+}
+
+QTEST_GUILESS_MAIN(tst_QmlSqlQueryModel)
+
+#include "tst_qmlsqlquerymodel.moc"
@@ -0,0 +1,55 @@
+TEMPLATE = app
+TARGET = tst_qmlsqlbenchmarks
+QT += qml sql testlib
+CONFIG += c++11 testcase console
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/../../src
+
+SOURCES += \
+    tst_qmlsqlbenchmarks.cpp \
+    $$PWD/../../src/qmlsqldatabase.cpp \
+    $$PWD/../../src/qmlsqlquerymodel.cpp \
+    $$PWD/../../src/qmlsqlcreatedatabase.cpp \
+    $$PWD/../../src/qmlsqlquery.cpp \
+    $$PWD/../../src/qmlsqlqueryworker.cpp \
+    $$PWD/../../src/qmlsqlmodelworker.cpp \
+    $$PWD/../../src/qmlsqlconnectionpool.cpp \
+    $$PWD/../../src/qmlsqlstatementcache.cpp \
+    $$PWD/../../src/qmlsqlresultset.cpp \
+    $$PWD/../../src/qmlsqlresult.cpp \
+    $$PWD/../../src/qmlsqlrowdiff.cpp \
+    $$PWD/../../src/qmlsqlchangenotifier.cpp \
+    $$PWD/../../src/qmlsqlpagedmodel.cpp \
+    $$PWD/../../src/qmlsqlresultcache.cpp \
+    $$PWD/../../src/qmlsqlstats.cpp \
+    $$PWD/../../src/qmlsqlopenworker.cpp \
+    $$PWD/../../src/qmlsqlschemacache.cpp \
+    $$PWD/../../src/qmlsqlcanceller.cpp \
+    $$PWD/../../src/qmlsqlplan.cpp
+
+HEADERS += \
+    $$PWD/../../src/qmlsqldatabase.h \
+    $$PWD/../../src/qmlsqlquerymodel.h \
+    $$PWD/../../src/qmlsqlcreatedatabase.h \
+    $$PWD/../../src/qmlsqlquery.h \
+    $$PWD/../../src/qmlsqlqueryworker.h \
+    $$PWD/../../src/qmlsqlmodelworker.h \
+    $$PWD/../../src/qmlsqlconnectionpool.h \
+    $$PWD/../../src/qmlsqlstatementcache.h \
+    $$PWD/../../src/qmlsqlresultset.h \
+    $$PWD/../../src/qmlsqlresult.h \
+    $$PWD/../../src/qmlsqlrowdiff.h \
+    $$PWD/../../src/qmlsqlchangenotifier.h \
+    $$PWD/../../src/qmlsqlpagedmodel.h \
+    $$PWD/../../src/qmlsqlresultcache.h \
+    $$PWD/../../src/qmlsqlstats.h \
+    $$PWD/../../src/qmlsqlopenworker.h \
+    $$PWD/../../src/qmlsqlschemacache.h \
+    $$PWD/../../src/qmlsqlcanceller.h \
+    $$PWD/../../src/qmlsqlplan.h
+
+# "make benchmark" writes the results as QtTest XML to benchmarks.xml and prints them as well
+benchmark.commands = $$shell_path(./$$TARGET) -o benchmarks.xml,xml -o -,txt
+benchmark.depends = $$TARGET
+QMAKE_EXTRA_TARGETS += benchmark
@@ -0,0 +1,246 @@
+#include <QtTest>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "qmlsqldatabase.h"
+#include "qmlsqlquery.h"
+#include "qmlsqlquerymodel.h"
+#include "qmlsqlresult.h"
+#include "qmlsqlschemacache.h"
+
+static const char* connectionName = "qmlsql-benchmarks";
+static const int itemCount = 100000;
+
+/*!
+ * \brief The tst_QmlSqlBenchmarks class
+ * Benchmarks of the hot paths of the plugin against an in-memory SQLite database that holds
+ * itemCount rows in the table item. Run "make benchmark" to write the results to benchmarks.xml,
+ * or pass any of the QtTest output options, e.g. "-o results.csv,csv".
+ */
+class tst_QmlSqlBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void execWithQuerySelect_data();
+    void execWithQuerySelect();
+    void execWithQueryDml_data();
+    void execWithQueryDml();
+
+    void modelData_data();
+    void modelData();
+    void modelRoleNames();
+    void modelExec_data();
+    void modelExec();
+    void modelRefresh_data();
+    void modelRefresh();
+
+    void databaseOpen();
+    void databaseTables_data();
+    void databaseTables();
+
+private:
+    void setUpModel(QmlSqlQueryModel* model, const QString& query, QmlSqlQueryModel::Storage storage);
+
+    QmlSqlDatabase* m_database;
+};
+
+void tst_QmlSqlBenchmarks::initTestCase() {
+    QVERIFY(QSqlDatabase::isDriverAvailable("QSQLITE"));
+
+    m_database = new QmlSqlDatabase(this);
+    m_database->setDatabaseDriver(QmlSqlDatabase::SQLite);
+    m_database->setDatabaseName(":memory:");
+    m_database->setConnectionName(connectionName);
+    m_database->open();
+    QVERIFY2(m_database->isConnected(), qPrintable(m_database->errorString()));
+
+    QSqlDatabase db = QSqlDatabase::database(connectionName);
+    QSqlQuery query(db);
+    QVERIFY(query.exec("CREATE TABLE item (id INTEGER PRIMARY KEY, name TEXT, price REAL, quantity INTEGER)"));
+    QVERIFY(query.exec("CREATE TABLE log (id INTEGER PRIMARY KEY, message TEXT)"));
+
+    QVariantList ids;
+    QVariantList names;
+    QVariantList prices;
+    QVariantList quantities;
+    for (int i = 1; i <= itemCount; i++) {
+        ids << i;
+        names << QString("item %1").arg(i);
+        prices << i * 0.25;
+        quantities << i % 100;
+    }
+    QVERIFY(db.transaction());
+    QVERIFY(query.prepare("INSERT INTO item (id, name, price, quantity) VALUES (?, ?, ?, ?)"));
+    query.addBindValue(ids);
+    query.addBindValue(names);
+    query.addBindValue(prices);
+    query.addBindValue(quantities);
+    QVERIFY(query.execBatch());
+    QVERIFY(db.commit());
+}
+
+void tst_QmlSqlBenchmarks::cleanupTestCase() {
+    m_database->close();
+}
+
+void tst_QmlSqlBenchmarks::setUpModel(QmlSqlQueryModel* model, const QString& query, QmlSqlQueryModel::Storage storage) {
+    model->setQueryString(query);
+    model->setStorage(storage);
+    // the model runs exec() as soon as it has a connected database
+    model->setDatabase(m_database);
+}
+
+void tst_QmlSqlBenchmarks::execWithQuerySelect_data() {
+    QTest::addColumn<int>("rows");
+    QTest::newRow("1 row") << 1;
+    QTest::newRow("100 rows") << 100;
+    QTest::newRow("10000 rows") << 10000;
+    QTest::newRow("100000 rows") << itemCount;
+}
+
+void tst_QmlSqlBenchmarks::execWithQuerySelect() {
+    QFETCH(int, rows);
+    QmlSqlQuery query;
+    const QString statement = QString("SELECT id, name, price, quantity FROM item WHERE id <= %1").arg(rows);
+
+    QBENCHMARK {
+        query.execWithQuery(connectionName, statement);
+    }
+    QVERIFY2(query.errorString().isEmpty(), qPrintable(query.errorString()));
+    QCOMPARE(query.result()->rowCount(), rows);
+}
+
+void tst_QmlSqlBenchmarks::execWithQueryDml_data() {
+    QTest::addColumn<QString>("statement");
+    QTest::newRow("insert") << "INSERT INTO log (message) VALUES ('benchmark')";
+    QTest::newRow("update") << "UPDATE item SET quantity = quantity + 1 WHERE id = 42";
+    QTest::newRow("delete") << "DELETE FROM log WHERE id = -1";
+}
+
+void tst_QmlSqlBenchmarks::execWithQueryDml() {
+    QFETCH(QString, statement);
+    QmlSqlQuery query;
+
+    QBENCHMARK {
+        query.execWithQuery(connectionName, statement);
+    }
+    QVERIFY2(query.errorString().isEmpty(), qPrintable(query.errorString()));
+}
+
+void tst_QmlSqlBenchmarks::modelData_data() {
+    QTest::addColumn<int>("storage");
+    QTest::newRow("cursor") << int(QmlSqlQueryModel::Cursor);
+    QTest::newRow("columnar") << int(QmlSqlQueryModel::Columnar);
+}
+
+// reads every role of every row, as a ListView scrolling through the whole result would
+void tst_QmlSqlBenchmarks::modelData() {
+    QFETCH(int, storage);
+    QmlSqlQueryModel model;
+    setUpModel(&model, "SELECT id, name, price, quantity FROM item", QmlSqlQueryModel::Storage(storage));
+    while (model.canFetchMore(QModelIndex()))
+        model.fetchMore(QModelIndex());
+    QCOMPARE(model.rowCount(), itemCount);
+
+    const QList<int> roles = model.roleNames().keys();
+    QBENCHMARK {
+        for (int row = 0; row < itemCount; row++) {
+            const QModelIndex index = model.index(row, 0);
+            foreach (int role, roles)
+                model.data(index, role);
+        }
+    }
+}
+
+void tst_QmlSqlBenchmarks::modelRoleNames() {
+    QmlSqlQueryModel model;
+    setUpModel(&model, "SELECT id, name, price, quantity FROM item", QmlSqlQueryModel::Columnar);
+    QCOMPARE(model.rowCount(), itemCount);
+
+    QBENCHMARK {
+        model.roleNames();
+    }
+}
+
+void tst_QmlSqlBenchmarks::modelExec_data() {
+    QTest::addColumn<int>("storage");
+    QTest::addColumn<int>("rows");
+    QTest::newRow("cursor 1000 rows") << int(QmlSqlQueryModel::Cursor) << 1000;
+    QTest::newRow("columnar 1000 rows") << int(QmlSqlQueryModel::Columnar) << 1000;
+    QTest::newRow("cursor 100000 rows") << int(QmlSqlQueryModel::Cursor) << itemCount;
+    QTest::newRow("columnar 100000 rows") << int(QmlSqlQueryModel::Columnar) << itemCount;
+}
+
+void tst_QmlSqlBenchmarks::modelExec() {
+    QFETCH(int, storage);
+    QFETCH(int, rows);
+    QmlSqlQueryModel model;
+    setUpModel(&model, QString("SELECT id, name, price, quantity FROM item WHERE id <= %1").arg(rows), QmlSqlQueryModel::Storage(storage));
+
+    QBENCHMARK {
+        model.exec();
+    }
+    QVERIFY2(model.errorString().isEmpty(), qPrintable(model.errorString()));
+}
+
+void tst_QmlSqlBenchmarks::modelRefresh_data() {
+    QTest::addColumn<int>("refreshMode");
+    QTest::newRow("reset") << int(QmlSqlQueryModel::Reset);
+    QTest::newRow("incremental") << int(QmlSqlQueryModel::Incremental);
+}
+
+// one row changes between two exec() calls, the case autoRefresh is made for
+void tst_QmlSqlBenchmarks::modelRefresh() {
+    QFETCH(int, refreshMode);
+    QmlSqlQueryModel model;
+    model.setKeyColumn("id");
+    model.setRefreshMode(QmlSqlQueryModel::RefreshMode(refreshMode));
+    setUpModel(&model, "SELECT id, name, price, quantity FROM item WHERE id <= 10000", QmlSqlQueryModel::Columnar);
+
+    QSqlQuery update(QSqlDatabase::database(connectionName));
+    QVERIFY(update.prepare("UPDATE item SET quantity = quantity + 1 WHERE id = ?"));
+    int id = 0;
+    QBENCHMARK {
+        update.bindValue(0, id++ % 10000 + 1);
+        update.exec();
+        model.exec();
+    }
+    QVERIFY2(model.errorString().isEmpty(), qPrintable(model.errorString()));
+}
+
+void tst_QmlSqlBenchmarks::databaseOpen() {
+    QBENCHMARK {
+        QmlSqlDatabase database;
+        database.setDatabaseDriver(QmlSqlDatabase::SQLite);
+        database.setDatabaseName(":memory:");
+        database.setConnectionName("qmlsql-benchmarks-open");
+        database.open();
+        database.close();
+    }
+}
+
+void tst_QmlSqlBenchmarks::databaseTables_data() {
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("catalog") << false;
+    QTest::newRow("cached") << true;
+}
+
+// tables() is served by QmlSqlSchemaCache, the catalog case drops the cache so every run reads the catalog
+void tst_QmlSqlBenchmarks::databaseTables() {
+    QFETCH(bool, cached);
+    QStringList tables;
+    QBENCHMARK {
+        if (!cached)
+            QmlSqlSchemaCache::instance()->invalidate(connectionName);
+        tables = m_database->tables(connectionName, QmlSqlDatabase::Tables);
+    }
+    QVERIFY(tables.contains("item"));
+}
+
+QTEST_GUILESS_MAIN(tst_QmlSqlBenchmarks)
+
+#include "tst_qmlsqlbenchmarks.moc"